@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ESXPDocument.h"
+#import "ESXPNode.h"
+
+/// Class for representing a read-only DOM Document stored in contiguous tables.
+///
+/// <p>
+/// Instead of one object per node, every node is a row in a set of C arrays (type,
+/// name id, parent, first child, last child, next and previous sibling and a range) kept inside
+/// the document. For text nodes the range points into a single UTF-8 text blob, for
+/// elements it points into the attribute table, whose values live in the same blob.
+/// Names are interned in the name table and referenced by symbol. Freeing a document
+/// releases a handful of large blocks no matter how many nodes it has.
+/// </p>
+///
+/// <p>
+/// Nodes are exposed through ESXPArenaNode facades created on demand, so the document
+/// can be handed to ESXPProcessor and ESXPStackDOMWalker like any other. Row 0 is
+/// always the root element.
+/// </p>
+///
+/// <p>
+/// The tables can be written to a snapshot file and loaded back with
+/// newBuildFromSnapshot:error:. Loading maps the file and points the tables into it, so
+/// nothing is parsed or copied per node, pages are read only when touched and are shared
+/// by every process mapping the same file. A loaded document is frozen. Snapshots are
+/// written in the byte order of the machine and only loaded on machines with the same
+/// one. Loading checks the sizes of the sections and that every row, name and range
+/// points inside the snapshot, so a truncated or corrupt file gives an error and not a
+/// bad read later on. The check reads the tables once; the text is not read.
+/// </p>
+///
+/// <p>
+/// Offsets into the text blob are 64 bits wide, so text may go past 4 GiB. Rows are 32
+/// bits wide: appending past UINT32_MAX - 1 rows, or a single value longer than
+/// UINT32_MAX bytes, raises an ArenaCapacityException instead of wrapping around.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPArenaDocument : ESXPDocument
+{
+    uint8_t    *types;            // The type of each node.
+    uint32_t   *names;            // The name symbol of each node.
+    uint32_t   *parents;          // The parent row of each node.
+    uint32_t   *firstChildren;    // The first child row of each node.
+    uint32_t   *lastChildren;     // The last child row of each node.
+    uint32_t   *nextSiblings;     // The next sibling row of each node.
+    uint32_t   *previousSiblings; // The previous sibling row of each node.
+    uint64_t   *rangeStarts;      // Text: offset into the text blob. Element: first row in the attribute table.
+    uint32_t   *rangeLengths;     // Text: length in bytes. Element: count of attributes.
+    NSUInteger nodeCount;         // Rows used in the node tables.
+    NSUInteger nodeCapacity;      // Rows allocated in the node tables.
+    
+    uint32_t   *attributeNames;   // The name symbol of each attribute.
+    uint64_t   *attributeStarts;  // The offset of each attribute value into the text blob.
+    uint32_t   *attributeLengths; // The length in bytes of each attribute value.
+    NSUInteger attributeCount;    // Rows used in the attribute table.
+    NSUInteger attributeCapacity; // Rows allocated in the attribute table.
+    
+    char       *text;             // The text blob, UTF-8 encoded.
+    NSUInteger textLength;        // Bytes used in the text blob.
+    NSUInteger textCapacity;      // Bytes allocated for the text blob.
+    
+    NSData     *snapshot;         // The mapped snapshot the tables point into, nil if the tables are owned.
+}
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param name     The name of the root node.
+/// \param capacity The number of nodes to reserve room for.
+///
+/// \return A new instance of this class if available, otherwise return NIL.
++ (ESXPArenaDocument *)newBuild:(NSString *)name capacity:(NSUInteger)capacity;
+
+/// Builder of new instances sharing a name table. Follows the Builder Pattern.
+///
+/// \param name      The name of the root node.
+/// \param capacity  The number of nodes to reserve room for.
+/// \param nameTable The name table to intern names into.
+///
+/// \return A new instance of this class if available, otherwise return NIL.
++ (ESXPArenaDocument *)newBuild:(NSString *)name capacity:(NSUInteger)capacity nameTable:(ESXPNameTable *)nameTable;
+
+/// Builder of new instances holding a copy of another document. Follows the Builder Pattern.
+///
+/// \param document The document to copy. Shares its name table.
+///
+/// \return A new instance of this class if available, otherwise return NIL.
++ (ESXPArenaDocument *)newBuildFromDocument:(ESXPDocument *)document;
+
+/// Builder of new instances from a snapshot file. Follows the Builder Pattern.
+///
+/// \param path  The path of the snapshot, as written by writeSnapshot:error:.
+/// \param error Set if the file can not be read or is not a valid snapshot.
+///
+/// \return A new, frozen, instance of this class or nil if any problem.
++ (ESXPArenaDocument *)newBuildFromSnapshot:(NSString *)path error:(NSError **)error;
+
+// MARK: Methods
+/// Appends a new element as the last child of a node. The depth of the element is found
+/// going up its parents, builders that keep a stack of open elements should give it with
+/// appendElement:parent:depth: instead.
+///
+/// \param name   The name of the element.
+/// \param parent The row of the parent node.
+///
+/// \return The row of the new element.
+- (NSUInteger)appendElement:(NSString *)name parent:(NSUInteger)parent;
+
+/// Appends a new element as the last child of a node, at a known depth.
+///
+/// \param name   The name of the element.
+/// \param parent The row of the parent node.
+/// \param depth  The depth of the new element, 1 for the children of the root.
+///
+/// \return The row of the new element.
+- (NSUInteger)appendElement:(NSString *)name parent:(NSUInteger)parent depth:(NSUInteger)depth;
+
+/// Adds an attribute to an element. Attributes must be added right after their element,
+/// before any other node is appended.
+///
+/// \param name    The name of the attribute.
+/// \param value   The value of the attribute.
+/// \param element The row of the element.
+- (void)appendAttribute:(NSString *)name value:(NSString *)value element:(NSUInteger)element;
+
+/// Appends a new text node as the last child of a node.
+///
+/// \param value  The text.
+/// \param parent The row of the parent node.
+///
+/// \return The row of the new text node.
+- (NSUInteger)appendText:(NSString *)value parent:(NSUInteger)parent;
+
+/// Returns the facade for a given row, or nil for NSNotFound.
+///
+/// \param node The row of the node.
+///
+/// \return The facade for the node.
+- (id<ESXPNode>)nodeAt:(NSUInteger)node;
+
+/// Returns the count of rows in this document, including the root.
+///
+/// \return The count of rows in this document.
+- (NSUInteger)getNodeCount;
+
+/// The type of a node, as defined in ESXPNode.
+- (unsigned short)typeOfNode:(NSUInteger)node;
+
+/// The name of a node, "#text" for text nodes.
+- (NSString *)nameOfNode:(NSUInteger)node;
+
+/// The name symbol of a node, kNO_SYMBOL for text nodes.
+- (NSUInteger)symbolOfNode:(NSUInteger)node;
+
+/// The text of a text node, nil for elements.
+- (NSString *)valueOfNode:(NSUInteger)node;
+
+/// The attributes of an element, nil for text nodes.
+- (NSDictionary *)attributesOfNode:(NSUInteger)node;
+
+/// The count of attributes of an element.
+- (NSUInteger)attributeCountOfNode:(NSUInteger)node;
+
+/// The row of the parent of a node, NSNotFound for the root.
+- (NSUInteger)parentOfNode:(NSUInteger)node;
+
+/// The row of the first child of a node, NSNotFound if it has none.
+- (NSUInteger)firstChildOfNode:(NSUInteger)node;
+
+/// The row of the last child of a node, NSNotFound if it has none.
+- (NSUInteger)lastChildOfNode:(NSUInteger)node;
+
+/// The row of the next sibling of a node, NSNotFound if it is the last one.
+- (NSUInteger)nextSiblingOfNode:(NSUInteger)node;
+
+/// The row of the previous sibling of a node, NSNotFound if it is the first one.
+- (NSUInteger)previousSiblingOfNode:(NSUInteger)node;
+@end
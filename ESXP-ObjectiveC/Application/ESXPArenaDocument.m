@@ -0,0 +1,627 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ESXPArenaDocument.h"
+#import "ESXPArenaNode.h"
+#import "ESXPConstants.h"
+#import <errno.h>
+#import <stdio.h>
+#import <unistd.h>
+
+static uint32_t const kNONE = UINT32_MAX; // Marks a missing row in the tables.
+
+/// Grows a table to hold at least the given count of elements.
+static void *ESXPArenaGrow(void *table, NSUInteger elementSize, NSUInteger capacity)
+{
+    void *grown = realloc(table, elementSize * capacity);
+    if (grown == NULL)
+        @throw [NSException exceptionWithName:NSMallocException
+                                       reason:@"Unable to grow the document tables."
+                                     userInfo:nil];
+    
+    return grown;
+}
+
+static inline NSUInteger ESXPArenaRow(uint32_t row) { return row == kNONE ? NSNotFound : row; }
+
+// MARK: Snapshots
+static char       const kSNAPSHOT_MAGIC[8]   = { 'E', 'S', 'X', 'P', 'S', 'N', 'A', 'P' };
+static uint32_t   const kSNAPSHOT_VERSION    = 2;
+static uint32_t   const kSNAPSHOT_BYTE_ORDER = 0x01020304;
+static NSUInteger const kSNAPSHOT_SECTIONS   = 15; // See ESXPSnapshotSizes.
+
+/// The header of a snapshot file. The sections follow it (see ESXPSnapshotSizes), each
+/// one starting at a multiple of 8 bytes so the tables can be used in place.
+typedef struct {
+    char     magic[8];       // kSNAPSHOT_MAGIC.
+    uint32_t version;        // kSNAPSHOT_VERSION.
+    uint32_t byteOrder;      // kSNAPSHOT_BYTE_ORDER, as the writing machine stores it.
+    uint64_t nodeCount;      // Rows in the node tables.
+    uint64_t attributeCount; // Rows in the attribute table.
+    uint64_t textLength;     // Bytes in the text blob.
+    uint64_t nameCount;      // Names in the name table, symbol 1 first.
+    uint64_t namesLength;    // Bytes of all names together.
+    ESXPDocumentStatistics statistics; // The statistics of the document.
+} ESXPSnapshotHeader;
+
+static inline uint64_t ESXPSnapshotPad(uint64_t size) { return (size + 7) & ~(uint64_t) 7; }
+
+/// The size of every section of a snapshot: the types, the eight other node columns, the
+/// three attribute columns, the length of every name, the names and the text. Offsets
+/// into the text (the range starts and the attribute starts) take 64 bits.
+static void ESXPSnapshotSizes(const ESXPSnapshotHeader *header, uint64_t *sizes)
+{
+    sizes[0] = header->nodeCount * sizeof(uint8_t);
+    for (NSUInteger i = 1; i <= 8; i++)
+        sizes[i] = header->nodeCount * (i == 7 ? sizeof(uint64_t) : sizeof(uint32_t));
+    for (NSUInteger i = 9; i <= 11; i++)
+        sizes[i] = header->attributeCount * (i == 10 ? sizeof(uint64_t) : sizeof(uint32_t));
+    sizes[12] = header->nameCount * sizeof(uint32_t);
+    sizes[13] = header->namesLength;
+    sizes[14] = header->textLength;
+}
+
+static void ESXPSnapshotError(ErrorCodes code, NSString *reason, NSError *cause, NSError **error)
+{
+    if (error == NULL)
+        return;
+    
+    NSMutableDictionary *userInfo = [@{ NSLocalizedDescriptionKey : reason } mutableCopy];
+    if (cause != nil)
+        [userInfo setObject:cause forKey:NSUnderlyingErrorKey];
+    *error = [NSError errorWithDomain:@"net.apkc.projects.ErrorDomain" code:code userInfo:userInfo];
+    
+    if (kDEBUG)
+        NSLog(@"ERROR ==> %@", reason);
+}
+
+/// Checks that every row, symbol and range of a loaded snapshot points inside it. Rows are
+/// appended in document order, so parents and previous siblings come before a node and its
+/// children and next siblings after it, which also keeps every walk of the links finite.
+static BOOL ESXPSnapshotCheck(const ESXPSnapshotHeader *header, const char *bytes, const uint64_t *offsets)
+{
+    const uint8_t  *types            = (const uint8_t *) (bytes + offsets[0]);
+    const uint32_t *names            = (const uint32_t *) (bytes + offsets[1]);
+    const uint32_t *parents          = (const uint32_t *) (bytes + offsets[2]);
+    const uint32_t *firstChildren    = (const uint32_t *) (bytes + offsets[3]);
+    const uint32_t *lastChildren     = (const uint32_t *) (bytes + offsets[4]);
+    const uint32_t *nextSiblings     = (const uint32_t *) (bytes + offsets[5]);
+    const uint32_t *previousSiblings = (const uint32_t *) (bytes + offsets[6]);
+    const uint64_t *rangeStarts      = (const uint64_t *) (bytes + offsets[7]);
+    const uint32_t *rangeLengths     = (const uint32_t *) (bytes + offsets[8]);
+    const uint32_t *attributeNames   = (const uint32_t *) (bytes + offsets[9]);
+    const uint64_t *attributeStarts  = (const uint64_t *) (bytes + offsets[10]);
+    const uint32_t *attributeLengths = (const uint32_t *) (bytes + offsets[11]);
+    uint64_t       nodeCount         = header->nodeCount;
+    
+    if (types[0] != ELEMENT_NODE || parents[0] != kNONE)
+        return NO;
+    
+    for (uint64_t i = 0; i < nodeCount; i++) {
+        BOOL element = types[i] == ELEMENT_NODE;
+        if (!element && types[i] != TEXT_NODE)
+            return NO;
+        
+        if (i > 0 && (parents[i] >= i || types[parents[i]] != ELEMENT_NODE))
+            return NO;
+        
+        if (previousSiblings[i] != kNONE && (previousSiblings[i] >= i || parents[previousSiblings[i]] != parents[i]))
+            return NO;
+        
+        if (nextSiblings[i] != kNONE && (nextSiblings[i] <= i || nextSiblings[i] >= nodeCount || parents[nextSiblings[i]] != parents[i]))
+            return NO;
+        
+        if ((firstChildren[i] == kNONE) != (lastChildren[i] == kNONE))
+            return NO;
+        
+        if (firstChildren[i] != kNONE && (!element || firstChildren[i] <= i || lastChildren[i] < firstChildren[i] || lastChildren[i] >= nodeCount))
+            return NO;
+        
+        if (firstChildren[i] != kNONE && (parents[firstChildren[i]] != i || parents[lastChildren[i]] != i))
+            return NO;
+        
+        // Elements range over the attribute table, text over the text blob.
+        uint64_t limit = element ? header->attributeCount : header->textLength;
+        if (rangeStarts[i] > limit || rangeLengths[i] > limit - rangeStarts[i])
+            return NO;
+        
+        if (element ? (names[i] == kNO_SYMBOL || names[i] > header->nameCount) : names[i] != kNO_SYMBOL)
+            return NO;
+    }
+    
+    for (uint64_t i = 0; i < header->attributeCount; i++) {
+        if (attributeNames[i] == kNO_SYMBOL || attributeNames[i] > header->nameCount)
+            return NO;
+        
+        if (attributeStarts[i] > header->textLength || attributeLengths[i] > header->textLength - attributeStarts[i])
+            return NO;
+    }
+    
+    return YES;
+}
+
+@implementation ESXPArenaDocument
+// MARK: Builders
++ (ESXPDocument *)newBuild:(NSString *)name { return [ESXPArenaDocument newBuild:name capacity:1024]; }
+
++ (ESXPDocument *)newBuild:(NSString *)name nameTable:(ESXPNameTable *)nameTable { return [ESXPArenaDocument newBuild:name capacity:1024 nameTable:nameTable]; }
+
++ (ESXPArenaDocument *)newBuild:(NSString *)name capacity:(NSUInteger)capacity { return [ESXPArenaDocument newBuild:name capacity:capacity nameTable:[ESXPNameTable newBuild]]; }
+
++ (ESXPArenaDocument *)newBuild:(NSString *)name capacity:(NSUInteger)capacity nameTable:(ESXPNameTable *)nameTable
+{
+    ESXPArenaDocument *instance = [[ESXPArenaDocument alloc] init];
+    if (instance) {
+        instance->nameTable = nameTable;
+        [instance keepStatistics];
+        [instance reserveNodes:MAX(capacity, 16)];
+        [instance reserveAttributes:16];
+        [instance reserveText:4096];
+        
+        // Row 0 is the root.
+        [instance appendElement:name parent:NSNotFound];
+    }
+    else {
+        return nil;
+    }
+    
+    return instance;
+}
+
++ (ESXPArenaDocument *)newBuildFromDocument:(ESXPDocument *)document
+{
+    id<ESXPNode>      root     = [document getRootNode];
+    ESXPArenaDocument *instance = [ESXPArenaDocument newBuild:[root getNodeName] capacity:1024 nameTable:[document getNameTable]];
+    if (instance) {
+        // Rows are appended as the nodes are met in document order. The stack holds triples
+        // of a node, the row of its parent and its depth, the next one on top.
+        NSMutableArray *pending = [NSMutableArray new];
+        NSArray        *children = [root getChildNodes];
+        for (NSInteger i = (NSInteger) [children count] - 1; i >= 0; i--)
+            [pending addObjectsFromArray:@[ [children objectAtIndex:i], @0, @1 ]];
+        
+        while ([pending count] > 0) {
+            NSUInteger   depth  = [[pending lastObject] unsignedIntegerValue];
+            NSUInteger   parent = [[pending objectAtIndex:[pending count] - 2] unsignedIntegerValue];
+            id<ESXPNode> node   = [pending objectAtIndex:[pending count] - 3];
+            [pending removeObjectsInRange:NSMakeRange([pending count] - 3, 3)];
+            
+            if ([node getNodeType] == TEXT_NODE) {
+                [instance appendText:[node getNodeValue] parent:parent];
+                continue;
+            }
+            
+            NSUInteger   row        = [instance appendElement:[node getNodeName] parent:parent depth:depth];
+            NSDictionary *attributes = [node getAttributes];
+            for (NSString *name in attributes)
+                [instance appendAttribute:name value:[attributes objectForKey:name] element:row];
+            
+            children = [node getChildNodes];
+            for (NSInteger i = (NSInteger) [children count] - 1; i >= 0; i--)
+                [pending addObjectsFromArray:@[ [children objectAtIndex:i], @(row), @(depth + 1) ]];
+        }
+    }
+    else {
+        return nil;
+    }
+    
+    return instance;
+}
+
++ (ESXPArenaDocument *)newBuildFromSnapshot:(NSString *)path error:(NSError **)error
+{
+    NSError *cause = nil;
+    NSData  *data  = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:&cause];
+    if (data == nil) {
+        ESXPSnapshotError(SNAPSHOT_INVALID, NSLocalizedString(@"No se pudo leer el archivo.", @""), cause, error);
+        return nil;
+    }
+    
+    // Check the header, and that the sections fill the file exactly.
+    const char         *bytes  = [data bytes];
+    ESXPSnapshotHeader header;
+    uint64_t           sizes[kSNAPSHOT_SECTIONS];
+    uint64_t           offsets[kSNAPSHOT_SECTIONS];
+    uint64_t           length  = [data length];
+    BOOL               valid   = length >= sizeof(header);
+    if (valid) {
+        memcpy(&header, bytes, sizeof(header));
+        valid = memcmp(header.magic, kSNAPSHOT_MAGIC, sizeof(kSNAPSHOT_MAGIC)) == 0
+            && header.version == kSNAPSHOT_VERSION
+            && header.byteOrder == kSNAPSHOT_BYTE_ORDER
+            && header.nodeCount > 0 && header.nodeCount < kNONE
+            && header.attributeCount < kNONE && header.textLength < length
+            && header.nameCount < kNONE && header.namesLength < kNONE;
+    }
+    if (valid) {
+        uint64_t offset = sizeof(header);
+        ESXPSnapshotSizes(&header, sizes);
+        for (NSUInteger i = 0; i < kSNAPSHOT_SECTIONS; i++) {
+            offsets[i] = offset;
+            offset    += ESXPSnapshotPad(sizes[i]);
+        }
+        valid = offset == length && ESXPSnapshotCheck(&header, bytes, offsets);
+    }
+    if (!valid) {
+        ESXPSnapshotError(SNAPSHOT_INVALID, NSLocalizedString(@"El archivo no es un snapshot valido.", @""), nil, error);
+        return nil;
+    }
+    
+    ESXPArenaDocument *instance = [[ESXPArenaDocument alloc] init];
+    if (instance) {
+        // The tables are used in place, the document only keeps the mapping alive.
+        instance->snapshot          = data;
+        instance->types             = (uint8_t *) (bytes + offsets[0]);
+        instance->names             = (uint32_t *) (bytes + offsets[1]);
+        instance->parents           = (uint32_t *) (bytes + offsets[2]);
+        instance->firstChildren     = (uint32_t *) (bytes + offsets[3]);
+        instance->lastChildren      = (uint32_t *) (bytes + offsets[4]);
+        instance->nextSiblings      = (uint32_t *) (bytes + offsets[5]);
+        instance->previousSiblings  = (uint32_t *) (bytes + offsets[6]);
+        instance->rangeStarts       = (uint64_t *) (bytes + offsets[7]);
+        instance->rangeLengths      = (uint32_t *) (bytes + offsets[8]);
+        instance->nodeCount         = (NSUInteger) header.nodeCount;
+        instance->nodeCapacity      = (NSUInteger) header.nodeCount;
+        instance->attributeNames    = (uint32_t *) (bytes + offsets[9]);
+        instance->attributeStarts   = (uint64_t *) (bytes + offsets[10]);
+        instance->attributeLengths  = (uint32_t *) (bytes + offsets[11]);
+        instance->attributeCount    = (NSUInteger) header.attributeCount;
+        instance->attributeCapacity = (NSUInteger) header.attributeCount;
+        instance->text              = (char *) (bytes + offsets[14]);
+        instance->textLength        = (NSUInteger) header.textLength;
+        instance->textCapacity      = (NSUInteger) header.textLength;
+        instance->frozen            = YES;
+        instance->statistics        = header.statistics;
+        instance->statisticsKept    = YES;
+        
+        // Interning the names in order into a new table gives them back their symbols.
+        const uint32_t *nameLengths = (const uint32_t *) (bytes + offsets[12]);
+        const char     *nameBytes   = bytes + offsets[13];
+        uint64_t       nameOffset   = 0;
+        instance->nameTable = [ESXPNameTable newBuild];
+        for (NSUInteger i = 0; i < header.nameCount; i++) {
+            if (nameOffset + nameLengths[i] > header.namesLength || [instance->nameTable internBytes:nameBytes + nameOffset length:nameLengths[i]] != i + 1) {
+                ESXPSnapshotError(SNAPSHOT_INVALID, NSLocalizedString(@"El archivo no es un snapshot valido.", @""), nil, error);
+                return nil;
+            }
+            
+            nameOffset += nameLengths[i];
+        }
+    }
+    else {
+        return nil;
+    }
+    
+    return instance;
+}
+
+- (void)dealloc
+{
+    // A loaded snapshot owns nothing, the mapping goes away with the data.
+    if (self->snapshot != nil)
+        return;
+    
+    free(self->types);
+    free(self->names);
+    free(self->parents);
+    free(self->firstChildren);
+    free(self->lastChildren);
+    free(self->nextSiblings);
+    free(self->previousSiblings);
+    free(self->rangeStarts);
+    free(self->rangeLengths);
+    free(self->attributeNames);
+    free(self->attributeStarts);
+    free(self->attributeLengths);
+    free(self->text);
+}
+
+// MARK: Methods
+- (void)normalize { /* Do nothing, this document is read-only. */ }
+
+- (void)freeze { self->frozen = YES; /* Nothing to decode, values are read from the tables. */ }
+
+- (ESXPDocumentFootprint)getFootprint
+{
+    // The tables are all there is, whether allocated or mapped from a snapshot. Attribute
+    // values are in the text blob.
+    ESXPDocumentFootprint counted;
+    counted.nodeBytes      = self->nodeCapacity * (sizeof(uint8_t) + 7 * sizeof(uint32_t) + sizeof(uint64_t));
+    counted.nameBytes      = [self->nameTable getByteCount];
+    counted.textBytes      = self->textCapacity;
+    counted.attributeBytes = self->attributeCapacity * (2 * sizeof(uint32_t) + sizeof(uint64_t));
+    
+    return counted;
+}
+
+- (BOOL)writeSnapshot:(NSString *)path error:(NSError **)error
+{
+    // The names, in symbol order.
+    NSUInteger    nameCount   = [self->nameTable count];
+    NSMutableData *lengths    = [NSMutableData dataWithLength:nameCount * sizeof(uint32_t)];
+    NSMutableData *nameBytes  = [NSMutableData new];
+    for (NSUInteger i = 0; i < nameCount; i++) {
+        NSData *name = [[self->nameTable nameForSymbol:i + 1] dataUsingEncoding:NSUTF8StringEncoding];
+        ((uint32_t *) [lengths mutableBytes])[i] = (uint32_t) [name length];
+        [nameBytes appendData:name];
+    }
+    
+    ESXPSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kSNAPSHOT_MAGIC, sizeof(kSNAPSHOT_MAGIC));
+    header.version        = kSNAPSHOT_VERSION;
+    header.byteOrder      = kSNAPSHOT_BYTE_ORDER;
+    header.nodeCount      = self->nodeCount;
+    header.attributeCount = self->attributeCount;
+    header.textLength     = self->textLength;
+    header.nameCount      = nameCount;
+    header.namesLength    = [nameBytes length];
+    header.statistics     = self->statistics;
+    
+    uint64_t   sizes[kSNAPSHOT_SECTIONS];
+    const void *sections[] = {
+        self->types, self->names, self->parents, self->firstChildren, self->lastChildren,
+        self->nextSiblings, self->previousSiblings, self->rangeStarts, self->rangeLengths,
+        self->attributeNames, self->attributeStarts, self->attributeLengths,
+        [lengths bytes], [nameBytes bytes], self->text
+    };
+    ESXPSnapshotSizes(&header, sizes);
+    
+    // Write next to the target and move it into place, so a reader never maps half a file.
+    static char const zeros[8] = { 0 };
+    NSString *temporary = [path stringByAppendingString:@".tmp"];
+    FILE     *file      = fopen([temporary fileSystemRepresentation], "wb");
+    BOOL     written    = file != NULL && fwrite(&header, sizeof(header), 1, file) == 1;
+    for (NSUInteger i = 0; i < kSNAPSHOT_SECTIONS && written; i++) {
+        size_t padding = (size_t) (ESXPSnapshotPad(sizes[i]) - sizes[i]);
+        written = (sizes[i] == 0 || fwrite(sections[i], 1, (size_t) sizes[i], file) == sizes[i]) && fwrite(zeros, 1, padding, file) == padding;
+    }
+    if (file != NULL)
+        written = (fclose(file) == 0) && written;
+    if (written)
+        written = rename([temporary fileSystemRepresentation], [path fileSystemRepresentation]) == 0;
+    
+    if (!written) {
+        NSError *cause = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        unlink([temporary fileSystemRepresentation]);
+        ESXPSnapshotError(SNAPSHOT_WRITE_ERROR, NSLocalizedString(@"No se pudo escribir el snapshot.", @""), cause, error);
+        return NO;
+    }
+    
+    return YES;
+}
+
+- (NSString *)description { return [NSString stringWithFormat:@"Name: DOMDocument (Arena)"]; }
+
+- (ESXPElement *)getRootNode { return (ESXPElement *)[self nodeAt:0]; }
+
+- (NSArray *)getElementsByTagName:(NSString *)name
+{
+    if (self->tagIndex != nil)
+        return [super getElementsByTagName:name];
+    
+    // Rows are appended in document order, so a scan of the name column is enough.
+    NSUInteger     symbol = [self->nameTable symbolForName:name];
+    NSMutableArray *found = [NSMutableArray new];
+    for (NSUInteger i = 0; i < self->nodeCount && symbol != kNO_SYMBOL; i++)
+        if (self->types[i] == ELEMENT_NODE && self->names[i] == symbol)
+            [found addObject:[self nodeAt:i]];
+    
+    return found;
+}
+
+- (NSUInteger)appendElement:(NSString *)name parent:(NSUInteger)parent
+{
+    NSUInteger depth = 0;
+    for (NSUInteger up = parent; up != NSNotFound; up = ESXPArenaRow(self->parents[up]))
+        depth++;
+    
+    return [self appendElement:name parent:parent depth:depth];
+}
+
+- (NSUInteger)appendElement:(NSString *)name parent:(NSUInteger)parent depth:(NSUInteger)depth
+{
+    NSUInteger node = [self appendNode:ELEMENT_NODE name:(uint32_t) [self->nameTable internName:name] parent:parent];
+    self->rangeStarts[node]  = self->attributeCount;
+    self->rangeLengths[node] = 0;
+    if (parent != NSNotFound)
+        [self countElement:depth attributes:0];
+    
+    return node;
+}
+
+- (void)appendAttribute:(NSString *)name value:(NSString *)value element:(NSUInteger)element
+{
+    [self checkWritable];
+    if (self->attributeCount == self->attributeCapacity)
+        [self reserveAttributes:self->attributeCapacity * 2];
+    
+    if (self->attributeCount >= kNONE)
+        [self failCapacity:@"Too many attributes for the 32 bit rows of the attribute table."];
+    
+    NSUInteger row = self->attributeCount++;
+    self->statistics.attributeCount++;
+    self->attributeNames[row]   = (uint32_t) [self->nameTable internName:name];
+    self->attributeStarts[row]  = self->textLength;
+    self->attributeLengths[row] = [self appendBytes:value];
+    self->rangeLengths[element]++;
+}
+
+- (NSUInteger)appendText:(NSString *)value parent:(NSUInteger)parent
+{
+    NSUInteger node = [self appendNode:TEXT_NODE name:kNO_SYMBOL parent:parent];
+    self->rangeStarts[node]  = self->textLength;
+    self->rangeLengths[node] = [self appendBytes:value];
+    [self countText:self->rangeLengths[node]];
+    
+    return node;
+}
+
+- (id<ESXPNode>)nodeAt:(NSUInteger)node
+{
+    if (node == NSNotFound || node >= self->nodeCount)
+        return nil;
+    
+    return [ESXPArenaNode newBuild:self node:node];
+}
+
+- (NSUInteger)getNodeCount { return self->nodeCount; }
+
+- (unsigned short)typeOfNode:(NSUInteger)node { return self->types[node]; }
+
+- (NSString *)nameOfNode:(NSUInteger)node { return self->types[node] == TEXT_NODE ? @"#text" : [self->nameTable nameForSymbol:self->names[node]]; }
+
+- (NSUInteger)symbolOfNode:(NSUInteger)node { return self->names[node]; }
+
+- (NSString *)valueOfNode:(NSUInteger)node
+{
+    if (self->types[node] != TEXT_NODE)
+        return nil;
+    
+    return [[NSString alloc] initWithBytes:self->text + self->rangeStarts[node] length:self->rangeLengths[node] encoding:NSUTF8StringEncoding];
+}
+
+- (NSDictionary *)attributesOfNode:(NSUInteger)node
+{
+    if (self->types[node] != ELEMENT_NODE)
+        return nil;
+    
+    NSUInteger          first      = self->rangeStarts[node];
+    NSUInteger          count      = self->rangeLengths[node];
+    NSMutableDictionary *attributes = [NSMutableDictionary dictionaryWithCapacity:count];
+    for (NSUInteger i = first; i < first + count; i++) {
+        NSString *value = [[NSString alloc] initWithBytes:self->text + self->attributeStarts[i] length:self->attributeLengths[i] encoding:NSUTF8StringEncoding];
+        [attributes setObject:value forKey:[self->nameTable nameForSymbol:self->attributeNames[i]]];
+    }
+    
+    return attributes;
+}
+
+- (NSUInteger)attributeCountOfNode:(NSUInteger)node { return self->types[node] == ELEMENT_NODE ? self->rangeLengths[node] : 0; }
+
+- (NSUInteger)parentOfNode:(NSUInteger)node { return ESXPArenaRow(self->parents[node]); }
+
+- (NSUInteger)firstChildOfNode:(NSUInteger)node { return ESXPArenaRow(self->firstChildren[node]); }
+
+- (NSUInteger)lastChildOfNode:(NSUInteger)node { return ESXPArenaRow(self->lastChildren[node]); }
+
+- (NSUInteger)nextSiblingOfNode:(NSUInteger)node { return ESXPArenaRow(self->nextSiblings[node]); }
+
+- (NSUInteger)previousSiblingOfNode:(NSUInteger)node { return ESXPArenaRow(self->previousSiblings[node]); }
+
+// MARK: Private Methods
+- (void)checkWritable
+{
+    if (self->frozen)
+        @throw [NSException exceptionWithName:@"FrozenDocumentException"
+                                       reason:@"The document is frozen and can not be changed."
+                                     userInfo:nil];
+}
+
+- (void)failCapacity:(NSString *)reason
+{
+    @throw [NSException exceptionWithName:@"ArenaCapacityException" reason:reason userInfo:nil];
+}
+
+- (NSUInteger)appendNode:(uint8_t)type name:(uint32_t)name parent:(NSUInteger)parent
+{
+    [self checkWritable];
+    if (self->nodeCount >= kNONE)
+        [self failCapacity:@"Too many nodes for the 32 bit rows of the node tables."];
+    
+    if (self->nodeCount == self->nodeCapacity)
+        [self reserveNodes:self->nodeCapacity * 2];
+    
+    NSUInteger node = self->nodeCount++;
+    self->types[node]         = type;
+    self->names[node]         = name;
+    self->parents[node]          = parent == NSNotFound ? kNONE : (uint32_t) parent;
+    self->firstChildren[node]    = kNONE;
+    self->lastChildren[node]     = kNONE;
+    self->nextSiblings[node]     = kNONE;
+    self->previousSiblings[node] = parent == NSNotFound ? kNONE : self->lastChildren[parent];
+    
+    // Link it as the last child of its parent.
+    if (parent != NSNotFound) {
+        if (self->lastChildren[parent] == kNONE)
+            self->firstChildren[parent] = (uint32_t) node;
+        else
+            self->nextSiblings[self->lastChildren[parent]] = (uint32_t) node;
+        self->lastChildren[parent] = (uint32_t) node;
+    }
+    
+    return node;
+}
+
+- (uint32_t)appendBytes:(NSString *)value
+{
+    NSUInteger length = [value lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    if (length > UINT32_MAX)
+        [self failCapacity:@"A value is longer than the 32 bit lengths of the tables."];
+    
+    if (self->textLength + length > self->textCapacity)
+        [self reserveText:MAX(self->textCapacity * 2, self->textLength + length)];
+    
+    [value getBytes:self->text + self->textLength
+          maxLength:length
+         usedLength:NULL
+           encoding:NSUTF8StringEncoding
+            options:0
+              range:NSMakeRange(0, [value length])
+     remainingRange:NULL];
+    self->textLength += length;
+    
+    return (uint32_t) length;
+}
+
+- (void)reserveNodes:(NSUInteger)capacity
+{
+    self->types            = ESXPArenaGrow(self->types, sizeof(uint8_t), capacity);
+    self->names            = ESXPArenaGrow(self->names, sizeof(uint32_t), capacity);
+    self->parents          = ESXPArenaGrow(self->parents, sizeof(uint32_t), capacity);
+    self->firstChildren    = ESXPArenaGrow(self->firstChildren, sizeof(uint32_t), capacity);
+    self->lastChildren     = ESXPArenaGrow(self->lastChildren, sizeof(uint32_t), capacity);
+    self->nextSiblings     = ESXPArenaGrow(self->nextSiblings, sizeof(uint32_t), capacity);
+    self->previousSiblings = ESXPArenaGrow(self->previousSiblings, sizeof(uint32_t), capacity);
+    self->rangeStarts      = ESXPArenaGrow(self->rangeStarts, sizeof(uint64_t), capacity);
+    self->rangeLengths     = ESXPArenaGrow(self->rangeLengths, sizeof(uint32_t), capacity);
+    self->nodeCapacity     = capacity;
+}
+
+- (void)reserveAttributes:(NSUInteger)capacity
+{
+    self->attributeNames    = ESXPArenaGrow(self->attributeNames, sizeof(uint32_t), capacity);
+    self->attributeStarts   = ESXPArenaGrow(self->attributeStarts, sizeof(uint64_t), capacity);
+    self->attributeLengths  = ESXPArenaGrow(self->attributeLengths, sizeof(uint32_t), capacity);
+    self->attributeCapacity = capacity;
+}
+
+- (void)reserveText:(NSUInteger)capacity
+{
+    self->text         = ESXPArenaGrow(self->text, sizeof(char), capacity);
+    self->textCapacity = capacity;
+}
+@end
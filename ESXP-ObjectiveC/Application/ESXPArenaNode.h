@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ESXPNode.h"
+
+@class ESXPArenaDocument;
+
+/// Lightweight facade over a row of an ESXPArenaDocument.
+///
+/// <p>
+/// Facades are created on demand and hold nothing but the document and the row, so
+/// two facades over the same row are equal. The underlying document is read-only,
+/// all methods that would change the tree do nothing and return nil.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPArenaNode : NSObject <ESXPNode>
+{
+    ESXPArenaDocument *document; // The document holding this node.
+    NSUInteger        node;      // The row of this node in the document.
+}
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param document The document holding the node.
+/// \param node     The row of the node in the document.
+///
+/// \return A new instance of this class if available, otherwise return NIL.
++ (ESXPArenaNode *)newBuild:(ESXPArenaDocument *)document node:(NSUInteger)node;
+
+// MARK: Methods
+/// Returns the row of this node in its document.
+///
+/// \return The row of this node.
+- (NSUInteger)getRow;
+@end
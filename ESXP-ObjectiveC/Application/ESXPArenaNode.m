@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ESXPArenaDocument.h"
+#import "ESXPArenaNode.h"
+#import "ESXPConstants.h"
+
+@implementation ESXPArenaNode
+// MARK: Builders
++ (ESXPArenaNode *)newBuild:(ESXPArenaDocument *)document node:(NSUInteger)node
+{
+    ESXPArenaNode *instance = [[ESXPArenaNode alloc] init];
+    if (instance) {
+        instance->document = document;
+        instance->node     = node;
+    }
+    else {
+        return nil;
+    }
+    
+    return instance;
+}
+
+// MARK: NSObject Overriding
+- (BOOL)isEqual:(id)object
+{
+    if (![object isKindOfClass:[ESXPArenaNode class]])
+        return NO;
+    
+    ESXPArenaNode *other = (ESXPArenaNode *)object;
+    return self->document == other->document && self->node == other->node;
+}
+
+- (NSUInteger)hash { return self->node; }
+
+- (NSString *)description
+{
+    if ([self getNodeType] == TEXT_NODE)
+        return [NSString stringWithFormat:@"<TEXT> Name: %@ - Value: %@\n", [self getNodeName], [self getNodeValue]];
+    
+    NSMutableString *str        = [NSMutableString stringWithFormat:@"<ELEMENT> Name: %@ - Value: %@\n", [self getNodeName], [self getNodeValue]];
+    NSDictionary    *attributes = [self getAttributes];
+    for (NSString *key in attributes)
+        [str appendFormat:@"\t<ATTRIBUTE> %@ : %@\n", key, [attributes objectForKey:key]];
+    
+    return str;
+}
+
+// MARK: ESXPNode Implementation
++ (id<ESXPNode>)newBuild:(NSString *)name { return nil; /* Rows are only created through the document. */ }
+
++ (id<ESXPNode>)newBuild:(NSString *)name parentNode:(id<ESXPNode>)parentNode { return nil; }
+
+- (id<ESXPNode>)appendChild:(id<ESXPNode>)newChild { return nil; }
+
+- (void)countElementNodes:(uint64_t *)counter
+{
+    for (NSUInteger child = [self->document firstChildOfNode:self->node]; child != NSNotFound; child = [self->document nextSiblingOfNode:child]) {
+        if ([self->document typeOfNode:child] == ELEMENT_NODE) {
+            *counter = *counter + 1;
+            [[self->document nodeAt:child] countElementNodes:counter];
+        }
+    }
+}
+
+- (NSString *)getAttribute:(NSString *)attributeName { return [[self->document attributesOfNode:self->node] objectForKey:attributeName]; }
+
+- (NSDictionary *)getAttributes { return [self->document attributesOfNode:self->node]; }
+
+- (NSString *)getBaseURI { return @""; }
+
+- (NSMutableArray *)getChildNodes
+{
+    if ([self->document typeOfNode:self->node] != ELEMENT_NODE)
+        return nil;
+    
+    NSMutableArray *children = [NSMutableArray new];
+    for (NSUInteger child = [self->document firstChildOfNode:self->node]; child != NSNotFound; child = [self->document nextSiblingOfNode:child])
+        [children addObject:[ESXPArenaNode newBuild:self->document node:child]];
+    
+    return children;
+}
+
+- (id<ESXPNode>)getFirstChild { return [self->document nodeAt:[self->document firstChildOfNode:self->node]]; }
+
+- (id<ESXPNode>)getLastChild { return [self->document nodeAt:[self->document lastChildOfNode:self->node]]; }
+
+- (id<ESXPNode>)getNextSibling { return [self->document nodeAt:[self->document nextSiblingOfNode:self->node]]; }
+
+- (id<ESXPNode>)getPreviousSibling { return [self->document nodeAt:[self->document previousSiblingOfNode:self->node]]; }
+
+- (NSString *)getLocalName { return @""; }
+
+- (NSString *)getNamespaceURI { return @""; }
+
+- (NSString *)getNodeName { return [self->document nameOfNode:self->node]; }
+
+- (NSUInteger)getNodeSymbol { return [self->document symbolOfNode:self->node]; }
+
+- (unsigned short)getNodeType { return [self->document typeOfNode:self->node]; }
+
+- (NSString *)getNodeValue { return [self->document valueOfNode:self->node]; }
+
+- (id<ESXPNode>)getParentNode { return [self->document nodeAt:[self->document parentOfNode:self->node]]; }
+
+- (BOOL)hasAttributes { return [self->document attributeCountOfNode:self->node] > 0; }
+
+- (BOOL)hasChildNodes { return [self->document firstChildOfNode:self->node] != NSNotFound; }
+
+- (BOOL)isDefaultNamespace:(NSString *)namespaceURI { return false; }
+
+- (BOOL)isEqualNode:(id<ESXPNode>)other { return [self isEqual:other]; }
+
+- (BOOL)isSameNode:(id<ESXPNode>)other { return [self isEqual:other]; }
+
+- (NSString *)lookupNamespaceURI:(NSString *)prefix { return @""; }
+
+- (void)normalize { /* Do nothing, this document is read-only. */ }
+
+- (NSString *)printNode:(int)indent
+{
+    // Build indent
+    NSMutableString *padding = [NSMutableString new];
+    for (int i = 0; i < indent; ++i)
+        [padding appendString:@"\t"];
+    
+    // Build string
+    NSMutableString *string = [[self description] mutableCopy];
+    for (NSUInteger child = [self->document firstChildOfNode:self->node]; child != NSNotFound; child = [self->document nextSiblingOfNode:child])
+        [string appendString:[NSString stringWithFormat:@"%@%@", padding, [[self->document nodeAt:child] printNode:indent + 1]]];
+    
+    return string;
+}
+
+- (id<ESXPNode>)removeChild:(id<ESXPNode>)oldChild { return nil; }
+
+- (id<ESXPNode>)replaceChild:(id<ESXPNode>)newChild oldChild:(id<ESXPNode>)oldChild { return nil; }
+
+- (void)linkSiblings:(id<ESXPNode>)previousSibling next:(id<ESXPNode>)nextSibling { /* Do nothing, the document keeps the links. */ }
+
+- (void)setNodeValue:(NSString *)nodeValue { /* Do nothing, this document is read-only. */ }
+
+// MARK: Methods
+- (NSUInteger)getRow { return self->node; }
+@end
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ESXPDocument.h"
+#import "ESXPProcessor.h"
+#import "ESXPSAX2DOM.h"
+
+/// Turns a parsed document into a result. Runs on a worker thread. The document is dropped
+/// right after, so the result should hold values, not nodes.
+typedef id (^ESXPBatchExtractor)(ESXPDocument *document, ESXPProcessor *processor);
+
+/// Takes the result of an input, or the error that stopped it. Runs on the consumer thread.
+typedef void (^ESXPBatchConsumer)(NSUInteger index, id result, NSError *error);
+
+/// Parses and processes many small documents on a fixed set of threads.
+///
+/// <p>
+/// Inputs (NSData or file paths) are queued with submitData: and submitFile:, parsed with
+/// the native front end by one of the workers and handed to the extractor together with
+/// the worker's own processor. Every worker keeps its builder and processor for its whole
+/// life, so nothing is set up per input. Results go to the consumer, one at a time on a
+/// thread of their own, in submission order or as they complete.
+/// </p>
+///
+/// <p>
+/// At most maxPending inputs are in the batch at any time, counting from submission until
+/// the consumer returns. Once it is full, submitting blocks until the consumer catches up,
+/// so a slow consumer slows the producer down instead of piling up documents. The
+/// consumer must therefore never submit to its own batch.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPBatchProcessor : NSObject
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern. The workers start right away.
+///
+/// \param workers    The count of worker threads, 0 for one per core.
+/// \param maxPending The maximum count of inputs in the batch at any time.
+/// \param ordered    YES to deliver results in submission order, NO as they complete.
+/// \param maxNodes   The maximum number of nodes of a document. Only a hint.
+/// \param extractor  Turns every document into a result.
+/// \param consumer   Takes every result.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPBatchProcessor *)newBuild:(NSUInteger)workers maxPending:(NSUInteger)maxPending ordered:(BOOL)ordered maxNodes:(NSUInteger)maxNodes extractor:(ESXPBatchExtractor)extractor consumer:(ESXPBatchConsumer)consumer;
+
+// MARK: Methods
+/// Queues an input in memory. Blocks while the batch is full.<br/>
+/// <b>Throws:</b> BatchClosedException: If the batch was already finished.
+///
+/// \param data The XML.
+///
+/// \return The index of the input, in submission order starting at 0.
+- (NSUInteger)submitData:(NSData *)data;
+
+/// Queues a file. Blocks while the batch is full.<br/>
+/// <b>Throws:</b> BatchClosedException: If the batch was already finished.
+///
+/// \param path The path of the XML file.
+///
+/// \return The index of the input, in submission order starting at 0.
+- (NSUInteger)submitFile:(NSString *)path;
+
+/// Closes the batch and waits until every input submitted was consumed. The threads end.
+- (void)finish;
+@end
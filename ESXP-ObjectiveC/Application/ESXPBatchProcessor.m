@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ESXPBatchProcessor.h"
+#import "ESXPConstants.h"
+
+/// An input on its way through the batch, and later its result.
+@interface ESXPBatchItem : NSObject
+@property (nonatomic, assign) NSUInteger index;  // The submission order.
+@property (nonatomic, strong) id         input;  // NSData, or an NSString with a path. Dropped once parsed.
+@property (nonatomic, strong) id         result; // What the extractor returned.
+@property (nonatomic, strong) NSError    *error; // Why there is no result.
+@end
+
+@implementation ESXPBatchItem
+@end
+
+/// State shared between the batch and its threads. It lives apart from the batch so the
+/// threads never keep the batch alive.
+@interface ESXPBatchState : NSObject
+@property (nonatomic, strong) NSCondition         *condition; // Guards everything below, signaled on every change.
+@property (nonatomic, strong) NSMutableArray      *inputs;    // The items waiting for a worker.
+@property (nonatomic, strong) NSMutableDictionary *finished;  // Ordered mode: the items waiting for the consumer, by index.
+@property (nonatomic, strong) NSMutableArray      *completed; // Unordered mode: the items waiting for the consumer.
+@property (nonatomic, assign) NSUInteger          submitted;  // The count of items submitted.
+@property (nonatomic, assign) NSUInteger          delivered;  // The count of items consumed.
+@property (nonatomic, assign) NSUInteger          maxPending;
+@property (nonatomic, assign) BOOL                ordered;
+@property (nonatomic, assign) BOOL                closed;
+@end
+
+@implementation ESXPBatchState
+@end
+
+// MARK: Threads
+/// The loop of a worker thread: takes inputs until the batch is closed and empty.
+static void ESXPBatchWork(ESXPBatchState *st, NSUInteger maxNodes, ESXPBatchExtractor extractor)
+{
+    ESXPSAX2DOM   *builder   = [ESXPSAX2DOM newBuild:maxNodes];
+    ESXPProcessor *processor = [ESXPProcessor newBuild:maxNodes];
+    for (;;) {
+        [st.condition lock];
+        while ([st.inputs count] == 0 && !st.closed)
+            [st.condition wait];
+        
+        ESXPBatchItem *item = [st.inputs firstObject];
+        if (item != nil)
+            [st.inputs removeObjectAtIndex:0];
+        [st.condition unlock];
+        
+        if (item == nil)
+            return;
+        
+        @autoreleasepool {
+            NSError *error = nil;
+            BOOL    parsed = [item.input isKindOfClass:[NSString class]]
+                ? [builder parseFile:item.input frontEnd:FRONTEND_NATIVE error:&error]
+                : [builder parseData:item.input frontEnd:FRONTEND_NATIVE error:&error];
+            item.input = nil;
+            
+            if (parsed) {
+                @try {
+                    item.result = extractor([builder getDOM], processor);
+                }
+                @catch (NSException *exception) {
+                    NSString     *domain   = @"net.apkc.projects.ErrorDomain";
+                    NSString     *desc     = NSLocalizedString(exception.reason, @"");
+                    NSDictionary *userInfo = @{ NSLocalizedDescriptionKey : desc };
+                    error = [NSError errorWithDomain:domain code:BATCH_EXTRACTION_ERROR userInfo:userInfo];
+                }
+            }
+            item.error = error;
+            
+            // The document is not needed any more, only the result is kept.
+            [builder reset];
+        }
+        
+        [st.condition lock];
+        if (st.ordered)
+            [st.finished setObject:item forKey:@(item.index)];
+        else
+            [st.completed addObject:item];
+        [st.condition broadcast];
+        [st.condition unlock];
+    }
+}
+
+/// The loop of the consumer thread: hands results over until the batch is closed and
+/// everything submitted was delivered.
+static void ESXPBatchConsume(ESXPBatchState *st, ESXPBatchConsumer consumer)
+{
+    for (;;) {
+        ESXPBatchItem *item = nil;
+        
+        [st.condition lock];
+        for (;;) {
+            if (st.ordered) {
+                item = [st.finished objectForKey:@(st.delivered)];
+                if (item != nil)
+                    [st.finished removeObjectForKey:@(st.delivered)];
+            }
+            else {
+                item = [st.completed firstObject];
+                if (item != nil)
+                    [st.completed removeObjectAtIndex:0];
+            }
+            
+            if (item != nil || (st.closed && st.delivered == st.submitted))
+                break;
+            
+            [st.condition wait];
+        }
+        [st.condition unlock];
+        
+        if (item == nil)
+            return;
+        
+        @autoreleasepool {
+            consumer(item.index, item.result, item.error);
+        }
+        
+        [st.condition lock];
+        st.delivered = st.delivered + 1;
+        [st.condition broadcast];
+        [st.condition unlock];
+    }
+}
+@interface ESXPBatchProcessor ()
+{
+    ESXPBatchState *state;
+}
+@end
+
+@implementation ESXPBatchProcessor
+// MARK: Builders
++ (ESXPBatchProcessor *)newBuild:(NSUInteger)workers maxPending:(NSUInteger)maxPending ordered:(BOOL)ordered maxNodes:(NSUInteger)maxNodes extractor:(ESXPBatchExtractor)extractor consumer:(ESXPBatchConsumer)consumer
+{
+    ESXPBatchProcessor *instance = [[ESXPBatchProcessor alloc] init];
+    if (instance) {
+        if (workers == 0)
+            workers = [[NSProcessInfo processInfo] activeProcessorCount];
+        
+        ESXPBatchState *st = [ESXPBatchState new];
+        st.condition       = [NSCondition new];
+        st.inputs          = [NSMutableArray new];
+        st.finished        = [NSMutableDictionary new];
+        st.completed       = [NSMutableArray new];
+        st.maxPending      = MAX(maxPending, (NSUInteger) 1);
+        st.ordered         = ordered;
+        instance->state    = st;
+        
+        for (NSUInteger i = 0; i < workers; i++)
+            [[[NSThread alloc] initWithBlock:^{ ESXPBatchWork(st, maxNodes, extractor); }] start];
+        
+        [[[NSThread alloc] initWithBlock:^{ ESXPBatchConsume(st, consumer); }] start];
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc { [self close]; }
+
+// MARK: Methods
+- (NSUInteger)submitData:(NSData *)data { return [self submit:data]; }
+
+- (NSUInteger)submitFile:(NSString *)path { return [self submit:[path copy]]; }
+
+- (void)finish
+{
+    ESXPBatchState *st = self->state;
+    [self close];
+    
+    [st.condition lock];
+    while (st.delivered < st.submitted)
+        [st.condition wait];
+    [st.condition unlock];
+}
+
+// MARK: Private Methods
+- (NSUInteger)submit:(id)input
+{
+    ESXPBatchState *st   = self->state;
+    ESXPBatchItem  *item = [ESXPBatchItem new];
+    item.input = input;
+    
+    [st.condition lock];
+    while (!st.closed && st.submitted - st.delivered >= st.maxPending)
+        [st.condition wait];
+    
+    if (st.closed) {
+        [st.condition unlock];
+        @throw [NSException exceptionWithName:@"BatchClosedException"
+                                       reason:@"The batch was already finished."
+                                     userInfo:nil];
+    }
+    
+    item.index   = st.submitted;
+    st.submitted = st.submitted + 1;
+    [st.inputs addObject:item];
+    [st.condition broadcast];
+    [st.condition unlock];
+    
+    return item.index;
+}
+
+- (void)close
+{
+    [self->state.condition lock];
+    self->state.closed = YES;
+    [self->state.condition broadcast];
+    [self->state.condition unlock];
+}
+@end
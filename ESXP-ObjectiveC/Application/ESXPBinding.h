@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ESXPDocument.h"
+#import "ESXPFieldSet.h"
+#import "ESXPNameTable.h"
+#import "ESXPNode.h"
+#import "ESXPSAX2DOM.h"
+
+/// Block called for every object bound while streaming.
+///
+/// \param object The object bound from a record.
+/// \param stop   Set to YES to abort the parsing after this object.
+typedef void (^ESXPObjectHandler)(id object, BOOL *stop);
+
+/// Binds XML records to Objective-C objects.
+///
+/// <p>
+/// A binding maps fields of a record (see ESXPFieldSet) to properties of a class. The
+/// mapping is declared once: the setter of every property is looked up when it is bound
+/// and its implementation cached, so binding a record is one traversal to collect the
+/// values plus one direct call per property, with no string comparisons, KVC or message
+/// lookups. Properties must take an NSString.
+/// </p>
+///
+/// <p>
+/// A binding works on built documents with bind:nameTable: and bindAll:recordName:, and
+/// on records as they are parsed by handing recordHandler: to ESXPSAX2DOM.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPBinding : NSObject
+{
+    Class        targetClass; // The class of the objects bound.
+    ESXPFieldSet *fields;     // The fields of the record, one per property.
+    SEL          *setters;    // The setter of each property.
+    IMP          *imps;       // The cached implementation of each setter.
+}
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param targetClass The class of the objects to bind. Created with alloc/init.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPBinding *)newBuild:(Class)targetClass;
+
+// MARK: Methods
+/// Maps a field of the record to a property.
+/// <b>Throws:</b> InvalidBindingException: If the class has no setter for the property.
+///
+/// \param property  The name of the property, i.e. "title".
+/// \param name      The name of the element.
+/// \param parent    The name of the parent of the element, or nil for any parent.
+/// \param attribute The attribute to take, or nil to take the text of the element.
+- (void)bindProperty:(NSString *)property name:(NSString *)name parent:(NSString *)parent attribute:(NSString *)attribute;
+
+/// Binds a record to a new object.
+///
+/// \param node      The record element. Only its descendants are matched.
+/// \param nameTable The name table of the document of the node.
+///
+/// \return A new object of the target class.
+- (id)bind:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable;
+
+/// Binds all records of a document, using the tag index if the document has one.
+///
+/// \param doc        The XML document.
+/// \param recordName The name of the record elements, i.e. "page".
+///
+/// \return The objects bound, in document order.
+- (NSArray *)bindAll:(ESXPDocument *)doc recordName:(NSString *)recordName;
+
+/// Returns a record handler for ESXPSAX2DOM in streaming mode, which binds every record
+/// as soon as it is parsed and hands the object over.
+///
+/// \param handler The block to call for every object.
+///
+/// \return The record handler.
+- (ESXPRecordHandler)recordHandler:(ESXPObjectHandler)handler;
+@end
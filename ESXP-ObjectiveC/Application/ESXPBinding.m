@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <objc/runtime.h>
+#import "ESXPBinding.h"
+#import "ESXPConstants.h"
+
+/// The signature of an object setter.
+typedef void (*ESXPSetter)(id object, SEL selector, id value);
+
+@implementation ESXPBinding
+// MARK: Builders
++ (ESXPBinding *)newBuild:(Class)targetClass
+{
+    ESXPBinding *instance = [[ESXPBinding alloc] init];
+    if (instance) {
+        instance->targetClass = targetClass;
+        instance->fields      = [ESXPFieldSet newBuild];
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc
+{
+    free(self->setters);
+    free(self->imps);
+}
+
+// MARK: Methods
+- (void)bindProperty:(NSString *)property name:(NSString *)name parent:(NSString *)parent attribute:(NSString *)attribute
+{
+    SEL setter = [self setterFor:property];
+    if (setter == NULL || ![self->targetClass instancesRespondToSelector:setter])
+        @throw [NSException exceptionWithName:@"InvalidBindingException"
+                                       reason:[NSString stringWithFormat:@"The class \"%@\" has no setter for \"%@\".", NSStringFromClass(self->targetClass), property]
+                                     userInfo:nil];
+    
+    NSUInteger index = [self->fields addField:name parent:parent attribute:attribute];
+    self->setters        = realloc(self->setters, (index + 1) * sizeof(SEL));
+    self->imps           = realloc(self->imps, (index + 1) * sizeof(IMP));
+    self->setters[index] = setter;
+    self->imps[index]    = [self->targetClass instanceMethodForSelector:setter];
+}
+
+- (id)bind:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable
+{
+    id         object = [[self->targetClass alloc] init];
+    NSArray    *values = [self->fields extract:node nameTable:nameTable];
+    NSUInteger count   = [values count];
+    
+    for (NSUInteger i = 0; i < count; i++)
+        ((ESXPSetter) self->imps[i])(object, self->setters[i], [values objectAtIndex:i]);
+    
+    return object;
+}
+
+- (NSArray *)bindAll:(ESXPDocument *)doc recordName:(NSString *)recordName
+{
+    NSArray        *records = [doc getElementsByTagName:recordName];
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:[records count]];
+    ESXPNameTable  *table   = [doc getNameTable];
+    
+    for (id<ESXPNode> record in records)
+        [objects addObject:[self bind:record nameTable:table]];
+    
+    return objects;
+}
+
+- (ESXPRecordHandler)recordHandler:(ESXPObjectHandler)handler
+{
+    return ^(ESXPDocument *record, BOOL *stop) {
+        // The record element is the only element under the root of the record document.
+        for (id<ESXPNode> node in [[record getRootNode] getChildNodes]) {
+            if ([node getNodeType] == ELEMENT_NODE) {
+                handler([self bind:node nameTable:[record getNameTable]], stop);
+                break;
+            }
+        }
+    };
+}
+
+// MARK: Private Methods
+- (SEL)setterFor:(NSString *)property
+{
+    // A custom setter declared with the property wins over the default name.
+    objc_property_t declared = class_getProperty(self->targetClass, [property UTF8String]);
+    if (declared != NULL) {
+        char *custom = property_copyAttributeValue(declared, "S");
+        if (custom != NULL) {
+            SEL setter = sel_registerName(custom);
+            free(custom);
+            return setter;
+        }
+    }
+    
+    if ([property length] == 0)
+        return NULL;
+    
+    NSString *first = [[property substringToIndex:1] uppercaseString];
+    return NSSelectorFromString([NSString stringWithFormat:@"set%@%@:", first, [property substringFromIndex:1]]);
+}
+@end
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ESXPConstants.h"
+
+/// Reads a file, compressed with gzip or bzip2 or not compressed at all, on a thread of
+/// its own.
+///
+/// <p>
+/// The reading thread decompresses the file into chunks of a fixed size and hands them
+/// over through a ring of a few chunks. It waits while the ring is full, and nextChunk:
+/// waits while it is empty, so decompressing and parsing overlap and the memory used
+/// stays at about chunkSize * chunkCount, whatever the size of the file. Nothing is
+/// written to disk. The format is told by the first bytes of the file, and files made
+/// of many gzip members or bzip2 streams (i.e. the multistream MediaWiki dumps) are read
+/// through to the end.
+/// </p>
+///
+/// <p>
+/// Chunks must be taken by a single thread. A reader that is not read to the end must be
+/// closed, or its thread waits for room in the ring forever.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPCompressedReader : NSObject
+// MARK: Builders
+/// Builder of new instances with chunks of 1 MiB and a ring of 4 chunks. Follows the
+/// Builder Pattern.
+///
+/// \param path The path of the file.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPCompressedReader *)newBuild:(NSString *)path;
+
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param path       The path of the file.
+/// \param chunkSize  The count of decompressed bytes in a chunk.
+/// \param chunkCount The count of chunks the ring holds before the reading thread waits.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPCompressedReader *)newBuild:(NSString *)path chunkSize:(NSUInteger)chunkSize chunkCount:(NSUInteger)chunkCount;
+
+// MARK: Methods
+/// Opens the file, tells its format and starts the reading thread.
+///
+/// \param error Set if the file can not be opened.
+///
+/// \return YES if the reading thread was started.
+- (BOOL)open:(NSError **)error;
+
+/// Takes the next chunk, waiting for the reading thread if none is ready.
+///
+/// \param error Set if the file could not be read or decompressed.
+///
+/// \return The next chunk of decompressed bytes, or nil at the end of the file or on error.
+- (NSData *)nextChunk:(NSError **)error;
+
+/// Stops the reading thread and drops the chunks not taken. Can be called at any time.
+- (void)close;
+
+/// Returns the compression of the file, once opened.
+///
+/// \return The compression of the file.
+- (Compressions)getCompression;
+@end
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <bzlib.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <pthread.h>
+#import <unistd.h>
+#import <zlib.h>
+#import "ESXPCompressedReader.h"
+
+static NSUInteger const kINPUT_SIZE = 256 * 1024; // The compressed bytes read from the file at once.
+
+@interface ESXPCompressedReader ()
+{
+    NSString        *path;        // The path of the file.
+    int             fd;           // The file while the reading thread runs, -1 otherwise.
+    Compressions    compression;  // The format of the file.
+    NSUInteger      chunkSize;    // The count of decompressed bytes in a chunk.
+    NSUInteger      chunkCount;   // The count of chunks the ring holds.
+    
+    NSMutableArray  *ring;        // The chunks decompressed and not taken yet, oldest first.
+    BOOL            done;         // If the reading thread ended.
+    BOOL            cancelled;    // If close was called.
+    NSError         *failure;     // The error the reading thread ended with, if any.
+    pthread_mutex_t lock;
+    pthread_cond_t  changed;      // Signaled when a chunk is added or taken, or the reading ends.
+}
+@end
+
+@implementation ESXPCompressedReader
+// MARK: Builders
++ (ESXPCompressedReader *)newBuild:(NSString *)path { return [ESXPCompressedReader newBuild:path chunkSize:1024 * 1024 chunkCount:4]; }
+
++ (ESXPCompressedReader *)newBuild:(NSString *)path chunkSize:(NSUInteger)chunkSize chunkCount:(NSUInteger)chunkCount
+{
+    ESXPCompressedReader *instance = [[ESXPCompressedReader alloc] init];
+    if (instance) {
+        instance->path       = [path copy];
+        instance->fd         = -1;
+        instance->chunkSize  = MAX(chunkSize, (NSUInteger) 4096);
+        instance->chunkCount = MAX(chunkCount, (NSUInteger) 1);
+        instance->ring       = [NSMutableArray new];
+        pthread_mutex_init(&instance->lock, NULL);
+        pthread_cond_init(&instance->changed, NULL);
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc
+{
+    pthread_cond_destroy(&self->changed);
+    pthread_mutex_destroy(&self->lock);
+}
+
+// MARK: Methods
+- (BOOL)open:(NSError **)error
+{
+    self->fd = open([self->path fileSystemRepresentation], O_RDONLY);
+    if (self->fd < 0) {
+        NSError *cause = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        if (error != NULL)
+            *error = [self error:XMLPARSER_NIL_DOCUMENT reason:NSLocalizedString(@"No se pudo leer el archivo.", @"") underlying:cause];
+        
+        return NO;
+    }
+    
+    unsigned char magic[3] = { 0, 0, 0 };
+    if (pread(self->fd, magic, sizeof(magic), 0) == sizeof(magic)) {
+        if (magic[0] == 0x1F && magic[1] == 0x8B)
+            self->compression = COMPRESSION_GZIP;
+        else if (magic[0] == 'B' && magic[1] == 'Z' && magic[2] == 'h')
+            self->compression = COMPRESSION_BZIP2;
+    }
+    
+    // The thread keeps this reader until it ends.
+    [NSThread detachNewThreadSelector:@selector(run) toTarget:self withObject:nil];
+    return YES;
+}
+
+- (NSData *)nextChunk:(NSError **)error
+{
+    NSData *chunk = nil;
+    
+    pthread_mutex_lock(&self->lock);
+    while ([self->ring count] == 0 && !self->done && !self->cancelled)
+        pthread_cond_wait(&self->changed, &self->lock);
+    
+    if ([self->ring count] > 0) {
+        chunk = [self->ring objectAtIndex:0];
+        [self->ring removeObjectAtIndex:0];
+        pthread_cond_broadcast(&self->changed);
+    }
+    else if (self->failure != nil && error != NULL) {
+        *error = self->failure;
+    }
+    pthread_mutex_unlock(&self->lock);
+    
+    return chunk;
+}
+
+- (void)close
+{
+    pthread_mutex_lock(&self->lock);
+    self->cancelled = YES;
+    [self->ring removeAllObjects];
+    pthread_cond_broadcast(&self->changed);
+    pthread_mutex_unlock(&self->lock);
+}
+
+- (Compressions)getCompression { return self->compression; }
+
+// MARK: Private Methods
+/// The reading thread: reads the file, decompresses it and fills the ring until the end
+/// of the file, an error or close.
+- (void)run
+{
+    @autoreleasepool {
+        char          *input    = malloc(kINPUT_SIZE);
+        NSMutableData *chunk    = [NSMutableData dataWithLength:self->chunkSize];
+        NSUInteger    filled    = 0;     // The bytes of the chunk already decompressed.
+        const char    *next     = input; // The compressed bytes not decompressed yet.
+        NSUInteger    available = 0;
+        BOOL          ended     = NO;    // If the whole file was read.
+        BOOL          complete  = YES;   // If the last gzip member or bzip2 stream was read to its end.
+        NSError       *error    = nil;
+        z_stream      zip;
+        bz_stream     bzip;
+        memset(&zip, 0, sizeof(zip));
+        memset(&bzip, 0, sizeof(bzip));
+        
+        BOOL started = (self->compression == COMPRESSION_GZIP) ? inflateInit2(&zip, 15 + 16) == Z_OK
+                     : (self->compression == COMPRESSION_BZIP2) ? BZ2_bzDecompressInit(&bzip, 0, 0) == BZ_OK
+                     : YES;
+        if (!started)
+            error = [self error:DECOMPRESSION_ERROR reason:NSLocalizedString(@"No se pudo descomprimir el archivo.", @"") underlying:nil];
+        
+        while (error == nil && !self->cancelled) {
+            if (available == 0 && !ended) {
+                ssize_t count = read(self->fd, input, kINPUT_SIZE);
+                if (count < 0 && errno == EINTR)
+                    continue;
+                
+                if (count < 0) {
+                    NSError *cause = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+                    error = [self error:XMLPARSER_NIL_DOCUMENT reason:NSLocalizedString(@"No se pudo leer el archivo.", @"") underlying:cause];
+                    break;
+                }
+                
+                ended     = (count == 0);
+                next      = input;
+                available = count;
+            }
+            
+            if (available == 0) {
+                if (!complete)
+                    error = [self error:DECOMPRESSION_ERROR reason:NSLocalizedString(@"El archivo comprimido esta incompleto.", @"") underlying:nil];
+                break;
+            }
+            
+            // Decompress as much as fits in the chunk.
+            char       *out   = (char *) [chunk mutableBytes] + filled;
+            NSUInteger space  = self->chunkSize - filled;
+            NSUInteger used   = 0;
+            NSUInteger made   = 0;
+            BOOL       broken = NO;
+            switch (self->compression) {
+                case COMPRESSION_GZIP: {
+                    // A member ended on the previous pass and more bytes follow: start the next one.
+                    if (complete && zip.total_in > 0)
+                        inflateReset(&zip);
+                    
+                    zip.next_in   = (Bytef *) next;
+                    zip.avail_in  = (uInt) available;
+                    zip.next_out  = (Bytef *) out;
+                    zip.avail_out = (uInt) space;
+                    int status = inflate(&zip, Z_NO_FLUSH);
+                    used     = available - zip.avail_in;
+                    made     = space - zip.avail_out;
+                    complete = (status == Z_STREAM_END);
+                    broken   = (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR);
+                    break;
+                }
+                case COMPRESSION_BZIP2: {
+                    if (complete && bzip.total_in_lo32 + bzip.total_in_hi32 > 0) {
+                        BZ2_bzDecompressEnd(&bzip);
+                        memset(&bzip, 0, sizeof(bzip));
+                        broken = BZ2_bzDecompressInit(&bzip, 0, 0) != BZ_OK;
+                    }
+                    
+                    bzip.next_in   = (char *) next;
+                    bzip.avail_in  = (unsigned int) available;
+                    bzip.next_out  = out;
+                    bzip.avail_out = (unsigned int) space;
+                    int status = broken ? BZ_MEM_ERROR : BZ2_bzDecompress(&bzip);
+                    used     = available - bzip.avail_in;
+                    made     = space - bzip.avail_out;
+                    complete = (status == BZ_STREAM_END);
+                    broken   = (status != BZ_OK && status != BZ_STREAM_END);
+                    break;
+                }
+                default: {
+                    used = MIN(available, space);
+                    made = used;
+                    memcpy(out, next, used);
+                    break;
+                }
+            }
+            
+            if (broken || (used == 0 && made == 0 && !complete)) {
+                error = [self error:DECOMPRESSION_ERROR reason:NSLocalizedString(@"No se pudo descomprimir el archivo.", @"") underlying:nil];
+                break;
+            }
+            
+            next      += used;
+            available -= used;
+            filled    += made;
+            if (filled == self->chunkSize) {
+                if (![self put:chunk])
+                    break;
+                
+                chunk  = [NSMutableData dataWithLength:self->chunkSize];
+                filled = 0;
+            }
+        }
+        
+        if (error == nil && filled > 0) {
+            [chunk setLength:filled];
+            [self put:chunk];
+        }
+        
+        if (self->compression == COMPRESSION_GZIP)
+            inflateEnd(&zip);
+        else if (self->compression == COMPRESSION_BZIP2)
+            BZ2_bzDecompressEnd(&bzip);
+        free(input);
+        close(self->fd);
+        self->fd = -1;
+        
+        pthread_mutex_lock(&self->lock);
+        self->done    = YES;
+        self->failure = error;
+        pthread_cond_broadcast(&self->changed);
+        pthread_mutex_unlock(&self->lock);
+    }
+}
+
+/// Adds a chunk to the ring, waiting for room.
+///
+/// \param chunk The chunk.
+///
+/// \return NO if the reader was closed meanwhile.
+- (BOOL)put:(NSData *)chunk
+{
+    pthread_mutex_lock(&self->lock);
+    while ([self->ring count] >= self->chunkCount && !self->cancelled)
+        pthread_cond_wait(&self->changed, &self->lock);
+    
+    BOOL added = !self->cancelled;
+    if (added) {
+        [self->ring addObject:chunk];
+        pthread_cond_broadcast(&self->changed);
+    }
+    pthread_mutex_unlock(&self->lock);
+    
+    return added;
+}
+
+- (NSError *)error:(ErrorCodes)code reason:(NSString *)reason underlying:(NSError *)cause
+{
+    NSMutableDictionary *userInfo = [@{ NSLocalizedDescriptionKey : reason } mutableCopy];
+    if (cause != nil)
+        [userInfo setObject:cause forKey:NSUnderlyingErrorKey];
+    
+    if (kDEBUG)
+        NSLog(@"ERROR ==> %@ (%@)", reason, [cause localizedDescription]);
+    
+    return [NSError errorWithDomain:@"net.apkc.projects.ErrorDomain" code:code userInfo:userInfo];
+}
+@end
@@ -35,6 +35,37 @@ typedef NS_OPTIONS(int, ErrorCodes)
     // XML PARSER
     XMLPARSER_SAX2DOM_ERROR = -90, // Called when there was an error converting from SAX to DOM.
     XMLPARSER_NIL_DOCUMENT  = -91, // Called when trying to parse an empty document.
+    XMLPARSER_MALFORMED_XML = -92, // Called when the native tokenizer finds XML that is not well formed.
+    // QUERY
+    QUERY_INVALID_EXPRESSION = -93, // Called when a query expression can not be compiled.
+    // BATCH
+    BATCH_EXTRACTION_ERROR   = -94, // Called when the extractor of a batch throws an exception.
+    // SNAPSHOT
+    SNAPSHOT_WRITE_ERROR     = -95, // Called when a snapshot can not be written.
+    SNAPSHOT_INVALID         = -96, // Called when a file is not a snapshot this version can load.
+    // SERIALIZER
+    SERIALIZER_WRITE_ERROR   = -97, // Called when the output of a serializer can not be written.
+    // LIMITS
+    PARSE_BUDGET_EXCEEDED    = -98, // Called when a document grows past the byte budget of its builder.
+    PARSE_DEPTH_EXCEEDED     = -99, // Called when elements nest deeper than the depth limit of the builder.
+    // DECOMPRESSION
+    DECOMPRESSION_ERROR      = -100, // Called when a compressed input is corrupt or cut short.
 };
 
-static BOOL const kDEBUG = NO; // If mode debug is on/off.
+typedef NS_ENUM(int, FrontEnds)
+{
+    FRONTEND_NSXMLPARSER = 0, // Events come from NSXMLParser.
+    FRONTEND_NATIVE      = 1, // Events come from ESXPTokenizer over a memory mapped buffer.
+};
+
+typedef NS_ENUM(int, Compressions)
+{
+    COMPRESSION_NONE  = 0, // The input is read as it is.
+    COMPRESSION_GZIP  = 1, // The input is inflated with zlib.
+    COMPRESSION_BZIP2 = 2, // The input is decompressed with libbz2.
+};
+
+static BOOL       const kDEBUG              = NO;    // If mode debug is on/off.
+static NSUInteger const kNO_SYMBOL          = 0;     // The symbol of a name that was never interned.
+static NSUInteger const kOBJECT_BYTES       = 16;    // The bytes assumed for an object header in footprints.
+static NSUInteger const kPUSH_COMPACT_BYTES = 65536; // The tokenized bytes a push buffer keeps before dropping them.
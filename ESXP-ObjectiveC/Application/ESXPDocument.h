@@ -27,14 +27,77 @@
 #import <Foundation/Foundation.h>
 #import "ESXPDocument.h"
 #import "ESXPElement.h"
+#import "ESXPNameTable.h"
+#import "ESXPTextBuffer.h"
+
+/// Counts describing a document. The root node is not counted.
+typedef struct ESXPDocumentStatistics
+{
+    uint64_t elementCount;   // The count of element nodes.
+    uint64_t textNodeCount;  // The count of text nodes.
+    uint64_t attributeCount; // The count of attributes.
+    uint64_t textBytes;      // The UTF-8 bytes of all text. Lazy values count as found in the input.
+    uint64_t maxDepth;       // The depth of the deepest element, 1 for the document element.
+} ESXPDocumentStatistics;
+
+/// Bytes allocated for a document, by what they hold. Estimates: objects are counted at
+/// their instance size and strings at kOBJECT_BYTES plus their UTF-8 bytes.
+typedef struct ESXPDocumentFootprint
+{
+    uint64_t nodeBytes;      // The node objects and their places in the lists of children.
+    uint64_t nameBytes;      // The name table, counted in full by every document sharing it.
+    uint64_t textBytes;      // Decoded text. Lazy values stay in the input and count nothing until decoded.
+    uint64_t attributeBytes; // Attribute values, or their ranges in the input while lazy.
+} ESXPDocumentFootprint;
+
+/// Returns the bytes of a footprint altogether.
+static inline uint64_t ESXPFootprintTotal(ESXPDocumentFootprint footprint) { return footprint.nodeBytes + footprint.nameBytes + footprint.textBytes + footprint.attributeBytes; }
 
 /// Class for representing a DOM Document.
 ///
+/// <p>
+/// A document can keep a tag index: for every element name, the elements with that
+/// name in document order. It is built with indexTags, or while parsing when the
+/// builder is asked to, and makes getElementsByTagName: a lookup instead of a walk of
+/// the tree. The index is not updated when the tree is changed by hand afterwards,
+/// call indexTags again to rebuild it.
+/// </p>
+///
+/// <p>
+/// Builders keep the statistics of the documents they build (see ESXPDocumentStatistics)
+/// up to date as nodes are added, so getStatistics costs nothing. For other documents
+/// they are counted on the first call. Like the tag index, they do not follow changes
+/// made by hand, call countStatistics to count them again. The footprint of the document
+/// (see ESXPDocumentFootprint) is kept the same way, and estimated from the statistics
+/// for documents no builder kept it for.
+/// </p>
+///
+/// <p>
+/// A document can be frozen once it is built. Freezing decodes every lazy value, so that
+/// reading a frozen document never writes to it, and from then on normalize and the tag
+/// index methods throw a FrozenDocumentException. A frozen document can be read by any
+/// number of threads at the same time.
+/// </p>
+///
+/// <p>
+/// Builders asked for compact text store the decoded text of a document as UTF-8 in its
+/// ESXPTextBuffer, see ESXPText.
+/// </p>
+///
 /// \author Andreas P. Koenzen <akc at apkc.net>
 /// \see    Builder Pattern
 @interface ESXPDocument : NSObject
 {
-    ESXPElement *root; // The root node of this document.
+    ESXPElement    *root;       // The root node of this document.
+    ESXPNameTable  *nameTable;  // The names used in this document.
+    NSMutableArray *tagIndex;   // The elements of each name, indexed by symbol. Nil if there is no index.
+    BOOL           frozen;      // If this document can no longer be changed.
+    ESXPTextBuffer *textBuffer; // The UTF-8 bytes of the text built into this document. Nil until first asked for.
+    
+    ESXPDocumentStatistics statistics;     // The statistics of this document.
+    BOOL                   statisticsKept; // If statistics is up to date, otherwise it is counted when asked for.
+    ESXPDocumentFootprint  footprint;      // The bytes of this document, but for the name table.
+    BOOL                   footprintKept;  // If footprint is up to date, otherwise it is estimated when asked for.
 }
 
 // MARK: Builders
@@ -45,6 +108,15 @@
 /// \return A new instance of ESXPNode if available, otherwise return NIL.
 + (ESXPDocument *)newBuild:(NSString *)name;
 
+/// Builder of new instances sharing a name table. Follows the Builder Pattern.
+///
+/// \param name      The name of the node.
+/// \param nameTable The name table to intern names into. Documents sharing a table
+///                  share the symbols of their names.
+///
+/// \return A new instance of ESXPNode if available, otherwise return NIL.
++ (ESXPDocument *)newBuild:(NSString *)name nameTable:(ESXPNameTable *)nameTable;
+
 // MARK: Methods
 /// Prints this document.
 ///
@@ -65,8 +137,99 @@
 /// \return The root node of this document.
 - (ESXPElement *)getRootNode;
 
+/// Returns the name table of this document.
+///
+/// \return The name table of this document.
+- (ESXPNameTable *)getNameTable;
+
+/// Builds the tag index from the current tree, replacing any previous one.
+- (void)indexTags;
+
+/// Adds an element to the end of the postings of its name. Used by builders which add
+/// elements in document order. Does nothing if this document has no tag index.
+///
+/// \param element The element, already part of this document.
+- (void)indexElement:(ESXPElement *)element;
+
+/// Returns YES if this document has a tag index.
+///
+/// \return YES if this document has a tag index.
+- (BOOL)hasTagIndex;
+
+/// Returns all elements with a given name, in document order. With a tag index this is
+/// the postings list itself and must not be changed, without one the tree is walked.
+///
+/// \param name The name of the elements.
+///
+/// \return The elements with that name, empty if there are none.
+- (NSArray *)getElementsByTagName:(NSString *)name;
+
+/// Makes this document read-only and safe to share among threads. Does nothing if it
+/// is already frozen.
+- (void)freeze;
+
+/// Returns YES if this document is frozen.
+///
+/// \return YES if this document is frozen.
+- (BOOL)isFrozen;
+
+/// Writes this document to a snapshot file, to be loaded back with
+/// ESXPArenaDocument newBuildFromSnapshot:error:.
+///
+/// \param path  The path of the snapshot. Replaced if it exists.
+/// \param error Set if the file can not be written.
+///
+/// \return YES if the snapshot was written.
+- (BOOL)writeSnapshot:(NSString *)path error:(NSError **)error;
+
+/// Returns the statistics of this document, counting them first if they are not kept.
+///
+/// \return The statistics of this document.
+- (ESXPDocumentStatistics)getStatistics;
+
+/// Counts the statistics of this document walking the tree, and keeps them.
+- (void)countStatistics;
+
+/// Zeroes the statistics and the footprint and keeps them from now on. Used by builders,
+/// which must then report every node they add with countElement:attributes:, countText:
+/// and addFootprint:.
+- (void)keepStatistics;
+
+/// Counts an element added by a builder.
+///
+/// \param depth          The depth of the element, 1 for the document element.
+/// \param attributeCount The count of its attributes.
+- (void)countElement:(NSUInteger)depth attributes:(NSUInteger)attributeCount;
+
+/// Counts a text node added by a builder.
+///
+/// \param length The UTF-8 bytes of the text.
+- (void)countText:(NSUInteger)length;
+
+/// Adds the statistics of nodes moved into this document by a builder.
+///
+/// \param other The statistics of the nodes, as counted in the document they come from.
+/// \param depth The depth, in this document, of the node they were attached to.
+- (void)mergeStatistics:(ESXPDocumentStatistics)other depth:(NSUInteger)depth;
+
+/// Returns the bytes allocated for this document, as kept by its builder or else estimated.
+///
+/// \return The footprint of this document.
+- (ESXPDocumentFootprint)getFootprint;
+
+/// Adds the bytes of nodes added by a builder. The name bytes are ignored, they are read
+/// from the name table.
+///
+/// \param bytes The bytes allocated for the nodes.
+- (void)addFootprint:(ESXPDocumentFootprint)bytes;
+
 /// Returns the count of all element nodes of this document.
 ///
 /// \return The count of all element nodes of this document.
-- (int)getElementNodeCount;
+- (uint64_t)getElementNodeCount;
+
+/// Returns the buffer builders store the text of this document in, see ESXPText.
+///
+/// \return The text buffer of this document.
+- (ESXPTextBuffer *)getTextBuffer;
 @end
@@ -24,18 +24,28 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#import <objc/runtime.h>
+#import "ESXPArenaDocument.h"
 #import "ESXPConstants.h"
 #import "ESXPDocument.h"
+#import "ESXPText.h"
 
 @implementation ESXPDocument
 // MARK: Builders
-+ (ESXPDocument *)newBuild:(NSString *)name
++ (ESXPDocument *)newBuild:(NSString *)name { return [ESXPDocument newBuild:name nameTable:[ESXPNameTable newBuild]]; }
+
++ (ESXPDocument *)newBuild:(NSString *)name nameTable:(ESXPNameTable *)nameTable
 {
     ESXPDocument *instance = [[ESXPDocument alloc] init];
-    if (instance)
-        instance->root = [ESXPElement newBuild:name];
-    else
+    if (instance) {
+        NSString * __unsafe_unretained interned = nil;
+        NSUInteger                    symbol   = [nameTable internName:name interned:&interned];
+        instance->nameTable = nameTable;
+        instance->root      = [ESXPElement newBuild:interned symbol:symbol parentNode:nil];
+    }
+    else {
         return nil;
+    }
     
     return instance;
 }
@@ -56,71 +66,246 @@
 
 - (void)normalize
 {
-    // Logic:
-    // Use recursion to normalize all nodes in the tree.
-    NSMutableArray  *nodeList             = [root getChildNodes];
-    NSMutableArray  *objectsToRemove      = [NSMutableArray new];
-    NSMutableString *normalizedText       = [NSMutableString new];
-    short           firstTextNodePosition = -1;
-    
-    for (id<ESXPNode> child in nodeList) {
-        if ([child getNodeType] == TEXT_NODE) {
-            // Merge all TEXT_NODES together.
-            // Save the position of the first TEXT_NODES in the array.
-            if (firstTextNodePosition < 0)
-                firstTextNodePosition = [nodeList indexOfObject:child];
-            // Now extract the text and mark the TEXT_NODE for removal.
-            [normalizedText appendString:[child getNodeValue]];
-            [objectsToRemove addObject:child];
-            
-            if (kDEBUG)
-                NSLog(@"Normalizing Node ==> %@", [child getNodeName]);
-        }
-    }
+    [self checkNotFrozen];
+    [self->root normalize];
+    self->statisticsKept = NO;
+    self->footprintKept  = NO;
+}
+
+- (NSString *)description { return [NSString stringWithFormat:@"Name: DOMDocument"]; }
+
+- (ESXPElement *)getRootNode { return self->root; }
+
+- (ESXPNameTable *)getNameTable { return self->nameTable; }
+
+- (void)indexTags
+{
+    [self checkNotFrozen];
+    self->tagIndex = [NSMutableArray arrayWithCapacity:[self->nameTable count] + 1];
+    
+    // The root is synthetic and not part of the document, so only what is below it.
+    for (id<ESXPNode> child in [self->root getChildNodes])
+        if ([child getNodeType] == ELEMENT_NODE)
+            [self indexSubtree:(ESXPElement *) child];
+}
+
+- (void)indexElement:(ESXPElement *)element
+{
+    if (self->tagIndex == nil)
+        return;
+    
+    [self checkNotFrozen];
+    NSUInteger symbol = [element getNodeSymbol];
+    if (symbol == kNO_SYMBOL)
+        symbol = [self->nameTable internName:[element getNodeName]];
+    
+    while ([self->tagIndex count] <= symbol)
+        [self->tagIndex addObject:[NSNull null]];
     
-    // Remove the objects.
-    if ([objectsToRemove count] > 0)
-        [nodeList removeObjectsInArray:objectsToRemove];
-    
-    // Now finally add a new TEXT_NODE at first position found, but only if normalization has been done.
-    if (firstTextNodePosition > -1) {
-        ESXPText *mergedTextNode = [ESXPText newBuild:nil];
-        [mergedTextNode setNodeValue:normalizedText];
-        [nodeList insertObject:mergedTextNode atIndex:firstTextNodePosition];
-        if (kDEBUG)
-            NSLog(@"\tMerged Node Result ==> %@", [mergedTextNode getNodeValue]);
+    id postings = [self->tagIndex objectAtIndex:symbol];
+    if (postings == [NSNull null]) {
+        postings = [NSMutableArray new];
+        [self->tagIndex replaceObjectAtIndex:symbol withObject:postings];
     }
     
-    // Drill down more.
-    for (id<ESXPNode> child in nodeList)
-        [child normalize];
+    [postings addObject:element];
 }
 
-- (NSString *)description { return [NSString stringWithFormat:@"Name: DOMDocument"]; }
+- (BOOL)hasTagIndex { return self->tagIndex != nil; }
 
-- (ESXPElement *)getRootNode { return self->root; }
+- (NSArray *)getElementsByTagName:(NSString *)name
+{
+    NSUInteger symbol = [self->nameTable symbolForName:name];
+    if (self->tagIndex != nil) {
+        id postings = (symbol != kNO_SYMBOL && symbol < [self->tagIndex count]) ? [self->tagIndex objectAtIndex:symbol] : nil;
+        return (postings != nil && postings != [NSNull null]) ? postings : @[];
+    }
+    
+    // No index, walk the tree in document order.
+    NSMutableArray *found = [NSMutableArray new];
+    NSMutableArray *nodes = [NSMutableArray arrayWithObject:self->root];
+    while ([nodes count] > 0) {
+        id<ESXPNode> node = [nodes lastObject];
+        [nodes removeLastObject];
+        
+        if (node != self->root && ESXPNodeNamed(node, symbol, name))
+            [found addObject:node];
+        
+        NSArray *children = [node getChildNodes];
+        for (NSInteger i = (NSInteger) [children count] - 1; i >= 0; i--)
+            if ([[children objectAtIndex:i] getNodeType] == ELEMENT_NODE)
+                [nodes addObject:[children objectAtIndex:i]];
+    }
+    
+    return found;
+}
 
-- (int)getElementNodeCount
+- (void)freeze
 {
-    unsigned short  counter  = 0;
-    NSMutableArray *nodeList = [root getChildNodes];
+    if (self->frozen)
+        return;
+    
+    // Count the statistics and decode the lazy values now, readers must never write to the nodes.
+    if (!self->statisticsKept)
+        [self countStatistics];
     
-    for (id<ESXPNode> child in nodeList) {
-        if ([child getNodeType] == ELEMENT_NODE) {
-            counter++;
+    NSMutableArray *nodes = [NSMutableArray arrayWithObject:self->root];
+    while ([nodes count] > 0) {
+        id<ESXPNode> node = [nodes lastObject];
+        [nodes removeLastObject];
+        
+        if ([node getNodeType] == TEXT_NODE) {
+            if (![node isKindOfClass:[ESXPText class]] || [(ESXPText *) node needsDecoding])
+                [node getNodeValue];
+        }
+        else {
+            if ([node hasAttributes])
+                [node getAttributes];
             
-            if (kDEBUG) {
-                NSLog(@"Counting Node ==> %@", [child getNodeName]);
-                NSLog(@"Count ==> %u", counter);
-            }
+            [nodes addObjectsFromArray:[node getChildNodes]];
         }
     }
     
-    // Use recursion to count all nodes in the tree.
-    // Pass the counter as a reference.
-    for (id<ESXPNode> child in nodeList)
-        [child countElementNodes:&counter];
+    self->frozen = YES;
+}
+
+- (BOOL)isFrozen { return self->frozen; }
+
+- (BOOL)writeSnapshot:(NSString *)path error:(NSError **)error { return [[ESXPArenaDocument newBuildFromDocument:self] writeSnapshot:path error:error]; }
+
+- (ESXPDocumentStatistics)getStatistics
+{
+    if (!self->statisticsKept)
+        [self countStatistics];
+    
+    return self->statistics;
+}
+
+- (void)countStatistics
+{
+    ESXPDocumentStatistics counted = { 0, 0, 0, 0, 0 };
+    
+    // Walk the tree with the depth of every node next to it.
+    NSMutableArray *nodes  = [NSMutableArray arrayWithArray:[self->root getChildNodes]];
+    NSMutableArray *depths = [NSMutableArray new];
+    for (NSUInteger i = 0; i < [nodes count]; i++)
+        [depths addObject:@1];
+    
+    while ([nodes count] > 0) {
+        id<ESXPNode> node  = [nodes lastObject];
+        NSUInteger   depth = [[depths lastObject] unsignedIntegerValue];
+        [nodes removeLastObject];
+        [depths removeLastObject];
+        
+        if ([node getNodeType] == TEXT_NODE) {
+            ESXPRange bytes;
+            counted.textNodeCount++;
+            if ([node isKindOfClass:[ESXPText class]] && [(ESXPText *) node getValueBytes:&bytes])
+                counted.textBytes += bytes.length;
+            else
+                counted.textBytes += [[node getNodeValue] lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+            continue;
+        }
+        
+        counted.elementCount++;
+        counted.attributeCount += [node hasAttributes] ? [[node getAttributes] count] : 0;
+        counted.maxDepth        = MAX(counted.maxDepth, (uint64_t) depth);
+        for (id<ESXPNode> child in [node getChildNodes]) {
+            [nodes addObject:child];
+            [depths addObject:@(depth + 1)];
+        }
+    }
     
-    return counter;
+    self->statistics     = counted;
+    self->statisticsKept = YES;
+}
+
+- (void)keepStatistics
+{
+    memset(&self->statistics, 0, sizeof(self->statistics));
+    memset(&self->footprint, 0, sizeof(self->footprint));
+    self->statisticsKept = YES;
+    self->footprintKept  = YES;
+}
+
+- (void)countElement:(NSUInteger)depth attributes:(NSUInteger)attributeCount
+{
+    self->statistics.elementCount++;
+    self->statistics.attributeCount += attributeCount;
+    if (depth > self->statistics.maxDepth)
+        self->statistics.maxDepth = depth;
+}
+
+- (void)countText:(NSUInteger)length
+{
+    self->statistics.textNodeCount++;
+    self->statistics.textBytes += length;
+}
+
+- (void)mergeStatistics:(ESXPDocumentStatistics)other depth:(NSUInteger)depth
+{
+    self->statistics.elementCount   += other.elementCount;
+    self->statistics.textNodeCount  += other.textNodeCount;
+    self->statistics.attributeCount += other.attributeCount;
+    self->statistics.textBytes      += other.textBytes;
+    if (other.maxDepth > 0)
+        self->statistics.maxDepth = MAX(self->statistics.maxDepth, other.maxDepth + depth);
+}
+
+- (ESXPDocumentFootprint)getFootprint
+{
+    ESXPDocumentFootprint counted = self->footprint;
+    if (!self->footprintKept) {
+        // Every text decoded, every attribute with an empty value.
+        ESXPDocumentStatistics counts = [self getStatistics];
+        counted.nodeBytes      = counts.elementCount * (class_getInstanceSize([ESXPElement class]) + sizeof(id))
+                               + counts.textNodeCount * (class_getInstanceSize([ESXPText class]) + sizeof(id));
+        counted.textBytes      = counts.textNodeCount * kOBJECT_BYTES + counts.textBytes;
+        counted.attributeBytes = counts.attributeCount * (kOBJECT_BYTES + 2 * sizeof(id));
+    }
+    counted.nameBytes = [self->nameTable getByteCount];
+    
+    return counted;
+}
+
+- (void)addFootprint:(ESXPDocumentFootprint)bytes
+{
+    self->footprint.nodeBytes      += bytes.nodeBytes;
+    self->footprint.textBytes      += bytes.textBytes;
+    self->footprint.attributeBytes += bytes.attributeBytes;
+}
+
+- (uint64_t)getElementNodeCount { return [self getStatistics].elementCount; }
+
+- (ESXPTextBuffer *)getTextBuffer
+{
+    if (self->textBuffer == nil)
+        self->textBuffer = [ESXPTextBuffer newBuild:64 * 1024];
+    
+    return self->textBuffer;
+}
+
+// MARK: Private Methods
+- (void)checkNotFrozen
+{
+    if (self->frozen)
+        @throw [NSException exceptionWithName:@"FrozenDocumentException"
+                                       reason:@"The document is frozen and can not be changed."
+                                     userInfo:nil];
+}
+
+- (void)indexSubtree:(ESXPElement *)element
+{
+    NSMutableArray *nodes = [NSMutableArray arrayWithObject:element];
+    while ([nodes count] > 0) {
+        ESXPElement *node = [nodes lastObject];
+        [nodes removeLastObject];
+        [self indexElement:node];
+        
+        NSArray *children = [node getChildNodes];
+        for (NSInteger i = (NSInteger) [children count] - 1; i >= 0; i--)
+            if ([[children objectAtIndex:i] getNodeType] == ELEMENT_NODE)
+                [nodes addObject:[children objectAtIndex:i]];
+    }
 }
 @end
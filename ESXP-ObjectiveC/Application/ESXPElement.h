@@ -28,19 +28,60 @@
 #import "ESXPNode.h"
 #import "ESXPText.h"
 
+struct ESXPRawAttribute;
+
 /// Class for representing a DOM Element.
 ///
+/// <p>
+/// Attributes can be given as raw, still escaped, values inside the input. They are
+/// decoded all at once the first time any of them is asked for.
+/// </p>
+///
+/// <p>
+/// The links to the parent and the siblings are weak, as the parent owns its children. A
+/// node kept after its document is gone (i.e. one found in a streamed record, or kept
+/// across a reset of the builder) stays usable, only without a parent or siblings.
+/// </p>
+///
 /// \author Andreas P. Koenzen <akc at apkc.net>
 @interface ESXPElement : NSObject <ESXPNode>
 {
-    ESXPElement         *parent;     // The parent node of this node.
-    NSString            *name;       // The name of this node.
-    NSString            *value;      // The value of this node.
-    NSMutableArray      *children;   // The children of this node.
-    NSMutableDictionary *attributes; // The attributes of this node.
+    __weak ESXPElement               *parent;            // The parent node of this node. Weak, the parent owns its children.
+    __weak id<ESXPNode>              previousSibling;   // The node before this one in the parent. Weak.
+    __weak id<ESXPNode>              nextSibling;       // The node after this one in the parent. Weak.
+    NSString                         *name;             // The name of this node.
+    NSUInteger                       symbol;            // The interned symbol of the name of this node.
+    NSString                         *value;            // The value of this node.
+    NSMutableArray                   *children;         // The children of this node.
+    NSMutableDictionary              *attributes;       // The attributes of this node, nil until the first one is set or asked for.
+    NSData                           *source;           // The input holding the raw attributes, nil once decoded.
+    struct ESXPRawAttribute          *rawAttributes;    // The raw attributes.
+    NSUInteger                       rawAttributeCount; // The count of raw attributes.
 }
 
+// MARK: Builders
+/// Builder of new instances with an interned name. Follows the Builder Pattern.
+///
+/// \param name       The name of the node, as returned by the name table.
+/// \param symbol     The symbol of the name of the node.
+/// \param parentNode The parent node of this node.
+///
+/// \return A new instance of ESXPElement if available, otherwise return NIL.
++ (ESXPElement *)newBuild:(NSString *)name symbol:(NSUInteger)symbol parentNode:(id<ESXPNode>)parentNode;
+
 // MARK: Methods
+/// Rebuilds the sibling links of the children of this node. Needed only after the array
+/// returned by getChildNodes was changed directly.
+- (void)relinkChildren;
+
+/// Sets the attributes as raw runs of the input, to be decoded when first asked for.
+///
+/// \param attributes The raw attributes, the values still escaped.
+/// \param names      The interned names of the attributes, in the same order.
+/// \param count      The count of attributes.
+/// \param source     The input, kept alive until the attributes are decoded.
+- (void)setRawAttributes:(const ESXPTokenAttribute *)attributes names:(NSString * __unsafe_unretained *)names count:(NSUInteger)count source:(NSData *)source;
+
 /// Adds a new attribute.
 ///
 /// \param name  The name of the attribute.
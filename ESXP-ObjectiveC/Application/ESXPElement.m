@@ -27,6 +27,24 @@
 #import "ESXPConstants.h"
 #import "ESXPElement.h"
 
+/// A raw attribute. The name is retained by hand, ARC does not manage struct members.
+struct ESXPRawAttribute
+{
+    void      *name;
+    ESXPRange value;
+};
+
+/// The attributes of every element without any. Shared and never stored in the element,
+/// so reading the attributes of a frozen element does not write to it.
+static NSDictionary *ESXPNoAttributes(void)
+{
+    static NSDictionary    *empty = nil;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{ empty = [NSDictionary new]; });
+    
+    return empty;
+}
+
 @implementation ESXPElement
 // MARK: ESXPNode Implementation
 + (id<ESXPNode>)newBuild:(NSString *)name
@@ -35,9 +53,10 @@
     if (instance) {
         instance->parent     = nil;
         instance->name       = name;
+        instance->symbol     = kNO_SYMBOL;
         instance->value      = nil;
         instance->children   = [NSMutableArray new];
-        instance->attributes = [NSMutableDictionary new];
+        instance->attributes = nil;
     }
     else {
         return nil;
@@ -52,9 +71,10 @@
     if (instance) {
         instance->parent     = (ESXPElement *)parentNode;
         instance->name       = name;
+        instance->symbol     = kNO_SYMBOL;
         instance->value      = nil;
         instance->children   = [NSMutableArray new];
-        instance->attributes = [NSMutableDictionary new];
+        instance->attributes = nil;
     }
     else {
         return nil;
@@ -63,13 +83,29 @@
     return instance;
 }
 
++ (ESXPElement *)newBuild:(NSString *)name symbol:(NSUInteger)symbol parentNode:(id<ESXPNode>)parentNode
+{
+    ESXPElement *instance = (ESXPElement *)[ESXPElement newBuild:name parentNode:parentNode];
+    if (instance)
+        instance->symbol = symbol;
+    else
+        return nil;
+    
+    return instance;
+}
+
+- (void)dealloc { [self releaseRawAttributes]; }
+
 - (id<ESXPNode>)appendChild:(id<ESXPNode>)newChild
 {
+    id<ESXPNode> last = [self->children lastObject];
+    [last linkSiblings:[last getPreviousSibling] next:newChild];
+    [newChild linkSiblings:last next:nil];
     [self->children addObject:newChild];
     return newChild;
 }
 
-- (void)countElementNodes:(unsigned short *)counter
+- (void)countElementNodes:(uint64_t *)counter
 {
     for (id<ESXPNode> child in self->children) {
         if ([child getNodeType] == ELEMENT_NODE) {
@@ -77,7 +113,7 @@
             
             if (kDEBUG) {
                 NSLog(@"Counting Node ==> %@", [child getNodeName]);
-                NSLog(@"Count ==> %u", *counter);
+                NSLog(@"Count ==> %llu", (unsigned long long) *counter);
             }
         }
     }
@@ -89,38 +125,65 @@
 
 - (NSString *)description
 {
-    NSMutableString *str = [NSMutableString stringWithFormat:@"<ELEMENT> Name: %@ - Value: %@\n", self->name, self->value];
-    NSEnumerator *enumerator = [self->attributes keyEnumerator];
+    NSMutableString *str        = [NSMutableString stringWithFormat:@"<ELEMENT> Name: %@ - Value: %@\n", self->name, self->value];
+    NSDictionary    *attributes = [self getAttributes];
+    NSEnumerator *enumerator = [attributes keyEnumerator];
     id key;
     while ((key = [enumerator nextObject]))
-        [str appendFormat:@"\t<ATTRIBUTE> %@ : %@\n", (NSString *) key, [self->attributes objectForKey:key]];
+        [str appendFormat:@"\t<ATTRIBUTE> %@ : %@\n", (NSString *) key, [attributes objectForKey:key]];
     
     return str;
 }
 
-- (NSDictionary *)getAttributes { return self->attributes; }
+- (NSString *)getAttribute:(NSString *)attributeName
+{
+    // A single raw attribute can be decoded without building the dictionary.
+    if (self->attributes == nil) {
+        for (NSUInteger i = 0; i < self->rawAttributeCount; i++)
+            if ([(__bridge NSString *)self->rawAttributes[i].name isEqualToString:attributeName])
+                return ESXPDecodeAttribute(self->rawAttributes[i].value);
+        
+        return nil;
+    }
+    
+    return [self->attributes objectForKey:attributeName];
+}
+
+- (NSDictionary *)getAttributes
+{
+    if (self->attributes == nil && self->rawAttributeCount == 0)
+        return ESXPNoAttributes();
+    
+    return [self decodeAttributes];
+}
 
 - (NSString *)getBaseURI { return @""; }
 
 - (NSMutableArray *)getChildNodes { return self->children; }
 
-- (id<ESXPNode>)getFirstChild { return nil; }
+- (id<ESXPNode>)getFirstChild { return [self->children firstObject]; }
 
-- (id<ESXPNode>)getLastChild { return nil; }
+- (id<ESXPNode>)getLastChild { return [self->children lastObject]; }
 
 - (NSString *)getLocalName { return @""; }
 
 - (NSString *)getNamespaceURI { return @""; }
 
+- (id<ESXPNode>)getNextSibling { return self->nextSibling; }
+
 - (NSString *)getNodeName { return self->name; }
 
+- (NSUInteger)getNodeSymbol { return self->symbol; }
+
 - (unsigned short)getNodeType { return ELEMENT_NODE; }
 
 - (NSString *)getNodeValue { return self->value; }
 
 - (id<ESXPNode>)getParentNode { return self->parent; }
 
-- (BOOL)hasAttributes { return false; }
+- (id<ESXPNode>)getPreviousSibling { return self->previousSibling; }
+
+- (BOOL)hasAttributes { return self->attributes != nil ? [self->attributes count] > 0 : self->rawAttributeCount > 0; }
 
 - (BOOL)hasChildNodes { return [self->children count] > 0; }
 
@@ -130,38 +193,69 @@
 
 - (BOOL)isSameNode:(id<ESXPNode>)other { return false; }
 
+- (void)linkSiblings:(id<ESXPNode>)previous next:(id<ESXPNode>)next
+{
+    self->previousSibling = previous;
+    self->nextSibling     = next;
+}
+
 - (NSString *)lookupNamespaceURI:(NSString *)prefix { return @""; }
 
 - (void)normalize
 {
-    short           firstTextNodePosition = -1;
-    NSMutableArray  *objectsToRemove      = [NSMutableArray new];
-    NSMutableString *normalizedText       = [NSMutableString new];
-    
+    NSUInteger textCount = 0;
+    NSUInteger byteCount = 0;   // The UTF-8 bytes of the text, when all of it is held as bytes.
+    BOOL       asBytes   = YES;
     for (id<ESXPNode> child in self->children) {
-        if ([child getNodeType] == TEXT_NODE) {
-            // Merge all TEXT_NODES together.
-            // Save the position of the first TEXT_NODES in the array.
-            if (firstTextNodePosition < 0)
-                firstTextNodePosition = [self->children indexOfObject:child];
-            // Now extract the text and mark the TEXT_NODE for removal.
-            [normalizedText appendString:[child getNodeValue]];
-            [objectsToRemove addObject:child];
-            
-            if (kDEBUG)
-                NSLog(@"Normalizing Node ==> %@", [child getNodeName]);
-        }
+        if ([child getNodeType] != TEXT_NODE)
+            continue;
+        
+        ESXPRange bytes;
+        textCount++;
+        if (asBytes && [child isKindOfClass:[ESXPText class]] && [(ESXPText *) child getValueBytes:&bytes])
+            byteCount += bytes.length;
+        else
+            asBytes = NO;
     }
     
-    // Remove the objects.
-    if ([objectsToRemove count] > 0)
-        [self->children removeObjectsInArray:objectsToRemove];
-    
-    // Now finally add a new TEXT_NODE at first position found, but only if normalization has been done.
-    if (firstTextNodePosition > -1) {
-        ESXPText *mergedTextNode = [ESXPText newBuild:nil];
-        [mergedTextNode setNodeValue:normalizedText];
-        [self->children insertObject:mergedTextNode atIndex:firstTextNodePosition];
+    // Merge all TEXT_NODES together, at the position of the first one. The children are
+    // copied once instead of being removed one by one. Text held as UTF-8 bytes is merged
+    // as bytes, never going through a string.
+    if (textCount > 1) {
+        NSMutableArray  *merged         = [NSMutableArray arrayWithCapacity:[self->children count] - textCount + 1];
+        NSMutableString *normalizedText = asBytes ? nil : [NSMutableString new];
+        NSMutableData   *normalizedData = asBytes ? [NSMutableData dataWithCapacity:byteCount] : nil;
+        NSUInteger      mergedAt        = NSNotFound;
+        for (id<ESXPNode> child in self->children) {
+            if ([child getNodeType] != TEXT_NODE) {
+                [merged addObject:child];
+                continue;
+            }
+            
+            ESXPRange bytes;
+            if (asBytes && [(ESXPText *) child getValueBytes:&bytes])
+                [normalizedData appendBytes:bytes.bytes length:bytes.length];
+            else
+                [normalizedText appendString:[child getNodeValue]];
+            
+            if (mergedAt == NSNotFound) {
+                mergedAt = [merged count];
+                [merged addObject:[NSNull null]];
+            }
+        }
+        
+        ESXPText *mergedTextNode = nil;
+        if (asBytes) {
+            mergedTextNode = [ESXPText newBuild:normalizedData bytes:(ESXPRange) { [normalizedData bytes], [normalizedData length] } parentNode:self];
+        }
+        else {
+            mergedTextNode = [ESXPText newBuild:nil parentNode:self];
+            [mergedTextNode setNodeValue:normalizedText];
+        }
+        [merged replaceObjectAtIndex:mergedAt withObject:mergedTextNode];
+        [self->children setArray:merged];
+        [self relinkChildren];
+        
         if (kDEBUG)
             NSLog(@"\tMerged Node Result ==> %@", [mergedTextNode getNodeValue]);
     }
@@ -193,5 +287,54 @@
 - (void)setNodeValue:(NSString *)nodeValue { self->value = nodeValue; }
 
 // MARK: Methods
-- (void)setAttribute:(NSString *)nodeName value:(NSString *)nodeValue { [self->attributes setObject:nodeValue forKey:nodeName]; }
+- (void)relinkChildren
+{
+    NSUInteger count = [self->children count];
+    for (NSUInteger i = 0; i < count; i++)
+        [[self->children objectAtIndex:i] linkSiblings:(i > 0) ? [self->children objectAtIndex:i - 1] : nil
+                                                  next:(i + 1 < count) ? [self->children objectAtIndex:i + 1] : nil];
+}
+
+- (void)setRawAttributes:(const ESXPTokenAttribute *)raw names:(NSString * __unsafe_unretained *)names count:(NSUInteger)count source:(NSData *)input
+{
+    [self releaseRawAttributes];
+    self->attributes = nil;
+    if (count == 0)
+        return;
+    
+    self->source            = input;
+    self->rawAttributeCount = count;
+    self->rawAttributes     = malloc(sizeof(struct ESXPRawAttribute) * count);
+    for (NSUInteger i = 0; i < count; i++) {
+        self->rawAttributes[i].name  = (void *) CFBridgingRetain(names[i]);
+        self->rawAttributes[i].value = raw[i].value;
+    }
+}
+
+- (void)setAttribute:(NSString *)nodeName value:(NSString *)nodeValue { [[self decodeAttributes] setObject:nodeValue forKey:nodeName]; }
+
+// MARK: Private Methods
+- (NSMutableDictionary *)decodeAttributes
+{
+    if (self->attributes == nil) {
+        self->attributes = [NSMutableDictionary dictionaryWithCapacity:self->rawAttributeCount];
+        for (NSUInteger i = 0; i < self->rawAttributeCount; i++)
+            [self->attributes setObject:ESXPDecodeAttribute(self->rawAttributes[i].value) forKey:(__bridge NSString *)self->rawAttributes[i].name];
+        
+        [self releaseRawAttributes];
+    }
+    
+    return self->attributes;
+}
+
+- (void)releaseRawAttributes
+{
+    for (NSUInteger i = 0; i < self->rawAttributeCount; i++)
+        CFBridgingRelease(self->rawAttributes[i].name);
+    
+    free(self->rawAttributes);
+    self->rawAttributes     = NULL;
+    self->rawAttributeCount = 0;
+    self->source            = nil;
+}
 @end
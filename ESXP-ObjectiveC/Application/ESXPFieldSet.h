@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ESXPNameTable.h"
+#import "ESXPNode.h"
+
+/// A set of fields extracted together from a subtree.
+///
+/// <p>
+/// Every field selects an element by name, optionally only when its parent has a given
+/// name (i.e. the "id" inside "revision"), and takes either the text of the element, as
+/// returned by ESXPProcessor getNodeValue:strict:, or one of its attributes. extract:
+/// fills all the fields in a single traversal of the subtree, stopping as soon as every
+/// field has a value. When many elements match a field, the first one in document
+/// order wins.
+/// </p>
+///
+/// <p>
+/// Names are resolved to symbols once per name table, and a set can be shared by many
+/// threads once all its fields are added.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPFieldSet : NSObject
+{
+    NSMutableArray *names;      // The element name of each field.
+    NSMutableArray *parents;    // The parent name of each field, NSNull if any parent.
+    NSMutableArray *attributes; // The attribute of each field, NSNull for the text.
+}
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPFieldSet *)newBuild;
+
+// MARK: Methods
+/// Adds a field to this set.
+///
+/// \param name      The name of the element.
+/// \param parent    The name of the parent of the element, or nil for any parent.
+/// \param attribute The attribute to take, or nil to take the text of the element.
+///
+/// \return The index of the field in the values returned by extract:nameTable:.
+- (NSUInteger)addField:(NSString *)name parent:(NSString *)parent attribute:(NSString *)attribute;
+
+/// Extracts all fields from the descendants of a node in one traversal.
+///
+/// \param node      The root of the subtree. Only its descendants are matched.
+/// \param nameTable The name table of the document of the node.
+///
+/// \return The value of every field, in the order they were added. Fields not found are
+///         empty strings.
+- (NSArray *)extract:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable;
+
+/// Returns the count of fields in this set.
+///
+/// \return The count of fields in this set.
+- (NSUInteger)count;
+@end
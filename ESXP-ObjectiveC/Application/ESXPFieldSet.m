@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ESXPConstants.h"
+#import "ESXPFieldSet.h"
+
+@interface ESXPFieldSet ()
+@property (atomic, strong) ESXPResolvedNames *resolved; // The element names, then the parent names, of the last complete resolution.
+@end
+
+@implementation ESXPFieldSet
+// MARK: Builders
++ (ESXPFieldSet *)newBuild
+{
+    ESXPFieldSet *instance = [[ESXPFieldSet alloc] init];
+    if (instance) {
+        instance->names      = [NSMutableArray new];
+        instance->parents    = [NSMutableArray new];
+        instance->attributes = [NSMutableArray new];
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+// MARK: Methods
+- (NSUInteger)addField:(NSString *)name parent:(NSString *)parent attribute:(NSString *)attribute
+{
+    [self->names addObject:name];
+    [self->parents addObject:(parent != nil) ? parent : [NSNull null]];
+    [self->attributes addObject:(attribute != nil) ? attribute : [NSNull null]];
+    self.resolved = nil;
+    
+    return [self->names count] - 1;
+}
+
+- (NSArray *)extract:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable
+{
+    NSUInteger     count     = [self->names count];
+    NSMutableArray *values   = [NSMutableArray arrayWithCapacity:count];
+    NSUInteger     remaining = count;
+    for (NSUInteger i = 0; i < count; i++)
+        [values addObject:[NSNull null]];
+    
+    if (count > 0 && node != nil) {
+        // The element names come first, then the parent names. The local keeps the symbols alive.
+        ESXPResolvedNames *resolved = [self resolve:nameTable];
+        const NSUInteger  *symbols  = [resolved getSymbols];
+        
+        // Walk the subtree along the sibling links, in document order.
+        NSUInteger   depth   = 1;
+        id<ESXPNode> current = [node getFirstChild];
+        while (current != nil && remaining > 0) {
+            id<ESXPNode> next = nil;
+            if ([current getNodeType] == ELEMENT_NODE) {
+                for (NSUInteger i = 0; i < count; i++) {
+                    if ([values objectAtIndex:i] != [NSNull null] || !ESXPNodeNamed(current, symbols[i], [self->names objectAtIndex:i]))
+                        continue;
+                    
+                    id parent = [self->parents objectAtIndex:i];
+                    if (parent != [NSNull null] && !ESXPNodeNamed([current getParentNode], symbols[count + i], parent))
+                        continue;
+                    
+                    id       attribute = [self->attributes objectAtIndex:i];
+                    NSString *value    = (attribute != [NSNull null]) ? [current getAttribute:attribute] : [self textOf:current];
+                    if (value != nil) {
+                        [values replaceObjectAtIndex:i withObject:value];
+                        remaining--;
+                    }
+                }
+                
+                next = [current getFirstChild];
+            }
+            
+            if (next != nil) {
+                depth++;
+                current = next;
+                continue;
+            }
+            
+            // Nothing below, so the next sibling, climbing up while there is none. Depth
+            // rather than identity tells when the subtree is left, since facades over an
+            // arena document are made anew on every call.
+            next = [current getNextSibling];
+            while (next == nil && --depth > 0) {
+                current = [current getParentNode];
+                next    = [current getNextSibling];
+            }
+            current = next;
+        }
+    }
+    
+    for (NSUInteger i = 0; i < count && remaining > 0; i++)
+        if ([values objectAtIndex:i] == [NSNull null])
+            [values replaceObjectAtIndex:i withObject:@""];
+    
+    return values;
+}
+
+- (NSUInteger)count { return [self->names count]; }
+
+// MARK: Private Methods
+- (NSString *)textOf:(id<ESXPNode>)element
+{
+    for (id<ESXPNode> child = [element getFirstChild]; child != nil; child = [child getNextSibling]) {
+        if ([child getNodeType] == TEXT_NODE) {
+            NSString *text = [child getNodeValue];
+            if ([text length] > 0)
+                return text;
+        }
+    }
+    
+    return nil;
+}
+
+- (ESXPResolvedNames *)resolve:(ESXPNameTable *)nameTable
+{
+    ESXPResolvedNames *resolved = self.resolved;
+    if (resolved != nil && [resolved isFor:nameTable] && [resolved count] == 2 * [self->names count])
+        return resolved;
+    
+    resolved = [ESXPResolvedNames newBuild:[self->names arrayByAddingObjectsFromArray:self->parents] nameTable:nameTable];
+    if ([resolved isComplete])
+        self.resolved = resolved;
+    
+    return resolved;
+}
+@end
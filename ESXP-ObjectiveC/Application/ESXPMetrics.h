@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import <stdatomic.h>
+
+typedef NS_ENUM(int, MetricCounters)
+{
+    METRIC_ELEMENTS         = 0, // Start tags seen by ESXPSAX2DOM.
+    METRIC_ATTRIBUTES       = 1, // Attributes seen by ESXPSAX2DOM.
+    METRIC_TEXT_CHUNKS      = 2, // Pieces of text handed to ESXPSAX2DOM by the front end, before coalescing.
+    METRIC_TEXT_BYTES       = 3, // The bytes of those pieces, as found in the input.
+    METRIC_NODES_ALLOCATED  = 4, // ESXPElement and ESXPText objects built by ESXPSAX2DOM.
+    METRIC_WALKER_NODES     = 5, // Nodes returned by ESXPStackDOMWalker.
+    METRIC_WALKER_STACK_MAX = 6, // The deepest stack of any ESXPStackDOMWalker. A maximum, not a sum.
+    METRIC_QUERY_RESULTS    = 7, // Nodes found by the searches and queries of ESXPProcessor.
+    METRIC_COUNT            = 8,
+};
+
+typedef NS_ENUM(int, MetricPhases)
+{
+    PHASE_PARSE    = 0, // A parse by ESXPSAX2DOM, from the first event to the last.
+    PHASE_SEARCH   = 1, // A search of ESXPProcessor for the first element with a name.
+    PHASE_QUERY    = 2, // An evaluation of an ESXPQuery by ESXPProcessor.
+    PHASE_EXTRACT  = 3, // An extraction of an ESXPFieldSet by ESXPProcessor.
+    PHASE_PARALLEL = 4, // A search, query or extraction of ESXPProcessor on many threads.
+    PHASE_COUNT    = 5,
+};
+
+/// The time spent in a phase.
+typedef struct ESXPMetricsTimer
+{
+    uint64_t count;            // The count of times the phase ran.
+    uint64_t totalNanoseconds; // The time of all of them.
+    uint64_t maxNanoseconds;   // The time of the longest one.
+} ESXPMetricsTimer;
+
+/// What was measured since metrics were last reset.
+typedef struct ESXPMetricsStatistics
+{
+    uint64_t         counters[METRIC_COUNT];
+    ESXPMetricsTimer timers[PHASE_COUNT];
+} ESXPMetricsStatistics;
+
+/// Called when a phase begins and when it ends, on the thread running it.
+typedef void (^ESXPPhaseHook)(MetricPhases phase, BOOL begin);
+
+/// If metrics are being collected. Read it through ESXPMetricsEnabled().
+extern atomic_bool ESXPMetricsOn;
+
+/// Tests whether metrics are being collected. A single load, so that code measuring
+/// itself costs one branch while metrics are off.
+static inline BOOL ESXPMetricsEnabled(void) { return atomic_load_explicit(&ESXPMetricsOn, memory_order_relaxed); }
+
+/// Counters and timers of the parsing and query hot paths, for the whole process.
+///
+/// <p>
+/// Metrics are off until setEnabled: turns them on, and while off the instrumented code
+/// only tests ESXPMetricsEnabled(). Builders and walkers count into their own fields and
+/// add them here once they are done, so the shared counters are not touched per node.
+/// Every update is atomic, any thread can measure and read at the same time.
+/// </p>
+///
+/// <p>
+/// A phase hook sees every phase begin and end, to feed another tracing system. Phases
+/// nest (a parallel query runs many queries) and run on many threads at once. The hook
+/// should be set while metrics are off.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+@interface ESXPMetrics : NSObject
+// MARK: Methods
+/// Turns the collection of metrics on or off. What was collected is kept.
+///
+/// \param enabled YES to collect metrics.
++ (void)setEnabled:(BOOL)enabled;
+
+/// Sets the block called at the beginning and end of every phase, while metrics are on.
+/// Can be called while phases run on other threads.
+///
+/// \param hook The block, nil for none.
++ (void)setPhaseHook:(ESXPPhaseHook)hook;
+
+/// Returns what was collected since the last reset.
+///
+/// \return The counters and timers.
++ (ESXPMetricsStatistics)getStatistics;
+
+/// Sets every counter and timer back to zero.
++ (void)reset;
+
+/// Adds to a counter.
+///
+/// \param value   The amount to add.
+/// \param counter The counter.
++ (void)add:(uint64_t)value counter:(MetricCounters)counter;
+
+/// Raises a counter that holds a maximum.
+///
+/// \param value   The value seen.
+/// \param counter The counter.
++ (void)raise:(uint64_t)value counter:(MetricCounters)counter;
+
+/// Begins a phase. Must be matched by endPhase:start:.
+///
+/// \param phase The phase.
+///
+/// \return The time it began, never 0.
++ (uint64_t)beginPhase:(MetricPhases)phase;
+
+/// Ends a phase, adding its time to the timer of the phase.
+///
+/// \param phase The phase.
+/// \param start What beginPhase: returned. Nothing is done if it is 0, so that a phase
+///              begun while metrics were off is ignored.
++ (void)endPhase:(MetricPhases)phase start:(uint64_t)start;
+
+/// Returns the counters and timers as text. For debugging.
+///
+/// \return The text.
++ (NSString *)printStatistics;
+@end
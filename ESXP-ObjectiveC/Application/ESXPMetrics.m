@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <pthread.h>
+#import <time.h>
+#import "ESXPMetrics.h"
+
+atomic_bool ESXPMetricsOn = false;
+
+static _Atomic uint64_t counters[METRIC_COUNT];                // The counters.
+static _Atomic uint64_t timerCounts[PHASE_COUNT];              // The count of times each phase ran.
+static _Atomic uint64_t timerTotals[PHASE_COUNT];              // The nanoseconds spent in each phase.
+static _Atomic uint64_t timerMaximums[PHASE_COUNT];            // The nanoseconds of the longest run of each phase.
+static ESXPPhaseHook    phaseHook = nil;                       // Called at the beginning and end of every phase.
+static pthread_mutex_t  hookLock  = PTHREAD_MUTEX_INITIALIZER; // Guards phaseHook, which is set and read from any thread.
+
+static NSString *const kCOUNTER_NAMES[METRIC_COUNT] = {
+    @"elements", @"attributes", @"textChunks", @"textBytes", @"nodesAllocated", @"walkerNodes", @"walkerStackMax", @"queryResults"
+};
+static NSString *const kPHASE_NAMES[PHASE_COUNT] = { @"parse", @"search", @"query", @"extract", @"parallel" };
+
+static inline uint64_t ESXPMetricsNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+/// Returns the phase hook, retained for the caller so it may be replaced while it runs.
+static ESXPPhaseHook ESXPMetricsHook(void)
+{
+    pthread_mutex_lock(&hookLock);
+    ESXPPhaseHook hook = phaseHook;
+    pthread_mutex_unlock(&hookLock);
+    
+    return hook;
+}
+
+static inline void ESXPMetricsRaise(_Atomic uint64_t *maximum, uint64_t value)
+{
+    uint64_t seen = atomic_load_explicit(maximum, memory_order_relaxed);
+    while (value > seen && !atomic_compare_exchange_weak_explicit(maximum, &seen, value, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+@implementation ESXPMetrics
+// MARK: Methods
++ (void)setEnabled:(BOOL)enabled { atomic_store_explicit(&ESXPMetricsOn, enabled, memory_order_relaxed); }
+
++ (void)setPhaseHook:(ESXPPhaseHook)hook
+{
+    ESXPPhaseHook copied = [hook copy];
+    pthread_mutex_lock(&hookLock);
+    ESXPPhaseHook replaced = phaseHook; // Released once the lock is given back, it may own anything.
+    phaseHook = copied;
+    pthread_mutex_unlock(&hookLock);
+}
+
++ (ESXPMetricsStatistics)getStatistics
+{
+    ESXPMetricsStatistics statistics;
+    for (NSUInteger i = 0; i < METRIC_COUNT; i++)
+        statistics.counters[i] = atomic_load_explicit(&counters[i], memory_order_relaxed);
+    
+    for (NSUInteger i = 0; i < PHASE_COUNT; i++) {
+        statistics.timers[i].count            = atomic_load_explicit(&timerCounts[i], memory_order_relaxed);
+        statistics.timers[i].totalNanoseconds = atomic_load_explicit(&timerTotals[i], memory_order_relaxed);
+        statistics.timers[i].maxNanoseconds   = atomic_load_explicit(&timerMaximums[i], memory_order_relaxed);
+    }
+    
+    return statistics;
+}
+
++ (void)reset
+{
+    for (NSUInteger i = 0; i < METRIC_COUNT; i++)
+        atomic_store_explicit(&counters[i], 0, memory_order_relaxed);
+    
+    for (NSUInteger i = 0; i < PHASE_COUNT; i++) {
+        atomic_store_explicit(&timerCounts[i], 0, memory_order_relaxed);
+        atomic_store_explicit(&timerTotals[i], 0, memory_order_relaxed);
+        atomic_store_explicit(&timerMaximums[i], 0, memory_order_relaxed);
+    }
+}
+
++ (void)add:(uint64_t)value counter:(MetricCounters)counter { atomic_fetch_add_explicit(&counters[counter], value, memory_order_relaxed); }
+
++ (void)raise:(uint64_t)value counter:(MetricCounters)counter { ESXPMetricsRaise(&counters[counter], value); }
+
++ (uint64_t)beginPhase:(MetricPhases)phase
+{
+    ESXPPhaseHook hook = ESXPMetricsHook();
+    if (hook != nil)
+        hook(phase, YES);
+    
+    return MAX(ESXPMetricsNow(), (uint64_t) 1);
+}
+
++ (void)endPhase:(MetricPhases)phase start:(uint64_t)start
+{
+    if (start == 0)
+        return;
+    
+    uint64_t elapsed = ESXPMetricsNow() - start;
+    atomic_fetch_add_explicit(&timerCounts[phase], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&timerTotals[phase], elapsed, memory_order_relaxed);
+    ESXPMetricsRaise(&timerMaximums[phase], elapsed);
+    
+    ESXPPhaseHook hook = ESXPMetricsHook();
+    if (hook != nil)
+        hook(phase, NO);
+}
+
++ (NSString *)printStatistics
+{
+    ESXPMetricsStatistics statistics = [ESXPMetrics getStatistics];
+    NSMutableString       *b         = [NSMutableString new];
+    for (NSUInteger i = 0; i < METRIC_COUNT; i++)
+        [b appendFormat:@"[%@]:%llu\n", kCOUNTER_NAMES[i], (unsigned long long) statistics.counters[i]];
+    
+    for (NSUInteger i = 0; i < PHASE_COUNT; i++)
+        [b appendFormat:@"[%@]:%llu runs, %.3f ms total, %.3f ms max\n",
+         kPHASE_NAMES[i],
+         (unsigned long long) statistics.timers[i].count,
+         statistics.timers[i].totalNanoseconds / 1e6,
+         statistics.timers[i].maxNanoseconds / 1e6];
+    
+    return [NSString stringWithString:b];
+}
+@end
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import <pthread.h>
+#import <stdatomic.h>
+#import "ESXPConstants.h"
+#import "ESXPNode.h"
+
+struct ESXPNameEntries;
+struct ESXPNameSlots;
+struct ESXPNamePool;
+
+/// Table of interned element and attribute names.
+///
+/// <p>
+/// Every distinct name gets a small integer symbol the first time it is seen, and the
+/// same NSString instance is handed out for it from then on. Nodes keep the symbol, so
+/// callers can resolve a name once with symbolForName: and then match nodes with a
+/// single integer comparison. Symbols start at 1, kNO_SYMBOL (0) is never assigned.
+/// </p>
+///
+/// <p>
+/// A table can be shared by many documents, which gives all of them the same symbols.
+/// It is safe to use from many threads at once. Looking up a name already in the table,
+/// by its bytes or by its symbol, takes no lock, so builders parsing pieces of one input
+/// on many threads do not wait on each other for every tag. Only adding a name does.
+/// The arrays readers may be looking at are never changed in place when they grow, the
+/// table publishes a larger copy and keeps the old one until it is released itself.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPNameTable : NSObject
+{
+    NSMutableArray                   *names;   // The names, indexed by symbol. Only touched with the lock.
+    _Atomic(struct ESXPNameEntries *) entries; // The hash, bytes and string of each symbol.
+    _Atomic(struct ESXPNameSlots *)   slots;   // Open addressing table of symbols, 0 means empty.
+    _Atomic(NSUInteger)               used;    // The count of symbols, kNO_SYMBOL included.
+    struct ESXPNamePool               *pool;   // The UTF-8 bytes of all names, in chunks that never move.
+    pthread_mutex_t                   lock;    // Taken to add a name.
+}
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPNameTable *)newBuild;
+
+// MARK: Methods
+/// Interns a name, adding it to the table if needed.
+///
+/// \param name The name.
+///
+/// \return The symbol of the name.
+- (NSUInteger)internName:(NSString *)name;
+
+/// Interns a name given as UTF-8 bytes, adding it to the table if needed. No object
+/// is allocated unless the name is new.
+///
+/// \param bytes  The UTF-8 bytes of the name.
+/// \param length The count of bytes.
+///
+/// \return The symbol of the name.
+- (NSUInteger)internBytes:(const char *)bytes length:(NSUInteger)length;
+
+/// Interns a name, adding it to the table if needed, and hands out the interned string
+/// in the same call.
+///
+/// \param name     The name.
+/// \param interned Set to the interned string of the name, which lives as long as the table.
+///
+/// \return The symbol of the name.
+- (NSUInteger)internName:(NSString *)name interned:(NSString * __unsafe_unretained *)interned;
+
+/// Interns a name given as UTF-8 bytes like internBytes:length:, and hands out the
+/// interned string in the same call.
+///
+/// \param bytes    The UTF-8 bytes of the name.
+/// \param length   The count of bytes.
+/// \param interned Set to the interned string of the name, which lives as long as the table.
+///
+/// \return The symbol of the name.
+- (NSUInteger)internBytes:(const char *)bytes length:(NSUInteger)length interned:(NSString * __unsafe_unretained *)interned;
+
+/// Looks up the symbol of a name without adding it.
+///
+/// \param name The name.
+///
+/// \return The symbol of the name, or kNO_SYMBOL if the name is not in the table.
+- (NSUInteger)symbolForName:(NSString *)name;
+
+/// Looks up the symbol of a name given as UTF-8 bytes without adding it.
+///
+/// \param bytes  The UTF-8 bytes of the name.
+/// \param length The count of bytes.
+///
+/// \return The symbol of the name, or kNO_SYMBOL if the name is not in the table.
+- (NSUInteger)symbolForBytes:(const char *)bytes length:(NSUInteger)length;
+
+/// Returns the interned name of a symbol.
+///
+/// \param symbol The symbol.
+///
+/// \return The name, or nil if the symbol is not in the table.
+- (NSString *)nameForSymbol:(NSUInteger)symbol;
+
+/// Returns the count of names in this table.
+///
+/// \return The count of names in this table.
+- (NSUInteger)count;
+
+/// Returns the bytes allocated by this table: its arrays, the pool and the interned
+/// strings, estimated at kOBJECT_BYTES plus their UTF-8 bytes each.
+///
+/// \return The bytes allocated by this table.
+- (NSUInteger)getByteCount;
+@end
+
+/// Symbols of a list of names, resolved against one name table.
+///
+/// <p>
+/// Instances never change once built, so a query (or any other holder of names) can
+/// publish one for many threads to read without a lock, and replace it when asked about
+/// another table. The table is retained: while the symbols are kept, no other table can
+/// be given its address and be mistaken for it.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPResolvedNames : NSObject
+{
+    ESXPNameTable   *nameTable; // The table the symbols come from.
+    NSUInteger      *symbols;   // The symbol of each name, kNO_SYMBOL for NSNull.
+    NSUInteger      count;      // The count of names.
+    BOOL            complete;   // If every name was found in the table.
+}
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param names     The names to resolve. NSNull stands for no name, i.e. "*".
+/// \param nameTable The table to look the names up in. Nothing is added to it.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPResolvedNames *)newBuild:(NSArray *)names nameTable:(ESXPNameTable *)nameTable;
+
+// MARK: Methods
+/// Tells whether these symbols come from a table.
+///
+/// \param nameTable The table.
+///
+/// \return YES if the symbols were resolved against that same table.
+- (BOOL)isFor:(ESXPNameTable *)nameTable;
+
+/// Tells whether every name was found. Names not in the table yet may be interned later
+/// on, so an incomplete resolution should not be kept.
+///
+/// \return YES if no name resolved to kNO_SYMBOL.
+- (BOOL)isComplete;
+
+/// Returns the symbols.
+///
+/// \return The symbol of each name, in the order of the names.
+- (const NSUInteger *)getSymbols;
+
+/// Returns the count of names.
+///
+/// \return The count of names.
+- (NSUInteger)count;
+@end
+
+/// Tests whether a node has a given name. Interned nodes are matched by symbol, nodes
+/// built by hand (without a symbol) fall back to comparing the names.
+static inline BOOL ESXPNodeNamed(id<ESXPNode> node, NSUInteger symbol, NSString *name)
+{
+    NSUInteger nodeSymbol = [node getNodeSymbol];
+    return nodeSymbol != kNO_SYMBOL ? nodeSymbol == symbol : [[node getNodeName] isEqualToString:name];
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ESXPConstants.h"
+#import "ESXPNameTable.h"
+
+/// A symbol of the table.
+struct ESXPNameEntry
+{
+    uint32_t   hash;
+    uint32_t   length;
+    const char *bytes; // Into the pool.
+    void       *name;  // The interned string, owned by the names array of the table.
+};
+
+/// The entries of all symbols. Replaced by a larger copy when full.
+struct ESXPNameEntries
+{
+    struct ESXPNameEntries *previous; // The copy this one replaced, freed with the table.
+    NSUInteger             capacity;
+    struct ESXPNameEntry   entries[];
+};
+
+/// The open addressing table. Replaced by a larger one, never changed in place but to fill
+/// an empty slot.
+struct ESXPNameSlots
+{
+    struct ESXPNameSlots *previous; // The table this one replaced, freed with the table.
+    NSUInteger           count;     // Always a power of two.
+    _Atomic(uint32_t)    slots[];
+};
+
+/// A chunk of name bytes.
+struct ESXPNamePool
+{
+    struct ESXPNamePool *previous; // The chunk filled before this one.
+    NSUInteger          length;
+    NSUInteger          capacity;
+    char                bytes[];
+};
+
+/// FNV-1a, good enough for short names and cheap to compute.
+static inline uint32_t ESXPNameHash(const char *bytes, NSUInteger length)
+{
+    uint32_t hash = 2166136261u;
+    for (NSUInteger i = 0; i < length; i++) {
+        hash ^= (uint8_t) bytes[i];
+        hash *= 16777619u;
+    }
+    
+    return hash;
+}
+
+static struct ESXPNameSlots *ESXPNameSlotsNew(NSUInteger count, struct ESXPNameSlots *previous)
+{
+    struct ESXPNameSlots *slots = calloc(1, sizeof(struct ESXPNameSlots) + count * sizeof(_Atomic(uint32_t)));
+    slots->previous = previous;
+    slots->count    = count;
+    return slots;
+}
+
+/// Returns the slot holding the name, or the empty slot where it should go. Takes no lock:
+/// a symbol is only stored in a slot once its entry is complete and published.
+static NSUInteger ESXPNameFind(struct ESXPNameSlots *slots, _Atomic(struct ESXPNameEntries *) *entries, const char *bytes, NSUInteger length, uint32_t hash, uint32_t *found)
+{
+    NSUInteger mask = slots->count - 1;
+    NSUInteger slot = hash & mask;
+    uint32_t   symbol;
+    while ((symbol = atomic_load_explicit(&slots->slots[slot], memory_order_acquire)) != kNO_SYMBOL) {
+        struct ESXPNameEntry *entry = &atomic_load_explicit(entries, memory_order_acquire)->entries[symbol];
+        if (entry->hash == hash && entry->length == length && memcmp(entry->bytes, bytes, length) == 0)
+            break;
+        
+        slot = (slot + 1) & mask;
+    }
+    
+    *found = symbol;
+    return slot;
+}
+
+@implementation ESXPNameTable
+// MARK: Builders
++ (ESXPNameTable *)newBuild
+{
+    ESXPNameTable *instance = [[ESXPNameTable alloc] init];
+    if (instance) {
+        struct ESXPNameEntries *entries = calloc(1, sizeof(struct ESXPNameEntries) + 64 * sizeof(struct ESXPNameEntry));
+        entries->capacity = 64;
+        
+        instance->names = [NSMutableArray arrayWithObject:@""]; // Symbol 0 is kNO_SYMBOL.
+        instance->pool  = calloc(1, sizeof(struct ESXPNamePool) + 1024);
+        instance->pool->capacity = 1024;
+        atomic_init(&instance->entries, entries);
+        atomic_init(&instance->slots, ESXPNameSlotsNew(128, NULL));
+        atomic_init(&instance->used, 1);
+        pthread_mutex_init(&instance->lock, NULL);
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc
+{
+    for (struct ESXPNameEntries *entries = atomic_load(&self->entries), *previous; entries != NULL; entries = previous) {
+        previous = entries->previous;
+        free(entries);
+    }
+    for (struct ESXPNameSlots *slots = atomic_load(&self->slots), *previous; slots != NULL; slots = previous) {
+        previous = slots->previous;
+        free(slots);
+    }
+    for (struct ESXPNamePool *pool = self->pool, *previous; pool != NULL; pool = previous) {
+        previous = pool->previous;
+        free(pool);
+    }
+    pthread_mutex_destroy(&self->lock);
+}
+
+// MARK: Methods
+- (NSUInteger)internName:(NSString *)name
+{
+    const char *bytes = [name UTF8String];
+    return [self internBytes:bytes length:strlen(bytes) interned:NULL];
+}
+
+- (NSUInteger)internBytes:(const char *)bytes length:(NSUInteger)length { return [self internBytes:bytes length:length interned:NULL]; }
+
+- (NSUInteger)internName:(NSString *)name interned:(NSString * __unsafe_unretained *)interned
+{
+    const char *bytes = [name UTF8String];
+    return [self internBytes:bytes length:strlen(bytes) interned:interned];
+}
+
+- (NSUInteger)internBytes:(const char *)bytes length:(NSUInteger)length interned:(NSString * __unsafe_unretained *)interned
+{
+    uint32_t hash   = ESXPNameHash(bytes, length);
+    uint32_t symbol = kNO_SYMBOL;
+    
+    // Names seen before, which are almost all of them, are found without the lock.
+    ESXPNameFind(atomic_load_explicit(&self->slots, memory_order_acquire), &self->entries, bytes, length, hash, &symbol);
+    if (symbol == kNO_SYMBOL) {
+        pthread_mutex_lock(&self->lock);
+        struct ESXPNameSlots *slots = atomic_load_explicit(&self->slots, memory_order_relaxed);
+        NSUInteger           slot   = ESXPNameFind(slots, &self->entries, bytes, length, hash, &symbol);
+        if (symbol == kNO_SYMBOL) {
+            symbol = [self addSymbol:bytes length:length hash:hash];
+            atomic_store_explicit(&slots->slots[slot], symbol, memory_order_release);
+            
+            // Keep the load factor under 1/2.
+            if ((NSUInteger) symbol * 2 > slots->count)
+                [self rehash];
+        }
+        pthread_mutex_unlock(&self->lock);
+    }
+    
+    if (interned != NULL)
+        *interned = (__bridge NSString *) atomic_load_explicit(&self->entries, memory_order_acquire)->entries[symbol].name;
+    
+    return symbol;
+}
+
+- (NSUInteger)symbolForName:(NSString *)name
+{
+    const char *bytes = [name UTF8String];
+    return [self symbolForBytes:bytes length:strlen(bytes)];
+}
+
+- (NSUInteger)symbolForBytes:(const char *)bytes length:(NSUInteger)length
+{
+    // A name being added by another thread right now may not be found yet, as if it came
+    // a moment later. One added before, on this thread or one it waited for, is.
+    uint32_t symbol = kNO_SYMBOL;
+    ESXPNameFind(atomic_load_explicit(&self->slots, memory_order_acquire), &self->entries, bytes, length, ESXPNameHash(bytes, length), &symbol);
+    
+    return symbol;
+}
+
+- (NSString *)nameForSymbol:(NSUInteger)symbol
+{
+    if (symbol == kNO_SYMBOL || symbol >= atomic_load_explicit(&self->used, memory_order_acquire))
+        return nil;
+    
+    return (__bridge NSString *) atomic_load_explicit(&self->entries, memory_order_acquire)->entries[symbol].name;
+}
+
+- (NSUInteger)count { return atomic_load_explicit(&self->used, memory_order_acquire) - 1; }
+
+- (NSUInteger)getByteCount
+{
+    pthread_mutex_lock(&self->lock);
+    NSUInteger bytes = [self->names count] * (sizeof(id) + kOBJECT_BYTES);
+    for (struct ESXPNameEntries *entries = atomic_load(&self->entries); entries != NULL; entries = entries->previous)
+        bytes += sizeof(struct ESXPNameEntries) + entries->capacity * sizeof(struct ESXPNameEntry);
+    for (struct ESXPNameSlots *slots = atomic_load(&self->slots); slots != NULL; slots = slots->previous)
+        bytes += sizeof(struct ESXPNameSlots) + slots->count * sizeof(uint32_t);
+    for (struct ESXPNamePool *pool = self->pool; pool != NULL; pool = pool->previous)
+        bytes += sizeof(struct ESXPNamePool) + pool->capacity + pool->length; // The length again for the strings.
+    pthread_mutex_unlock(&self->lock);
+    
+    return bytes;
+}
+
+// MARK: Private Methods
+/// Adds a symbol for a name, with the lock taken. The entry is complete before the symbol
+/// is published, in the count and then in a slot by the caller.
+- (uint32_t)addSymbol:(const char *)bytes length:(NSUInteger)length hash:(uint32_t)hash
+{
+    NSUInteger             symbol   = [self->names count];
+    struct ESXPNameEntries *entries = atomic_load_explicit(&self->entries, memory_order_relaxed);
+    if (symbol == entries->capacity) {
+        struct ESXPNameEntries *grown = calloc(1, sizeof(struct ESXPNameEntries) + entries->capacity * 2 * sizeof(struct ESXPNameEntry));
+        memcpy(grown->entries, entries->entries, entries->capacity * sizeof(struct ESXPNameEntry));
+        grown->previous = entries;
+        grown->capacity = entries->capacity * 2;
+        entries         = grown;
+    }
+    
+    if (self->pool->length + length > self->pool->capacity) {
+        NSUInteger          capacity = MAX(self->pool->capacity * 2, length);
+        struct ESXPNamePool *chunk   = calloc(1, sizeof(struct ESXPNamePool) + capacity);
+        chunk->previous = self->pool;
+        chunk->capacity = capacity;
+        self->pool      = chunk;
+    }
+    
+    char *copy = self->pool->bytes + self->pool->length;
+    memcpy(copy, bytes, length);
+    self->pool->length += length;
+    
+    NSString *name = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+    [self->names addObject:name != nil ? name : @""];
+    entries->entries[symbol] = (struct ESXPNameEntry) { hash, (uint32_t) length, copy, (__bridge void *) [self->names lastObject] };
+    
+    atomic_store_explicit(&self->entries, entries, memory_order_release);
+    atomic_store_explicit(&self->used, symbol + 1, memory_order_release);
+    return (uint32_t) symbol;
+}
+
+/// Publishes slots twice as many, with the lock taken.
+- (void)rehash
+{
+    struct ESXPNameSlots   *slots   = atomic_load_explicit(&self->slots, memory_order_relaxed);
+    struct ESXPNameEntries *entries = atomic_load_explicit(&self->entries, memory_order_relaxed);
+    struct ESXPNameSlots   *grown   = ESXPNameSlotsNew(slots->count * 2, slots);
+    NSUInteger             mask     = grown->count - 1;
+    for (NSUInteger symbol = 1; symbol < [self->names count]; symbol++) {
+        NSUInteger slot = entries->entries[symbol].hash & mask;
+        while (atomic_load_explicit(&grown->slots[slot], memory_order_relaxed) != kNO_SYMBOL)
+            slot = (slot + 1) & mask;
+        atomic_store_explicit(&grown->slots[slot], (uint32_t) symbol, memory_order_relaxed);
+    }
+    
+    atomic_store_explicit(&self->slots, grown, memory_order_release);
+}
+@end
+
+@implementation ESXPResolvedNames
+// MARK: Builders
++ (ESXPResolvedNames *)newBuild:(NSArray *)names nameTable:(ESXPNameTable *)nameTable
+{
+    ESXPResolvedNames *instance = [[ESXPResolvedNames alloc] init];
+    if (instance) {
+        instance->nameTable = nameTable;
+        instance->count     = [names count];
+        instance->symbols   = calloc(MAX(instance->count, (NSUInteger) 1), sizeof(NSUInteger));
+        instance->complete  = YES;
+        for (NSUInteger i = 0; i < instance->count; i++) {
+            id name = [names objectAtIndex:i];
+            if (name == [NSNull null])
+                continue;
+            
+            instance->symbols[i] = [nameTable symbolForName:name];
+            if (instance->symbols[i] == kNO_SYMBOL)
+                instance->complete = NO;
+        }
+        
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc { free(self->symbols); }
+
+// MARK: Methods
+- (BOOL)isFor:(ESXPNameTable *)table { return self->nameTable == table; }
+
+- (BOOL)isComplete { return self->complete; }
+
+- (const NSUInteger *)getSymbols { return self->symbols; }
+
+- (NSUInteger)count { return self->count; }
+@end
@@ -101,7 +101,15 @@ typedef enum Nodes : unsigned short
 /// Counts all element nodes inside this node.
 ///
 /// \param counter The counter.
-- (void)countElementNodes:(unsigned short *)counter;
+- (void)countElementNodes:(uint64_t *)counter;
+
+/// Retrieves an attribute value by name.
+///
+/// \param attributeName The name of the attribute to retrieve.
+///
+/// \return The value of the attribute, or nil if this node is not an Element
+///         or it has no such attribute.
+- (NSString *)getAttribute:(NSString *)attributeName;
 
 /// A dictionary containing the attributes of this node (if it is an
 /// Element) or null otherwise.
@@ -142,11 +150,22 @@ typedef enum Nodes : unsigned short
 /// \return The namespace URI of this node, or null if it is unspecified.
 - (NSString *)getNamespaceURI;
 
+/// The node immediately following this node. If there is no such node, this returns null.
+///
+/// \return The next sibling of this node.
+- (id<ESXPNode>)getNextSibling;
+
 /// The name of this node, depending on its type; see the table above.
 ///
 /// \return The name of this node.
 - (NSString *)getNodeName;
 
+/// The interned symbol of the name of this node, see ESXPNameTable. Two nodes built
+/// with the same name table have the same name if and only if they have the same symbol.
+///
+/// \return The symbol of the name of this node, or kNO_SYMBOL if the name was not interned.
+- (NSUInteger)getNodeSymbol;
+
 /// A code representing the type of the underlying object, as defined above.
 ///
 /// \return A code representing the type of the underlying object, as defined above.
@@ -167,6 +186,11 @@ typedef enum Nodes : unsigned short
 /// \return The parent node of this node.
 - (id<ESXPNode>)getParentNode;
 
+/// The node immediately preceding this node. If there is no such node, this returns null.
+///
+/// \return The previous sibling of this node.
+- (id<ESXPNode>)getPreviousSibling;
+
 /// Returns whether this node (if it is an element) has any attributes.
 ///
 /// \return Returns true if this node has any attributes, false otherwise.
@@ -200,6 +224,13 @@ typedef enum Nodes : unsigned short
 /// \return Returns true if the nodes are the same, false otherwise.
 - (BOOL)isSameNode:(id<ESXPNode>)other;
 
+/// Sets the links of this node to its siblings. Called by the parent whenever its
+/// children change, not meant to be called by anyone else.
+///
+/// \param previousSibling The node immediately preceding this node, or nil.
+/// \param nextSibling     The node immediately following this node, or nil.
+- (void)linkSiblings:(id<ESXPNode>)previousSibling next:(id<ESXPNode>)nextSibling;
+
 /// Look up the namespace URI associated to the given prefix, starting from this node.
 ///
 /// \param prefix The prefix to look for. If this parameter is null, the method will
@@ -26,10 +26,23 @@
 
 #import <Foundation/Foundation.h>
 #import "ESXPDocument.h"
+#import "ESXPFieldSet.h"
+#import "ESXPQuery.h"
 #import "ESXPStackDOMWalker.h"
 
 /// XML Processor.
 ///
+/// <p>
+/// The search methods look the tag up in the tag index of the document when it has one,
+/// and only walk the tree when it has not.
+/// </p>
+///
+/// <p>
+/// The methods taking a count of threads split their work among that many threads and
+/// return the results in document order, as their single threaded versions would. The
+/// document must not change while they run: freeze it first (see ESXPDocument).
+/// </p>
+///
 /// \author Andreas P. Koenzen <akc at apkc.net>
 /// \see    Builder Pattern
 @interface ESXPProcessor : NSObject
@@ -39,7 +52,7 @@
 // MARK: Builders
 /// Builder of new instances. Follows the Builder Pattern.
 ///
-/// \param maxNodes The maximum number of nodes.
+/// \param maxNodes The maximum number of nodes. Only a hint for the size of the walker stacks.
 ///
 /// \return A new instance of this class or nil if any problem.
 + (ESXPProcessor *)newBuild:(NSUInteger)maxNodes;
@@ -118,4 +131,99 @@
 ///
 /// \return The node
 - (id<ESXPNode>)searchNode:(ESXPDocument *)doc rootNodeName:(NSString *)rootNodeName tagName:(NSString *)tagName;
+
+/// Compiles a path expression into a query that can be evaluated many times. See ESXPQuery
+/// for the expressions understood.
+/// <b>Throws:</b> InvalidQueryException: If the expression can not be compiled.
+///
+/// \param expression The path expression, i.e. "/mediawiki/page/revision/id".
+///
+/// \return The compiled query.
+- (ESXPQuery *)compileQuery:(NSString *)expression;
+
+/// Evaluates a query against a document. Relative paths start at the root of the document.
+///
+/// \param query The compiled query.
+/// \param doc   The XML document.
+///
+/// \return The matching nodes in document order.
+- (NSArray *)queryNodes:(ESXPQuery *)query document:(ESXPDocument *)doc;
+
+/// Evaluates a query against a node. Relative paths start at the node.
+///
+/// \param query     The compiled query.
+/// \param node      The context node.
+/// \param nameTable The name table of the document of the node.
+///
+/// \return The matching nodes in document order.
+- (NSArray *)queryNodes:(ESXPQuery *)query node:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable;
+
+/// Evaluates a query against a node and returns the values of the results: the attribute
+/// for attribute paths, otherwise the text as returned by getNodeValue:strict:.
+///
+/// \param query     The compiled query.
+/// \param node      The context node.
+/// \param nameTable The name table of the document of the node.
+///
+/// \return The values in document order.
+- (NSArray *)queryValues:(ESXPQuery *)query node:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable;
+
+/// Evaluates a query against a node and returns the value of the first result, stopping
+/// the traversal as soon as it is found.
+/// <b>Throws:</b> TagNotFoundException: If nothing matched.
+///
+/// \param query     The compiled query.
+/// \param node      The context node.
+/// \param nameTable The name table of the document of the node.
+/// \param strict    If TRUE this method will raise an exception if nothing matched. If
+///                  FALSE will return an empty string.
+///
+/// \return The value of the first result.
+- (NSString *)queryValue:(ESXPQuery *)query node:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable strict:(BOOL)strict;
+
+/// Extracts a set of fields from the descendants of a node in a single traversal. See
+/// ESXPFieldSet.
+///
+/// \param fields    The fields to extract.
+/// \param node      The root of the subtree, i.e. a record.
+/// \param nameTable The name table of the document of the node.
+///
+/// \return The value of every field in the order they were added, empty strings for the
+///         ones not found.
+- (NSArray *)extractFields:(ESXPFieldSet *)fields node:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable;
+
+/// Returns all elements with a given name, on many threads. The children of the topmost
+/// element with more than one child element are split among the threads.<br/>
+/// <b>Throws:</b> UnfrozenDocumentException: If the document is not frozen.
+///
+/// \param doc     The XML document, which must be frozen.
+/// \param tagName The name of the elements.
+/// \param threads The count of threads, 0 for one per core.
+///
+/// \return The elements in document order, empty if there are none.
+- (NSArray *)searchNodes:(ESXPDocument *)doc tagName:(NSString *)tagName threads:(NSUInteger)threads;
+
+/// Evaluates a query on many nodes, on many threads.<br/>
+/// <b>Throws:</b> UnfrozenDocumentException: If the document is not frozen.
+///
+/// \param query   The compiled query.
+/// \param nodes   The context nodes, i.e. records.
+/// \param doc     The XML document of the nodes, which must be frozen.
+/// \param threads The count of threads, 0 for one per core.
+///
+/// \return For every node, in the same order, the first value the query matches or an
+///         empty string.
+- (NSArray *)queryValues:(ESXPQuery *)query nodes:(NSArray *)nodes document:(ESXPDocument *)doc threads:(NSUInteger)threads;
+
+/// Extracts many fields from many nodes, on many threads.<br/>
+/// <b>Throws:</b> UnfrozenDocumentException: If the document is not frozen.
+///
+/// \param fields  The fields to extract.
+/// \param nodes   The roots of the subtrees, i.e. records.
+/// \param doc     The XML document of the nodes, which must be frozen.
+/// \param threads The count of threads, 0 for one per core.
+///
+/// \return For every node, in the same order, the array extractFields:node:nameTable:
+///         would return.
+- (NSArray *)extractFields:(ESXPFieldSet *)fields nodes:(NSArray *)nodes document:(ESXPDocument *)doc threads:(NSUInteger)threads;
 @end
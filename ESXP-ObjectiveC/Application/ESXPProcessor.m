@@ -24,6 +24,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#import "ESXPConstants.h"
+#import "ESXPMetrics.h"
 #import "ESXPProcessor.h"
 
 @implementation ESXPProcessor
@@ -43,12 +45,9 @@
 // MARK: Methods
 - (NSString *)searchTagValue:(ESXPDocument *)doc rootNodeName:(NSString *)rootNodeName tagName:(NSString *)tagName strict:(BOOL)strict
 {
-    ESXPStackDOMWalker *walker = [[ESXPStackDOMWalker newBuild] configure:self->_maxNodes rootNode:[doc getRootNode] nodesToProcess:ELEMENT_NODE];
-    while ([walker hasNext]) {
-        id<ESXPNode> node = [walker nextNode];
-        if ([[node getNodeName] isEqualToString:tagName])
-            return [self getNodeValue:node strict:strict];
-    }
+    id<ESXPNode> node = [self firstNode:doc tagName:tagName];
+    if (node != nil)
+        return [self getNodeValue:node strict:strict];
     
     if (strict)
         @throw [NSException exceptionWithName:@"TagNotFoundException"
@@ -60,34 +59,28 @@
 
 - (NSString *)searchTagAttributeValue:(ESXPDocument *)doc rootNodeName:(NSString *)rootNodeName tagName:(NSString *)tagName attributeName:(NSString *)attributeName strict:(BOOL)strict
 {
-    ESXPStackDOMWalker *walker = [[ESXPStackDOMWalker newBuild] configure:self->_maxNodes rootNode:[doc getRootNode] nodesToProcess:ELEMENT_NODE];
-    while ([walker hasNext]) {
-        id<ESXPNode> node = [walker nextNode];
-        if ([node getNodeType] == ELEMENT_NODE) {
-            if ([[node getNodeName] isEqualToString:tagName]) {
-                NSDictionary *attributes = [node getAttributes];
-                if (attributes == nil) {
-                    if (strict)
-                        @throw [NSException exceptionWithName:@"AttributeNotFoundException"
-                                                       reason:[NSString stringWithFormat:@"The tag \"%@\" does not contain attributes.", tagName]
-                                                     userInfo:nil];
-                    else
-                        return @"";
-                }
-                else {
-                    NSString *attribute = [attributes objectForKey:attributeName];
-                    if (attribute == nil) {
-                        if (strict)
-                            @throw [NSException exceptionWithName:@"AttributeNotFoundException"
-                                                           reason:[NSString stringWithFormat:@"The attribute \"%@\" does not exists.", attributeName]
-                                                         userInfo:nil];
-                        else
-                            return @"";
-                    }
-                    else {
-                        return attribute;
-                    }
-                }
+    id<ESXPNode> node = [self firstNode:doc tagName:tagName];
+    if (node != nil) {
+        if (![node hasAttributes]) {
+            if (strict)
+                @throw [NSException exceptionWithName:@"AttributeNotFoundException"
+                                               reason:[NSString stringWithFormat:@"The tag \"%@\" does not contain attributes.", tagName]
+                                             userInfo:nil];
+            else
+                return @"";
+        }
+        else {
+            NSString *attribute = [node getAttribute:attributeName];
+            if (attribute == nil) {
+                if (strict)
+                    @throw [NSException exceptionWithName:@"AttributeNotFoundException"
+                                                   reason:[NSString stringWithFormat:@"The attribute \"%@\" does not exists.", attributeName]
+                                                 userInfo:nil];
+                else
+                    return @"";
+            }
+            else {
+                return attribute;
             }
         }
     }
@@ -108,8 +101,7 @@
                                      userInfo:nil];
     }
     
-    NSDictionary *attributes = [node getAttributes];
-    if (attributes == nil) {
+    if (![node hasAttributes]) {
         if (strict)
             @throw [NSException exceptionWithName:@"AttributeNotFoundException"
                                            reason:@"The node does not contain attributes."
@@ -118,7 +110,7 @@
             return @"";
     }
     else {
-        NSString *attribute = [attributes objectForKey:attributeName];
+        NSString *attribute = [node getAttribute:attributeName];
         if (attribute == nil) {
             if (strict)
                 @throw [NSException exceptionWithName:@"AttributeNotFoundException"
@@ -135,14 +127,12 @@
 
 - (NSString *)getNodeValue:(id<ESXPNode>)node strict:(BOOL)strict
 {
-    ESXPStackDOMWalker *walker = [[ESXPStackDOMWalker newBuild] configure:self->_maxNodes rootNode:(ESXPElement *)node nodesToProcess:TEXT_NODE];
-    while ([walker hasNext]) {
-        id<ESXPNode> node = [walker nextNode];
-        if ([node getNodeType] == COMMENT_NODE)
-            [walker skipChildren];
-        
-        if ([node getNodeType] == TEXT_NODE) {
-            NSString *text = [node getNodeValue];
+    // Text nodes have no children, so only the node and its direct text children can
+    // hold the text. No walker is needed.
+    NSArray *candidates = ([node getNodeType] == TEXT_NODE) ? @[ node ] : [node getChildNodes];
+    for (id<ESXPNode> candidate in candidates) {
+        if ([candidate getNodeType] == TEXT_NODE) {
+            NSString *text = [candidate getNodeValue];
             if ([text length] > 0)
                 return text;
         }
@@ -177,15 +167,242 @@
 
 - (id<ESXPNode>)searchNode:(ESXPDocument *)doc rootNodeName:(NSString *)rootNodeName tagName:(NSString *)tagName
 {
-    ESXPStackDOMWalker *walker = [[ESXPStackDOMWalker newBuild] configure:self->_maxNodes rootNode:[doc getRootNode] nodesToProcess:ELEMENT_NODE];
-    while ([walker hasNext]) {
-        id<ESXPNode> node = [walker nextNode];
-        if ([[node getNodeName] isEqualToString:tagName])
-            return node;
-    }
+    id<ESXPNode> node = [self firstNode:doc tagName:tagName];
+    if (node != nil)
+        return node;
     
     @throw [NSException exceptionWithName:@"NodeNotFoundException"
                                    reason:[NSString stringWithFormat:@"The node \"%@\" was not found in the XML.", tagName]
                                  userInfo:nil];
 }
+
+- (ESXPQuery *)compileQuery:(NSString *)expression
+{
+    NSError   *error = nil;
+    ESXPQuery *query = [ESXPQuery newBuild:expression error:&error];
+    if (query == nil)
+        @throw [NSException exceptionWithName:@"InvalidQueryException"
+                                       reason:[error localizedDescription]
+                                     userInfo:nil];
+    
+    return query;
+}
+
+- (NSArray *)queryNodes:(ESXPQuery *)query document:(ESXPDocument *)doc { return [self evaluate:query node:[doc getRootNode] nameTable:[doc getNameTable] limit:NSUIntegerMax]; }
+
+- (NSArray *)queryNodes:(ESXPQuery *)query node:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable { return [self evaluate:query node:node nameTable:nameTable limit:NSUIntegerMax]; }
+
+- (NSArray *)queryValues:(ESXPQuery *)query node:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable
+{
+    NSArray        *nodes  = [self evaluate:query node:node nameTable:nameTable limit:NSUIntegerMax];
+    NSMutableArray *values = [NSMutableArray arrayWithCapacity:[nodes count]];
+    for (id<ESXPNode> n in nodes)
+        [values addObject:[self valueOf:n query:query]];
+    
+    return values;
+}
+
+- (NSString *)queryValue:(ESXPQuery *)query node:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable strict:(BOOL)strict
+{
+    NSArray *nodes = [self evaluate:query node:node nameTable:nameTable limit:1];
+    if ([nodes count] > 0)
+        return [self valueOf:[nodes objectAtIndex:0] query:query];
+    
+    if (strict)
+        @throw [NSException exceptionWithName:@"TagNotFoundException"
+                                       reason:[NSString stringWithFormat:@"Nothing matched \"%@\" in the XML.", [query getExpression]]
+                                     userInfo:nil];
+    else
+        return @"";
+}
+
+- (NSArray *)extractFields:(ESXPFieldSet *)fields node:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable
+{
+    uint64_t start   = ESXPMetricsEnabled() ? [ESXPMetrics beginPhase:PHASE_EXTRACT] : 0;
+    NSArray  *values = [fields extract:node nameTable:nameTable];
+    [self endPhase:PHASE_EXTRACT start:start results:0];
+    
+    return values;
+}
+
+- (NSArray *)searchNodes:(ESXPDocument *)doc tagName:(NSString *)tagName threads:(NSUInteger)threads
+{
+    [self checkFrozen:doc];
+    if ([doc hasTagIndex])
+        return [doc getElementsByTagName:tagName];
+    
+    NSUInteger     symbol = [[doc getNameTable] symbolForName:tagName];
+    NSMutableArray *found = [NSMutableArray new];
+    
+    // Go down the single child elements (the document element, usually), the records are
+    // the children of the first element with many.
+    id<ESXPNode> top = [doc getRootNode];
+    for (;;) {
+        if (ESXPNodeNamed(top, symbol, tagName))
+            [found addObject:top];
+        
+        id<ESXPNode> only  = nil;
+        NSUInteger   count = 0;
+        for (id<ESXPNode> child in [top getChildNodes]) {
+            if ([child getNodeType] == ELEMENT_NODE) {
+                only = child;
+                count++;
+            }
+        }
+        
+        if (count != 1)
+            break;
+        
+        top = only;
+    }
+    
+    NSArray *children = [top getChildNodes];
+    [found addObjectsFromArray:[self inParallel:[children count] threads:threads work:^(NSRange range, NSMutableArray *results) {
+        ESXPStackDOMWalker *walker = [ESXPStackDOMWalker borrow];
+        for (NSUInteger i = range.location; i < NSMaxRange(range); i++) {
+            id<ESXPNode> child = [children objectAtIndex:i];
+            if ([child getNodeType] != ELEMENT_NODE)
+                continue;
+            
+            [walker configure:self->_maxNodes rootNode:child nodesToProcess:ELEMENT_NODE];
+            for (id<ESXPNode> node in walker)
+                if (ESXPNodeNamed(node, symbol, tagName))
+                    [results addObject:node];
+        }
+        [ESXPStackDOMWalker giveBack:walker];
+    }]];
+    
+    return found;
+}
+
+- (NSArray *)queryValues:(ESXPQuery *)query nodes:(NSArray *)nodes document:(ESXPDocument *)doc threads:(NSUInteger)threads
+{
+    [self checkFrozen:doc];
+    ESXPNameTable *nameTable = [doc getNameTable];
+    return [self inParallel:[nodes count] threads:threads work:^(NSRange range, NSMutableArray *results) {
+        for (NSUInteger i = range.location; i < NSMaxRange(range); i++)
+            [results addObject:[self queryValue:query node:[nodes objectAtIndex:i] nameTable:nameTable strict:NO]];
+    }];
+}
+
+- (NSArray *)extractFields:(ESXPFieldSet *)fields nodes:(NSArray *)nodes document:(ESXPDocument *)doc threads:(NSUInteger)threads
+{
+    [self checkFrozen:doc];
+    ESXPNameTable *nameTable = [doc getNameTable];
+    return [self inParallel:[nodes count] threads:threads work:^(NSRange range, NSMutableArray *results) {
+        for (NSUInteger i = range.location; i < NSMaxRange(range); i++)
+            [results addObject:[self extractFields:fields node:[nodes objectAtIndex:i] nameTable:nameTable]];
+    }];
+}
+
+// MARK: Private Methods
+/// Checks that a document is frozen before it is read from many threads.<br/>
+/// <b>Throws:</b> UnfrozenDocumentException: If the document is not frozen.
+///
+/// \param doc The XML document.
+- (void)checkFrozen:(ESXPDocument *)doc
+{
+    if (![doc isFrozen])
+        @throw [NSException exceptionWithName:@"UnfrozenDocumentException"
+                                       reason:@"The document must be frozen before it is read from many threads."
+                                     userInfo:nil];
+}
+
+/// Finds the first element with a given name in document order, from the tag index of the
+/// document if it has one, or else walking the tree.
+///
+/// \param doc     The XML document.
+/// \param tagName The name of the element.
+///
+/// \return The element, or nil if not found.
+- (id<ESXPNode>)firstNode:(ESXPDocument *)doc tagName:(NSString *)tagName
+{
+    if ([doc hasTagIndex]) {
+        NSArray *postings = [doc getElementsByTagName:tagName];
+        return [postings count] > 0 ? [postings objectAtIndex:0] : nil;
+    }
+    
+    uint64_t           start  = ESXPMetricsEnabled() ? [ESXPMetrics beginPhase:PHASE_SEARCH] : 0;
+    NSUInteger         symbol = [[doc getNameTable] symbolForName:tagName];
+    ESXPStackDOMWalker *walker = [[ESXPStackDOMWalker borrow] configure:self->_maxNodes rootNode:[doc getRootNode] nodesToProcess:ELEMENT_NODE];
+    id<ESXPNode>       found  = nil;
+    for (id<ESXPNode> node in walker) {
+        if (ESXPNodeNamed(node, symbol, tagName)) {
+            found = node;
+            break;
+        }
+    }
+    
+    [ESXPStackDOMWalker giveBack:walker];
+    [self endPhase:PHASE_SEARCH start:start results:(found != nil)];
+    return found;
+}
+
+/// Splits a count of items into ranges, runs a piece of work on each range on many
+/// threads and joins the results of the ranges in order.
+///
+/// \param count   The count of items.
+/// \param threads The count of threads, 0 for one per core.
+/// \param work    The work, which adds the results of a range to the given array.
+///
+/// \return The results of all ranges.
+- (NSArray *)inParallel:(NSUInteger)count threads:(NSUInteger)threads work:(void (^)(NSRange range, NSMutableArray *results))work
+{
+    if (threads == 0)
+        threads = [[NSProcessInfo processInfo] activeProcessorCount];
+    
+    uint64_t phaseStart = ESXPMetricsEnabled() ? [ESXPMetrics beginPhase:PHASE_PARALLEL] : 0;
+    
+    // A few ranges per thread, so that a slow range does not hold up the rest.
+    NSUInteger       rangeCount = MIN(count, threads * 4);
+    NSMutableArray   *ranges    = [NSMutableArray arrayWithCapacity:rangeCount];
+    NSOperationQueue *queue     = [NSOperationQueue new];
+    queue.maxConcurrentOperationCount = threads;
+    for (NSUInteger i = 0; i < rangeCount; i++) {
+        NSUInteger     start   = count * i / rangeCount;
+        NSUInteger     end     = count * (i + 1) / rangeCount;
+        NSMutableArray *results = [NSMutableArray new];
+        [ranges addObject:results];
+        [queue addOperationWithBlock:^{
+            @autoreleasepool {
+                work(NSMakeRange(start, end - start), results);
+            }
+        }];
+    }
+    [queue waitUntilAllOperationsAreFinished];
+    
+    NSMutableArray *joined = [NSMutableArray arrayWithCapacity:count];
+    for (NSArray *results in ranges)
+        [joined addObjectsFromArray:results];
+    
+    [self endPhase:PHASE_PARALLEL start:phaseStart results:0];
+    return joined;
+}
+
+/// Evaluates a query, measuring it while metrics are on.
+- (NSArray *)evaluate:(ESXPQuery *)query node:(id<ESXPNode>)node nameTable:(ESXPNameTable *)nameTable limit:(NSUInteger)limit
+{
+    uint64_t start  = ESXPMetricsEnabled() ? [ESXPMetrics beginPhase:PHASE_QUERY] : 0;
+    NSArray  *nodes = [query evaluate:node nameTable:nameTable limit:limit];
+    [self endPhase:PHASE_QUERY start:start results:[nodes count]];
+    
+    return nodes;
+}
+
+/// Ends a phase begun while metrics were on, counting the nodes it found.
+- (void)endPhase:(MetricPhases)phase start:(uint64_t)start results:(NSUInteger)results
+{
+    if (start == 0)
+        return;
+    
+    if (results > 0)
+        [ESXPMetrics add:results counter:METRIC_QUERY_RESULTS];
+    [ESXPMetrics endPhase:phase start:start];
+}
+
+- (NSString *)valueOf:(id<ESXPNode>)node query:(ESXPQuery *)query
+{
+    NSString *attributeName = [query getAttributeName];
+    return attributeName != nil ? [node getAttribute:attributeName] : [self getNodeValue:node strict:NO];
+}
 @end
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import <pthread.h>
+#import "ESXPNameTable.h"
+
+@class ESXPBoundProjection;
+
+/// A set of element paths to build, everything else being skipped while parsing.
+///
+/// <p>
+/// A path is a list of element names separated by slashes, i.e. "revision/id", and
+/// keeps every element whose innermost ancestors have those names, together with its
+/// whole subtree. A path that starts with a slash, i.e. "/mediawiki/siteinfo", is
+/// anchored: it is matched from the document element only. Matching is done on the
+/// names of the open elements, so ESXPSAX2DOM can decide at every start tag, before any
+/// node is built.
+/// </p>
+///
+/// <p>
+/// Names are interned into the name table of the builder once per parse with bind:,
+/// which hands back the matcher for that parse. The projection itself never changes while
+/// builders parse, so it can be shared by many of them, even on many threads.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPProjection : NSObject
+{
+    NSMutableArray  *paths;    // The names of each path.
+    NSMutableData   *anchored; // If each path is matched from the document element only, a BOOL each.
+    pthread_mutex_t lock;
+}
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPProjection *)newBuild;
+
+/// Builder of new instances holding the given paths. Follows the Builder Pattern.
+///
+/// \param paths The paths to keep, i.e. @[ @"page/title", @"revision/id" ].
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPProjection *)newBuild:(NSArray *)paths;
+
+// MARK: Methods
+/// Adds a path to this projection.
+///
+/// \param path The names of the element to keep and of its innermost ancestors, separated
+///             by slashes. A leading slash anchors the path at the document element.
+- (void)addPath:(NSString *)path;
+
+/// Interns the names of all paths into a name table, to match the symbols of its names.
+///
+/// \param nameTable The name table of the document being built.
+///
+/// \return The paths as symbols of that table, owned by the caller for its parse.
+- (ESXPBoundProjection *)bind:(ESXPNameTable *)nameTable;
+
+/// Returns the count of paths in this projection.
+///
+/// \return The count of paths in this projection.
+- (NSUInteger)count;
+@end
+
+/// The paths of a projection as symbols of one name table, made by ESXPProjection bind:.
+/// Never changes once made.
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPBoundProjection : NSObject
+{
+    NSUInteger *symbols;   // The symbols of the names of all paths, one path after the other.
+    NSUInteger *starts;    // The offset of each path in symbols.
+    BOOL       *anchored;  // If each path is matched from the document element only.
+    NSUInteger pathCount;  // The count of paths.
+}
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param paths     The names of each path.
+/// \param anchored  If each path is matched from the document element only, a BOOL each.
+/// \param nameTable The name table to intern the names into.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPBoundProjection *)newBuild:(NSArray *)paths anchored:(NSData *)anchored nameTable:(ESXPNameTable *)nameTable;
+
+// MARK: Methods
+/// Tests whether an element is kept, given the names of the open elements down to it.
+///
+/// \param openSymbols The symbols of the open elements, from the document element to the
+///                    element itself, in the table this projection was bound to.
+/// \param count       The count of open elements.
+///
+/// \return YES if a path matches the element.
+- (BOOL)keeps:(const NSUInteger *)openSymbols count:(NSUInteger)count;
+@end
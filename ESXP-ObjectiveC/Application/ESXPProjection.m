@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ESXPConstants.h"
+#import "ESXPProjection.h"
+
+@implementation ESXPProjection
+// MARK: Builders
++ (ESXPProjection *)newBuild
+{
+    ESXPProjection *instance = [[ESXPProjection alloc] init];
+    if (instance) {
+        instance->paths    = [NSMutableArray new];
+        instance->anchored = [NSMutableData new];
+        pthread_mutex_init(&instance->lock, NULL);
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
++ (ESXPProjection *)newBuild:(NSArray *)paths
+{
+    ESXPProjection *instance = [ESXPProjection newBuild];
+    if (instance) {
+        for (NSString *path in paths)
+            [instance addPath:path];
+        
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc { pthread_mutex_destroy(&self->lock); }
+
+// MARK: Methods
+- (void)addPath:(NSString *)path
+{
+    BOOL    isAnchored = [path hasPrefix:@"/"];
+    NSArray *names     = [(isAnchored ? [path substringFromIndex:1] : path) componentsSeparatedByString:@"/"];
+    for (NSString *name in names)
+        if ([name length] == 0)
+            @throw [NSException exceptionWithName:@"InvalidPathException"
+                                           reason:[NSString stringWithFormat:@"The path \"%@\" has an empty name.", path]
+                                         userInfo:nil];
+    
+    pthread_mutex_lock(&self->lock);
+    [self->paths addObject:names];
+    [self->anchored appendBytes:&isAnchored length:sizeof(BOOL)];
+    pthread_mutex_unlock(&self->lock);
+}
+
+- (ESXPBoundProjection *)bind:(ESXPNameTable *)nameTable
+{
+    pthread_mutex_lock(&self->lock);
+    NSArray *boundPaths    = [self->paths copy];
+    NSData  *boundAnchored = [self->anchored copy];
+    pthread_mutex_unlock(&self->lock);
+    
+    return [ESXPBoundProjection newBuild:boundPaths anchored:boundAnchored nameTable:nameTable];
+}
+
+- (NSUInteger)count { return [self->paths count]; }
+@end
+
+@implementation ESXPBoundProjection
+// MARK: Builders
++ (ESXPBoundProjection *)newBuild:(NSArray *)paths anchored:(NSData *)anchored nameTable:(ESXPNameTable *)nameTable
+{
+    ESXPBoundProjection *instance = [[ESXPBoundProjection alloc] init];
+    if (instance) {
+        NSUInteger total = 0;
+        for (NSArray *names in paths)
+            total += [names count];
+        
+        instance->pathCount = [paths count];
+        instance->symbols   = malloc(MAX(total, (NSUInteger) 1) * sizeof(NSUInteger));
+        instance->starts    = malloc((instance->pathCount + 1) * sizeof(NSUInteger));
+        instance->anchored  = malloc(MAX(instance->pathCount, (NSUInteger) 1) * sizeof(BOOL));
+        total               = 0;
+        for (NSUInteger i = 0; i < instance->pathCount; i++) {
+            instance->starts[i]   = total;
+            instance->anchored[i] = ((const BOOL *) [anchored bytes])[i];
+            for (NSString *name in [paths objectAtIndex:i])
+                instance->symbols[total++] = [nameTable internName:name];
+        }
+        instance->starts[instance->pathCount] = total;
+        
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc
+{
+    free(self->symbols);
+    free(self->starts);
+    free(self->anchored);
+}
+
+// MARK: Methods
+- (BOOL)keeps:(const NSUInteger *)openSymbols count:(NSUInteger)count
+{
+    for (NSUInteger i = 0; i < self->pathCount; i++) {
+        NSUInteger length = self->starts[i + 1] - self->starts[i];
+        if (length > count || (self->anchored[i] && length != count))
+            continue;
+        
+        // Compared from the element outwards, as most paths fail on the name of the element.
+        const NSUInteger *path = self->symbols + self->starts[i];
+        const NSUInteger *open = openSymbols + count - length;
+        NSUInteger       j     = length;
+        while (j > 0 && path[j - 1] == open[j - 1])
+            j--;
+        
+        if (j == 0)
+            return YES;
+    }
+    
+    return NO;
+}
+@end
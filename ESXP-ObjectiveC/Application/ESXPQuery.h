@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ESXPDocument.h"
+#import "ESXPNameTable.h"
+#import "ESXPNode.h"
+
+/// A path expression compiled once and evaluated many times.
+///
+/// <p>
+/// The expressions are a small subset of XPath:
+/// </p>
+/// <ul>
+/// <li><b>/a/b</b>: absolute path, starting at the top of the tree of the context node
+///     (the document root, so the first step names the document element).</li>
+/// <li><b>a/b</b>: relative path, starting at the context node.</li>
+/// <li><b>a//b</b> and <b>//b</b>: descendants at any depth.</li>
+/// <li><b>*</b>: any element.</li>
+/// <li><b>b[2]</b>: the second b child of its parent, positions start at 1.</li>
+/// <li><b>a/@id</b>: the attribute id. Allowed only as the last step.</li>
+/// </ul>
+///
+/// <p>
+/// Evaluation is a single depth first traversal: every pending step is tracked as a bit
+/// on the traversal stack, so a node is visited once no matter how many steps may match
+/// it, and results come out in document order without duplicates. Names are resolved to
+/// symbols once per name table, and a query can be shared by many threads.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPQuery : NSObject
+{
+    NSString        *expression;    // The source of this query.
+    BOOL            absolute;       // If the path starts at the top of the tree.
+    NSUInteger      stepCount;      // The count of steps.
+    NSArray         *names;         // The name test of each step, NSNull for "*".
+    BOOL            *descendants;   // If each step is on the descendant axis.
+    NSUInteger      *positions;     // The position predicate of each step, 0 if none.
+    NSString        *attributeName; // The attribute selected by the last step, if any.
+}
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param expression The path expression.
+/// \param error      Set if the expression can not be compiled.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPQuery *)newBuild:(NSString *)expression error:(NSError **)error;
+
+// MARK: Methods
+/// Evaluates this query.
+///
+/// \param context   The node relative paths start from.
+/// \param nameTable The name table of the nodes.
+/// \param limit     The maximum count of results, NSUIntegerMax for all.
+///
+/// \return The matching elements in document order. For attribute paths, the elements
+///         holding the attribute.
+- (NSArray *)evaluate:(id<ESXPNode>)context nameTable:(ESXPNameTable *)nameTable limit:(NSUInteger)limit;
+
+/// Returns the attribute selected by this query.
+///
+/// \return The name of the attribute, or nil if this query selects elements.
+- (NSString *)getAttributeName;
+
+/// Returns the source of this query.
+///
+/// \return The expression this query was compiled from.
+- (NSString *)getExpression;
+@end
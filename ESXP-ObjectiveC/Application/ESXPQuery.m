@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ESXPConstants.h"
+#import "ESXPQuery.h"
+
+@interface ESXPQuery ()
+@property (atomic, strong) ESXPResolvedNames *resolved; // The last complete resolution of the names, read by any thread without a lock.
+@end
+
+@implementation ESXPQuery
+// MARK: Builders
++ (ESXPQuery *)newBuild:(NSString *)expression error:(NSError **)error
+{
+    ESXPQuery *instance = [[ESXPQuery alloc] init];
+    if (instance) {
+        instance->expression = [expression copy];
+        if (![instance compile:error])
+            return nil;
+        
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc
+{
+    free(self->descendants);
+    free(self->positions);
+}
+
+- (NSString *)description { return [NSString stringWithFormat:@"Query: %@", self->expression]; }
+
+// MARK: Methods
+- (NSArray *)evaluate:(id<ESXPNode>)context nameTable:(ESXPNameTable *)nameTable limit:(NSUInteger)limit
+{
+    NSMutableArray *found = [NSMutableArray new];
+    if (context == nil || limit == 0)
+        return found;
+    
+    if (self->absolute)
+        while ([context getParentNode] != nil)
+            context = [context getParentNode];
+    
+    if (self->stepCount == 0) {
+        if (self->attributeName == nil || [context getAttribute:self->attributeName] != nil)
+            [found addObject:context];
+        
+        return found;
+    }
+    
+    NSUInteger symbols[self->stepCount];
+    memcpy(symbols, [[self resolve:nameTable] getSymbols], self->stepCount * sizeof(NSUInteger));
+    
+    // The traversal stack: a node, the steps its children are tested against (one bit
+    // per step) and whether the node itself is a result, emitted when it is popped.
+    NSMutableArray *nodes    = [NSMutableArray arrayWithObject:context];
+    NSUInteger     capacity  = 64;
+    uint64_t       *masks    = malloc(capacity * sizeof(uint64_t));
+    BOOL           *accepts  = malloc(capacity * sizeof(BOOL));
+    NSUInteger     scratch   = 64;
+    uint64_t       *cmasks   = malloc(scratch * sizeof(uint64_t));
+    BOOL           *caccepts = malloc(scratch * sizeof(BOOL));
+    NSUInteger     counts[self->stepCount];
+    masks[0]   = 1;
+    accepts[0] = NO;
+    
+    while ([nodes count] > 0 && [found count] < limit) {
+        NSUInteger   top    = [nodes count] - 1;
+        id<ESXPNode> node   = [nodes lastObject];
+        uint64_t     mask   = masks[top];
+        [nodes removeLastObject];
+        
+        if (accepts[top])
+            [found addObject:node];
+        
+        if (mask == 0)
+            continue;
+        
+        // Test the children forward, positions count in document order.
+        NSArray    *children   = [node getChildNodes];
+        NSUInteger childCount  = [children count];
+        if (childCount > scratch) {
+            scratch  = childCount;
+            cmasks   = realloc(cmasks, scratch * sizeof(uint64_t));
+            caccepts = realloc(caccepts, scratch * sizeof(BOOL));
+        }
+        
+        memset(counts, 0, sizeof(counts));
+        for (NSUInteger c = 0; c < childCount; c++) {
+            id<ESXPNode> child = [children objectAtIndex:c];
+            cmasks[c]   = 0;
+            caccepts[c] = NO;
+            if ([child getNodeType] != ELEMENT_NODE)
+                continue;
+            
+            for (NSUInteger i = 0; i < self->stepCount; i++) {
+                if ((mask & ((uint64_t) 1 << i)) == 0)
+                    continue;
+                
+                if (self->descendants[i])
+                    cmasks[c] |= (uint64_t) 1 << i;
+                
+                if (![self step:i symbol:symbols[i] matches:child])
+                    continue;
+                
+                if (self->positions[i] > 0 && ++counts[i] != self->positions[i])
+                    continue;
+                
+                if (i + 1 < self->stepCount)
+                    cmasks[c] |= (uint64_t) 1 << (i + 1);
+                else if (self->attributeName == nil || [child getAttribute:self->attributeName] != nil)
+                    caccepts[c] = YES;
+            }
+        }
+        
+        // Push backwards, so the first child is popped first.
+        for (NSUInteger c = childCount; c > 0; c--) {
+            if (cmasks[c - 1] == 0 && !caccepts[c - 1])
+                continue;
+            
+            NSUInteger size = [nodes count];
+            if (size == capacity) {
+                capacity *= 2;
+                masks     = realloc(masks, capacity * sizeof(uint64_t));
+                accepts   = realloc(accepts, capacity * sizeof(BOOL));
+            }
+            
+            [nodes addObject:[children objectAtIndex:c - 1]];
+            masks[size]   = cmasks[c - 1];
+            accepts[size] = caccepts[c - 1];
+        }
+    }
+    
+    free(masks);
+    free(accepts);
+    free(cmasks);
+    free(caccepts);
+    
+    return found;
+}
+
+- (NSString *)getAttributeName { return self->attributeName; }
+
+- (NSString *)getExpression { return self->expression; }
+
+// MARK: Private Methods
+- (BOOL)compile:(NSError **)error
+{
+    NSString            *source      = [self->expression stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    NSUInteger          length       = [source length];
+    NSUInteger          i            = 0;
+    BOOL                descendant   = NO;
+    NSMutableArray      *stepNames   = [NSMutableArray new];
+    NSMutableArray      *stepAxes    = [NSMutableArray new];
+    NSMutableArray      *stepIndexes = [NSMutableArray new];
+    
+    if (length == 0)
+        return [self fail:@"The expression is empty." error:error];
+    
+    if ([source hasPrefix:@"//"]) {
+        self->absolute = YES;
+        descendant     = YES;
+        i              = 2;
+    }
+    else if ([source hasPrefix:@"/"]) {
+        self->absolute = YES;
+        i              = 1;
+    }
+    
+    while (YES) {
+        // Attribute, always the last step.
+        if (i < length && [source characterAtIndex:i] == '@') {
+            NSString *name = [self scanName:source from:i + 1 end:&i];
+            if ([name length] == 0 || i != length || descendant)
+                return [self fail:@"An attribute must be the last step, after a single \"/\"." error:error];
+            
+            self->attributeName = name;
+            break;
+        }
+        
+        NSString *name = [self scanName:source from:i end:&i];
+        if ([name length] == 0)
+            return [self fail:[NSString stringWithFormat:@"Missing step name at %lu.", (unsigned long) i] error:error];
+        
+        NSUInteger position = 0;
+        if (i < length && [source characterAtIndex:i] == '[') {
+            NSRange close = [source rangeOfString:@"]" options:0 range:NSMakeRange(i, length - i)];
+            if (close.location == NSNotFound)
+                return [self fail:@"Missing \"]\"." error:error];
+            
+            NSString *number = [source substringWithRange:NSMakeRange(i + 1, close.location - i - 1)];
+            position = (NSUInteger) [number integerValue];
+            if (position == 0 || [[number stringByTrimmingCharactersInSet:[NSCharacterSet decimalDigitCharacterSet]] length] > 0)
+                return [self fail:[NSString stringWithFormat:@"Invalid position \"%@\", positions start at 1.", number] error:error];
+            
+            i = close.location + 1;
+        }
+        
+        [stepNames addObject:[name isEqualToString:@"*"] ? [NSNull null] : name];
+        [stepAxes addObject:@(descendant)];
+        [stepIndexes addObject:@(position)];
+        
+        if (i == length)
+            break;
+        
+        if ([source characterAtIndex:i] != '/')
+            return [self fail:[NSString stringWithFormat:@"Unexpected \"%C\" at %lu.", [source characterAtIndex:i], (unsigned long) i] error:error];
+        
+        descendant = (i + 1 < length && [source characterAtIndex:i + 1] == '/');
+        i         += descendant ? 2 : 1;
+        if (i == length)
+            return [self fail:@"The expression ends with \"/\"." error:error];
+    }
+    
+    if ([stepNames count] > 64)
+        return [self fail:@"Too many steps, the maximum is 64." error:error];
+    
+    self->stepCount     = [stepNames count];
+    self->names         = stepNames;
+    self->descendants   = calloc(MAX(self->stepCount, (NSUInteger) 1), sizeof(BOOL));
+    self->positions     = calloc(MAX(self->stepCount, (NSUInteger) 1), sizeof(NSUInteger));
+    for (NSUInteger s = 0; s < self->stepCount; s++) {
+        self->descendants[s] = [[stepAxes objectAtIndex:s] boolValue];
+        self->positions[s]   = [[stepIndexes objectAtIndex:s] unsignedIntegerValue];
+    }
+    
+    return YES;
+}
+
+- (NSString *)scanName:(NSString *)source from:(NSUInteger)start end:(NSUInteger *)end
+{
+    NSUInteger i = start;
+    while (i < [source length]) {
+        unichar c = [source characterAtIndex:i];
+        if (c == '/' || c == '[' || c == '@')
+            break;
+        i++;
+    }
+    
+    *end = i;
+    return [[source substringWithRange:NSMakeRange(start, i - start)] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+}
+
+- (ESXPResolvedNames *)resolve:(ESXPNameTable *)nameTable
+{
+    ESXPResolvedNames *resolved = self.resolved;
+    if (resolved != nil && [resolved isFor:nameTable])
+        return resolved;
+    
+    resolved = [ESXPResolvedNames newBuild:self->names nameTable:nameTable];
+    if ([resolved isComplete])
+        self.resolved = resolved;
+    
+    return resolved;
+}
+
+- (BOOL)step:(NSUInteger)step symbol:(NSUInteger)symbol matches:(id<ESXPNode>)node
+{
+    id name = [self->names objectAtIndex:step];
+    return name == [NSNull null] || ESXPNodeNamed(node, symbol, name);
+}
+
+- (BOOL)fail:(NSString *)reason error:(NSError **)error
+{
+    if (error != NULL) {
+        NSString     *domain   = @"net.apkc.projects.ErrorDomain";
+        NSString     *desc     = [NSString stringWithFormat:@"%@ (%@)", NSLocalizedString(reason, @""), self->expression];
+        NSDictionary *userInfo = @{ NSLocalizedDescriptionKey : desc };
+        *error = [NSError errorWithDomain:domain code:QUERY_INVALID_EXPRESSION userInfo:userInfo];
+    }
+    
+    if (kDEBUG)
+        NSLog(@"ERROR ==> %@", reason);
+    
+    return NO;
+}
+@end
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ESXPDocument.h"
+#import "ESXPSAX2DOM.h"
+
+/// Enumerates the records of an XML stream one at a time.
+///
+/// <p>
+/// The parser runs on a background thread and is paused after every record until the
+/// next one is requested, so at most one record is waiting while the caller works on
+/// the current one. Every object returned is an ESXPDocument built exactly like the
+/// ones handed out by ESXPSAX2DOM in streaming mode.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPRecordEnumerator : NSEnumerator
+// MARK: Properties
+@property (nonatomic, strong, readonly) NSError *error;
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param stream     The stream to read the XML from.
+/// \param recordName The name of the element to yield as a record, i.e. "page".
+/// \param maxNodes   The maximum number of nodes inside a record.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPRecordEnumerator *)newBuild:(NSInputStream *)stream recordName:(NSString *)recordName maxNodes:(NSUInteger)maxNodes;
+
+// MARK: Methods
+/// Stops the parser. Any record not yet returned is discarded.
+- (void)cancel;
+@end
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ESXPConstants.h"
+#import "ESXPRecordEnumerator.h"
+
+/// State shared between the enumerator and the parser thread. It lives apart from the
+/// enumerator so a parser blocked on a record never keeps the enumerator alive.
+@interface ESXPRecordChannel : NSObject
+@property (nonatomic, strong) dispatch_semaphore_t available; // Signaled when a record (or the end) is ready.
+@property (nonatomic, strong) dispatch_semaphore_t consumed;  // Signaled when the caller asks for the next record.
+@property (atomic, strong)    ESXPDocument         *pending;  // The record waiting to be taken.
+@property (atomic, strong)    NSError              *error;    // The parser error, if any.
+@property (atomic, assign)    BOOL                 cancelled;
+@end
+
+@implementation ESXPRecordChannel
+@end
+
+@interface ESXPRecordEnumerator ()
+{
+    ESXPRecordChannel *channel;
+    NSInputStream     *stream;
+    NSString          *recordName;
+    NSUInteger        maxNodes;
+    BOOL              started;
+    BOOL              finished;
+}
+@end
+
+@implementation ESXPRecordEnumerator
+// MARK: Builders
++ (ESXPRecordEnumerator *)newBuild:(NSInputStream *)stream recordName:(NSString *)recordName maxNodes:(NSUInteger)maxNodes
+{
+    ESXPRecordEnumerator *instance = [[ESXPRecordEnumerator alloc] init];
+    if (instance) {
+        instance->channel            = [ESXPRecordChannel new];
+        instance->channel.available  = dispatch_semaphore_create(0);
+        instance->channel.consumed   = dispatch_semaphore_create(0);
+        instance->stream             = stream;
+        instance->recordName         = [recordName copy];
+        instance->maxNodes           = maxNodes;
+        instance->started            = NO;
+        instance->finished           = NO;
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc { [self cancel]; }
+
+// MARK: NSEnumerator Overriding
+- (id)nextObject
+{
+    if (self->finished)
+        return nil;
+    
+    if (!self->started)
+        [self start];
+    else
+        dispatch_semaphore_signal(self->channel.consumed);
+    
+    dispatch_semaphore_wait(self->channel.available, DISPATCH_TIME_FOREVER);
+    
+    ESXPDocument *record  = self->channel.pending;
+    self->channel.pending = nil;
+    if (record == nil)
+        self->finished = YES;
+    
+    return record;
+}
+
+// MARK: Methods
+- (NSError *)error { return self->channel.error; }
+
+- (void)cancel
+{
+    if (!self->started || self->finished)
+        return;
+    
+    self->finished          = YES;
+    self->channel.cancelled = YES;
+    self->channel.pending   = nil;
+    dispatch_semaphore_signal(self->channel.consumed);
+}
+
+- (void)start
+{
+    self->started = YES;
+    
+    ESXPRecordChannel *ch       = self->channel;
+    NSInputStream     *input    = self->stream;
+    NSString          *name     = self->recordName;
+    NSUInteger        capacity  = self->maxNodes;
+    
+    NSThread *thread = [[NSThread alloc] initWithBlock:^{
+        @autoreleasepool {
+            ESXPSAX2DOM *builder = [ESXPSAX2DOM newBuild:capacity recordName:name recordHandler:^(ESXPDocument *record, BOOL *stop) {
+                ch.pending = record;
+                dispatch_semaphore_signal(ch.available);
+                dispatch_semaphore_wait(ch.consumed, DISPATCH_TIME_FOREVER);
+                if (ch.cancelled)
+                    *stop = YES;
+            }];
+            
+            NSXMLParser *parser = [[NSXMLParser alloc] initWithStream:input];
+            [parser setDelegate:builder];
+            if (![parser parse] && !ch.cancelled) {
+                NSString            *domain   = @"net.apkc.projects.ErrorDomain";
+                NSString            *desc     = NSLocalizedString(@"Problema convirtiendo de SAX a DOM.", @"");
+                NSMutableDictionary *userInfo = [@{ NSLocalizedDescriptionKey : desc } mutableCopy];
+                if ([parser parserError] != nil)
+                    [userInfo setObject:[parser parserError] forKey:NSUnderlyingErrorKey];
+                ch.error = [NSError errorWithDomain:domain code:XMLPARSER_SAX2DOM_ERROR userInfo:userInfo];
+                
+                if (kDEBUG)
+                    NSLog(@"ERROR ==> %@", [ch.error localizedDescription]);
+            }
+            
+            // Wake up the caller with an empty slot to mark the end.
+            ch.pending = nil;
+            dispatch_semaphore_signal(ch.available);
+        }
+    }];
+    [thread start];
+}
+@end
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ESXPArenaDocument.h"
+
+/// Creates an arena backed DOM Document using a SAX parser.
+///
+/// <p>
+/// Works like ESXPSAX2DOM, but the nodes are appended as rows of an ESXPArenaDocument
+/// instead of being built as ESXPElement and ESXPText objects.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    ESXPSAX2DOM
+@interface ESXPSAX2Arena : NSObject <NSXMLParserDelegate>
+{
+    NSUInteger *stack;         // The rows of the open elements.
+    NSUInteger stackSize;      // The count of open elements.
+    NSUInteger stackCapacity;  // The count of rows allocated for the stack.
+}
+@property (nonatomic, strong) ESXPArenaDocument *document;
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param maxNodes The expected number of nodes, used to size the tables up front.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPSAX2Arena *)newBuild:(NSUInteger)maxNodes;
+
+// MARK: Methods
+/// Returns the XML file as a DOM representation.
+///
+/// \return The DOM object.
+- (ESXPArenaDocument *)getDOM;
+@end
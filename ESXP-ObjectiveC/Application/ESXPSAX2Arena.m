@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ESXPConstants.h"
+#import "ESXPSAX2Arena.h"
+
+@implementation ESXPSAX2Arena
+// MARK: Builders
++ (ESXPSAX2Arena *)newBuild:(NSUInteger)maxNodes
+{
+    ESXPSAX2Arena *instance = [[ESXPSAX2Arena alloc] init];
+    if (instance) {
+        instance.document          = [ESXPArenaDocument newBuild:@"_root" capacity:maxNodes];
+        instance->stackCapacity    = 64;
+        instance->stackSize        = 0;
+        instance->stack            = malloc(sizeof(NSUInteger) * instance->stackCapacity);
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc { free(self->stack); }
+
+// MARK: NSXMLParserDelegate Implementation
+- (void)parserDidStartDocument:(NSXMLParser *)parser { [self push:0]; }
+
+- (void)parser:(NSXMLParser *)parser didStartElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName attributes:(NSDictionary *)attributeDict
+{
+    if (kDEBUG)
+        NSLog(@"PARSER:didStartElement ==> %@", elementName);
+    
+    NSUInteger element = [self.document appendElement:elementName parent:self->stack[self->stackSize - 1] depth:self->stackSize];
+    for (NSString *key in attributeDict)
+        [self.document appendAttribute:key value:[attributeDict objectForKey:key] element:element];
+    
+    [self push:element];
+}
+
+- (void)parser:(NSXMLParser *)parser foundCharacters:(NSString *)string
+{
+    if (kDEBUG)
+        NSLog(@"PARSER:foundCharacters ==> %@", string);
+    
+    [self.document appendText:string parent:self->stack[self->stackSize - 1]];
+}
+
+- (void)parser:(NSXMLParser *)parser didEndElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName
+{
+    if (kDEBUG)
+        NSLog(@"PARSER:didEndElement   ==> %@", elementName);
+    
+    self->stackSize--;
+}
+
+- (void)parserDidEndDocument:(NSXMLParser *)parser { self->stackSize--; }
+
+// MARK: Methods
+- (ESXPArenaDocument *)getDOM { return self.document; }
+
+// MARK: Private Methods
+- (void)push:(NSUInteger)row
+{
+    if (self->stackSize == self->stackCapacity) {
+        self->stackCapacity *= 2;
+        self->stack = realloc(self->stack, sizeof(NSUInteger) * self->stackCapacity);
+    }
+    
+    self->stack[self->stackSize++] = row;
+}
+@end
@@ -25,29 +25,237 @@
  */
 
 #import <Foundation/Foundation.h>
-#import "AKDataStructures.h"
+#import "ESXPConstants.h"
 #import "ESXPDocument.h"
 #import "ESXPNode.h"
+#import "ESXPProjection.h"
 #import "ESXPText.h"
 
+/// Block called for every record found while streaming.
+///
+/// \param record A document whose root holds the record element as its only child.
+/// \param stop   Set to YES to abort the parsing after this record.
+typedef void (^ESXPRecordHandler)(ESXPDocument *record, BOOL *stop);
+
+/// Block called for every watched element as soon as it is closed.
+///
+/// \param element The element, complete with all of its descendants.
+/// \param stop    Set to YES to abort the parsing after this element.
+typedef void (^ESXPSubtreeHandler)(ESXPElement *element, BOOL *stop);
+
 /// Creates a DOM Document using a SAX parser.
 ///
+/// <p>
+/// When a record name is given the builder works in streaming mode: every element with
+/// that name is built into its own small document, handed to the record handler and
+/// released before the parser moves on, so the memory used tracks the largest record
+/// and not the size of the file. Elements outside of records are still added to the
+/// main document, but whitespace between them is dropped.
+/// </p>
+///
+/// <p>
+/// Element and attribute names are interned into the name table of the document, and
+/// every element keeps the symbol of its name. Records share the table of the main
+/// document, so a symbol resolved once is good for all of them.
+/// </p>
+///
+/// <p>
+/// Events can come from two front ends, chosen when calling parseData: or parseFile:.
+/// FRONTEND_NSXMLPARSER drives this class as the delegate of an NSXMLParser, as it was
+/// always done. FRONTEND_NATIVE runs the ESXPTokenizer over the bytes (memory mapped
+/// when reading a file) and feeds the builder directly, without an object or a
+/// delegate message per event. Both build the same document, except that NSXMLParser
+/// may split a text run in several text nodes (i.e. around entity references) where
+/// the tokenizer reports it as one.
+/// </p>
+///
+/// <p>
+/// With lazyValues set, the native front end does not decode text and attribute
+/// values while building: nodes keep the raw runs of the input (which stays mapped
+/// for as long as any of them is not decoded) and decode them when first asked for.
+/// NSXMLParser always hands decoded strings, so the flag has no effect with it.
+/// </p>
+///
+/// <p>
+/// Large record oriented inputs can be parsed on many threads with parseData:splitAt:threads:error:.
+/// The input is cut in front of records (i.e. "&lt;page"), the pieces are parsed at once
+/// by the native front end and the records are attached to their parent in document
+/// order, so the document is the same as the one built on a single thread (only the
+/// symbols of the names may be numbered differently). When the input can not be cut
+/// safely, or a piece does not parse on its own, it is parsed on a single thread instead.
+/// </p>
+///
+/// <p>
+/// With coalesceText set, all the character data between two tags (which NSXMLParser
+/// hands over in pieces, and the tokenizer splits around comments and processing
+/// instructions) becomes a single text node, so the document comes out normalized. With
+/// ignoreWhitespace set, text made only of whitespace is dropped, which suits data
+/// oriented XML where it only indents the elements. When both are set, the test is made
+/// on the whole run rather than on each piece.
+/// </p>
+///
+/// <p>
+/// With buildTagIndex set, the document (and every record in streaming mode) gets a
+/// tag index filled as elements are added, see ESXPDocument.
+/// </p>
+///
+/// <p>
+/// The builder keeps the footprint of the documents it builds (see ESXPDocumentFootprint).
+/// With maxBytes set, a parse stops with PARSE_BUDGET_EXCEEDED as soon as the nodes,
+/// text and attributes built, plus the name table, go past that many bytes. In streaming
+/// mode only the record being built counts, not the ones already handed over, and when
+/// parsing on many threads the pieces count against one budget, shared as they run.
+/// With maxDepth set, a parse stops with PARSE_DEPTH_EXCEEDED at the first element
+/// nested deeper than that, the document element being at depth 1. Either way the
+/// document is left as far as it got.
+/// </p>
+///
+/// <p>
+/// Input that arrives in chunks (i.e. from a pipe or a socket) can be given to
+/// pushData:final:error: as it comes, instead of being gathered first. The native front
+/// end builds what the chunk completes and keeps the rest (usually part of a tag) for the
+/// next one, so the document grows with the input. Pushed values are always decoded,
+/// since the chunks are not kept. Handlers set with watchElement:handler: are called as
+/// soon as an element of that name is closed, with either front end, so its subtree can
+/// be queried while the rest of the input is still on its way. Parsing on many threads
+/// would call them out of order, so it runs on a single thread when there is any.
+/// </p>
+///
+/// <p>
+/// With a projection set, only the elements it keeps are built, each with its whole
+/// subtree. Other elements cost a symbol on a stack while they are open: no node is
+/// built for them and their attributes and text are not decoded. The elements a kept
+/// one is nested in are built when it is found, with their names only, so the document
+/// can still be walked from its root. In streaming mode every record is built, even
+/// with nothing kept in it.
+/// </p>
+///
+/// <p>
+/// With compactText set, text is kept as UTF-8 in the text buffer of the document (see
+/// ESXPTextBuffer) instead of one string per node, and the string is only made when a
+/// value is asked for. It works with both front ends and when pushing. The native front
+/// end copies the bytes straight from the input when the run has no references, while
+/// with lazyValues set text is not copied at all and stays in the input as before.
+/// </p>
+///
 /// \author Andreas P. Koenzen <akc at apkc.net>
 @interface ESXPSAX2DOM : NSObject <NSXMLParserDelegate>
-@property (nonatomic, strong) id<ESXPNode> nextSibling;
-@property (nonatomic, strong) id<ESXPNode> lastSibling;
-@property (nonatomic, strong) ESXPDocument *document;
-@property (nonatomic, strong) AKStack      *stack;
+@property (nonatomic, strong) id<ESXPNode>        nextSibling;
+@property (nonatomic, strong) id<ESXPNode>        lastSibling;
+@property (nonatomic, strong) ESXPDocument        *document;
+@property (nonatomic, copy)   NSString            *recordName;
+@property (nonatomic, copy)   ESXPRecordHandler   recordHandler;
+@property (nonatomic, assign) BOOL                lazyValues;
+@property (nonatomic, assign) BOOL                buildTagIndex;
+@property (nonatomic, assign) BOOL                coalesceText;
+@property (nonatomic, assign) BOOL                ignoreWhitespace;
+@property (nonatomic, assign) BOOL                compactText;
+@property (nonatomic, assign) uint64_t            maxBytes;
+@property (nonatomic, assign) NSUInteger          maxDepth;
+@property (nonatomic, strong) ESXPProjection      *projection;
 
 // MARK: Builders
 /// Builder of new instances. Follows the Builder Pattern.
 ///
-/// \param maxNodes The maximum number of nodes.
+/// \param maxNodes The maximum number of nodes. Only a hint, the builder grows as needed.
 ///
 /// \return A new instance of this class or nil if any problem.
 + (ESXPSAX2DOM *)newBuild:(NSUInteger)maxNodes;
 
+/// Builder of new instances sharing a name table. Follows the Builder Pattern.
+///
+/// \param maxNodes  The maximum number of nodes.
+/// \param nameTable The name table to intern element and attribute names into.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPSAX2DOM *)newBuild:(NSUInteger)maxNodes nameTable:(ESXPNameTable *)nameTable;
+
+/// Builder of new instances working in streaming mode. Follows the Builder Pattern.
+///
+/// \param maxNodes      The maximum number of nodes inside a record.
+/// \param recordName    The name of the element to yield as a record, i.e. "page".
+/// \param recordHandler The block to call for every record found.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPSAX2DOM *)newBuild:(NSUInteger)maxNodes recordName:(NSString *)recordName recordHandler:(ESXPRecordHandler)recordHandler;
+
 // MARK: Methods
+/// Parses a buffer of XML into the document of this builder.
+///
+/// \param data     The XML.
+/// \param frontEnd The front end producing the events.
+/// \param error    Set if the XML could not be parsed.
+///
+/// \return YES if the XML was parsed, or the parsing was stopped by the record handler.
+- (BOOL)parseData:(NSData *)data frontEnd:(FrontEnds)frontEnd error:(NSError **)error;
+
+/// Parses a file of XML into the document of this builder. With FRONTEND_NATIVE the
+/// file is memory mapped instead of read.
+///
+/// \param path     The path of the file.
+/// \param frontEnd The front end producing the events.
+/// \param error    Set if the file could not be read or parsed.
+///
+/// \return YES if the XML was parsed, or the parsing was stopped by the record handler.
+- (BOOL)parseFile:(NSString *)path frontEnd:(FrontEnds)frontEnd error:(NSError **)error;
+
+/// Parses a buffer of record oriented XML on many threads, with the native front end.
+/// Streaming mode is not supported, with a record handler the buffer is parsed on a
+/// single thread.
+///
+/// \param data       The XML.
+/// \param recordName The name of the records to cut the input in front of, i.e. "page".
+/// \param threads    The count of pieces parsed at once, 0 for the count of processors.
+/// \param error      Set if the XML could not be parsed.
+///
+/// \return YES if the XML was parsed.
+- (BOOL)parseData:(NSData *)data splitAt:(NSString *)recordName threads:(NSUInteger)threads error:(NSError **)error;
+
+/// Parses a file of record oriented XML on many threads. The file is memory mapped.
+///
+/// \param path       The path of the file.
+/// \param recordName The name of the records to cut the input in front of, i.e. "page".
+/// \param threads    The count of pieces parsed at once, 0 for the count of processors.
+/// \param error      Set if the file could not be read or parsed.
+///
+/// \return YES if the XML was parsed.
+- (BOOL)parseFile:(NSString *)path splitAt:(NSString *)recordName threads:(NSUInteger)threads error:(NSError **)error;
+
+/// Parses the next chunk of an input that arrives in pieces, with the native front end.
+/// The first chunk starts a new parse into the document of this builder, and the final
+/// one (which may be empty) ends it. Once a parse ended, be it with the final chunk, an
+/// error or a stop, the next chunk starts a new one.
+///
+/// \param data  The next chunk of XML, may be nil.
+/// \param final YES if there is no more input after this chunk.
+/// \param error Set if the XML could not be parsed.
+///
+/// \return YES if the chunk was parsed, or the parsing was stopped by a handler.
+- (BOOL)pushData:(NSData *)data final:(BOOL)final error:(NSError **)error;
+
+/// Parses a file compressed with gzip or bzip2 (or not compressed) with the native front
+/// end. An ESXPCompressedReader decompresses it on another thread while the chunks are
+/// pushed, so the two overlap and no decompressed copy is kept in memory or on disk.
+///
+/// \param path  The path of the file.
+/// \param error Set if the file could not be read, decompressed or parsed.
+///
+/// \return YES if the XML was parsed, or the parsing was stopped by a handler.
+- (BOOL)parseCompressedFile:(NSString *)path error:(NSError **)error;
+
+/// Calls a handler whenever an element with the given name is closed. The element is
+/// already attached to its parent, or to its record in streaming mode. Watching a name
+/// again replaces its handler, and a nil handler stops watching it.
+///
+/// \param name    The name of the elements to watch, i.e. "page".
+/// \param handler The block to call for every one of them.
+- (void)watchElement:(NSString *)name handler:(ESXPSubtreeHandler)handler;
+
+/// Starts over with a new, empty document, keeping the name table and the stack. Lets one
+/// builder parse many inputs, one after the other. The previous document is left to
+/// whoever holds it.
+- (void)reset;
+
 /// Returns the XML file as a DOM representation.
 ///
 /// \return The DOM object.
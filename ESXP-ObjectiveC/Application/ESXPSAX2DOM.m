@@ -24,17 +24,240 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#import "ESXPConstants.h"
+#import <objc/runtime.h>
+#import "ESXPCompressedReader.h"
+#import "ESXPMetrics.h"
 #import "ESXPSAX2DOM.h"
+#import "ESXPTokenizer.h"
+
+@interface ESXPSAX2DOM ()
+{
+    ESXPElement * __unsafe_unretained *stack;         // The open elements, owned by the tree.
+    NSUInteger                        stackSize;      // The count of open elements.
+    NSUInteger                        stackCapacity;  // The count of open elements allocated.
+    
+    uint64_t counts[METRIC_COUNT]; // The metrics counted since they were last added to ESXPMetrics.
+    uint64_t parseStart;           // When the parse phase began, 0 if it is not being measured.
+    uint64_t usedBytes;            // The bytes built by this parse and still held, checked against maxBytes.
+    uint64_t recordBytes;          // The part of usedBytes in the record being built.
+    size_t   elementBytes;         // The bytes of an element and of its place in its parent.
+    size_t   textBytes;            // The bytes of a text node and of its place in its parent.
+    
+    _Atomic(uint64_t) pieceBytes;   // The bytes built by all the pieces of a parse on many threads, while they run.
+    _Atomic(uint64_t) *sharedBytes; // The pieceBytes of the parse this piece belongs to, NULL when not a piece.
+    uint64_t          baseBytes;    // The usedBytes of that parse when its pieces started.
+    
+    NSUInteger *openSymbols;       // The symbol of every open element while projecting, built or not.
+    NSUInteger openCount;          // The count of open elements while projecting.
+    NSUInteger openCapacity;       // The count of open elements allocated.
+    NSUInteger builtCount;         // The count of open elements built, always the outermost ones.
+    NSUInteger keptDepth;          // The open count at the element kept with its whole subtree, 0 if none.
+}
+@property (nonatomic, strong) ESXPDocument        *record;         // The record being built, nil when outside of a record.
+@property (nonatomic, assign) NSUInteger          recordDepth;     // The stack size right after the record element was pushed.
+@property (nonatomic, assign) NSUInteger          recordSymbol;    // The symbol of the record name.
+@property (nonatomic, strong) ESXPTokenizer       *tokenizer;      // The native front end while it runs.
+@property (nonatomic, strong) NSXMLParser         *parser;         // The NSXMLParser front end while it runs.
+@property (nonatomic, strong) NSData              *source;         // The input of the native front end while it runs.
+@property (nonatomic, assign) BOOL                stopped;         // If a record or subtree handler asked to stop.
+@property (nonatomic, assign) ESXPElement         *fragmentParent; // The parent of the top level nodes of a piece, nil for documents. Not retained.
+@property (nonatomic, strong) NSMutableString     *pendingText;    // The text run being coalesced, once decoded. Nil if there is none.
+@property (nonatomic, assign) ESXPRange           pendingRaw;      // The text run being coalesced while it is a single raw run.
+@property (nonatomic, assign) BOOL                pendingEscaped;  // If the pending raw run has references or line endings to decode.
+@property (nonatomic, assign) ErrorCodes          exceeded;        // The limit the parse went past, 0 if none.
+@property (nonatomic, strong) NSMutableData       *pushBuffer;     // The pushed input not dropped yet, nil when not pushing.
+@property (nonatomic, assign) NSUInteger          pushOffset;     // The bytes of pushBuffer already tokenized.
+@property (nonatomic, strong) NSMutableDictionary *watched;        // The subtree handlers by the symbol of their name.
+@property (nonatomic, strong) ESXPBoundProjection *bound;          // The projection bound to the name table of this parse.
+
+// MARK: Builder
+/// Called once before the first event.
+- (void)beginDocument;
+
+/// Opens a new element as the last child of the current one.
+///
+/// \param name           The interned name.
+/// \param symbol         The symbol of the name.
+/// \param attributeCount The count of attributes the element is going to get.
+///
+/// \return The new element, to add attributes to, or nil if the projection skips it.
+- (ESXPElement *)beginElement:(NSString *)name symbol:(NSUInteger)symbol attributeCount:(NSUInteger)attributeCount;
+
+/// Appends a text node to the current element.
+///
+/// \param string The text.
+- (void)appendText:(NSString *)string;
+
+/// Appends a text node over a raw run of the input to the current element.
+///
+/// \param raw     The raw run.
+/// \param escaped If the run has references or line endings to decode.
+- (void)appendRawText:(ESXPRange)raw escaped:(BOOL)escaped;
+
+/// Returns YES if text in the current element is dropped, i.e. whitespace between records.
+///
+/// \return YES if text in the current element is dropped.
+- (BOOL)dropsWhitespace;
+
+/// Closes the current element, handing it to its subtree handler if it is watched and
+/// to the record handler if it is a record.
+///
+/// \return YES if a handler asked to stop.
+- (BOOL)endElement;
+
+/// Called once after the last event.
+- (void)endDocument;
+
+/// Tests whether text is dropped because the projection skips the current element.
+///
+/// \return YES if text is dropped.
+- (BOOL)skipsText;
+
+/// Parses a piece of a document into the root of the document of this builder, giving
+/// the top level nodes the parent they will have once attached.
+///
+/// \param data   The whole input.
+/// \param range  The piece.
+/// \param parent The parent of the records of the piece.
+///
+/// \return YES if the piece was parsed.
+- (BOOL)parseFragment:(NSData *)data range:(NSRange)range parent:(ESXPElement *)parent;
+
+/// Starts a piece inside the open elements of the builder of its document, so the
+/// projection matches its elements from the document element.
+///
+/// \param builder The builder of the document, with every open element built.
+- (void)projectFrom:(ESXPSAX2DOM *)builder;
+
+// MARK: Private Methods
+/// Counts a piece of text handed over by a front end. Called only while metrics are on.
+///
+/// \param bytes The length of the piece, as found in the input.
+- (void)countChunk:(NSUInteger)bytes;
+
+/// Adds the bytes of new nodes to the footprint of the document they go to, and stops
+/// the parse if they take it past maxBytes.
+///
+/// \param bytes The bytes built. The name bytes are ignored.
+- (void)account:(ESXPDocumentFootprint)bytes;
+@end
+
+// MARK: Native Front End
+/// Returns YES if a record starts at a given offset, i.e. "<page" followed by the end of the name.
+static inline BOOL ESXPIsRecordStart(const char *bytes, NSUInteger length, NSUInteger at, const char *name, NSUInteger nameLength)
+{
+    if (at + nameLength + 2 > length || bytes[at] != '<' || memcmp(bytes + at + 1, name, nameLength) != 0)
+        return NO;
+    
+    char c = bytes[at + 1 + nameLength];
+    return c == '>' || c == '/' || c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/// Finds the first record start at or after an offset.
+static NSUInteger ESXPNextRecord(const char *bytes, NSUInteger length, NSUInteger from, const char *name, NSUInteger nameLength)
+{
+    while (from < length) {
+        const char *lt = memchr(bytes + from, '<', length - from);
+        if (lt == NULL)
+            return NSNotFound;
+        
+        NSUInteger at = lt - bytes;
+        if (ESXPIsRecordStart(bytes, length, at, name, nameLength))
+            return at;
+        
+        from = at + 1;
+    }
+    
+    return NSNotFound;
+}
+
+/// Picks where to cut the input for parsing it in pieces: in front of records, spread
+/// evenly over the bytes from the first record to the end of the last one.
+///
+/// \return The count of cuts, 0 if the input should not be cut. The first cut is always
+///         the start of the first record.
+static NSUInteger ESXPFindCuts(const char *bytes, NSUInteger length, const char *name, NSUInteger nameLength, NSUInteger maxCuts, NSUInteger *cuts, NSUInteger *first, NSUInteger *last)
+{
+    *first = ESXPNextRecord(bytes, length, 0, name, nameLength);
+    if (*first == NSNotFound)
+        return 0;
+    
+    // The end of the last record: the last "</page>", with optional spaces before the ">".
+    *last = NSNotFound;
+    for (NSUInteger at = length; at > *first + nameLength + 2; at--) {
+        const char *close = bytes + at - 1;
+        if (*close != '>')
+            continue;
+        
+        const char *q = close - 1;
+        while (q > bytes && (*q == ' ' || *q == '\t' || *q == '\n' || *q == '\r'))
+            q--;
+        
+        const char *tag = q - nameLength - 1;
+        if (tag >= bytes + *first && tag[0] == '<' && tag[1] == '/' && memcmp(tag + 2, name, nameLength) == 0) {
+            *last = at;
+            break;
+        }
+    }
+    if (*last == NSNotFound)
+        return 0;
+    
+    NSUInteger count = 0;
+    NSUInteger step  = (*last - *first) / maxCuts;
+    cuts[count++] = *first;
+    for (NSUInteger i = 1; i < maxCuts && step > 0; i++) {
+        NSUInteger cut = ESXPNextRecord(bytes, *last, MAX(*first + i * step, cuts[count - 1] + 1), name, nameLength);
+        if (cut == NSNotFound)
+            break;
+        
+        if (cut > cuts[count - 1])
+            cuts[count++] = cut;
+    }
+    
+    return count;
+}
+
+static inline BOOL ESXPIsBlank(ESXPRange text)
+{
+    for (NSUInteger i = 0; i < text.length; i++)
+        if (text.bytes[i] != ' ' && text.bytes[i] != '\t' && text.bytes[i] != '\n' && text.bytes[i] != '\r')
+            return NO;
+    
+    return YES;
+}
+
+static inline BOOL ESXPIsBlankString(NSString *text) { return [[text stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] length] == 0; }
+
+static void ESXPSAX2DOMStartElement(void *context, ESXPRange name, const ESXPTokenAttribute *attributes, NSUInteger attributeCount);
+static void ESXPSAX2DOMEndElement(void *context, ESXPRange name);
+static void ESXPSAX2DOMCharacters(void *context, ESXPRange text, BOOL escaped);
 
 @implementation ESXPSAX2DOM
 // MARK: NSObject Overriding
-+ (ESXPSAX2DOM *)newBuild:(NSUInteger)maxNodes
+- (id)init
+{
+    // Ready to use even when not made by a builder, i.e. as a plain NSXMLParser delegate.
+    self = [super init];
+    if (self) {
+        self.document       = [ESXPDocument newBuild:@"_root" nameTable:[ESXPNameTable newBuild]];
+        self->stackCapacity = 16;
+        self->stackSize     = 0;
+        self->stack         = (ESXPElement * __unsafe_unretained *) calloc(self->stackCapacity, sizeof(ESXPElement *));
+        self->elementBytes  = class_getInstanceSize([ESXPElement class]) + sizeof(id);
+        self->textBytes     = class_getInstanceSize([ESXPText class]) + sizeof(id);
+    }
+    return self;
+}
+
++ (ESXPSAX2DOM *)newBuild:(NSUInteger)maxNodes { return [ESXPSAX2DOM newBuild:maxNodes nameTable:[ESXPNameTable newBuild]]; }
+
++ (ESXPSAX2DOM *)newBuild:(NSUInteger)maxNodes nameTable:(ESXPNameTable *)nameTable
 {
     ESXPSAX2DOM *instance = [[ESXPSAX2DOM alloc] init];
     if (instance) {
-        instance.document = [ESXPDocument newBuild:@"_root"];
-        instance.stack    = [[AKStack alloc] initWithSize:maxNodes];
+        instance.document        = [ESXPDocument newBuild:@"_root" nameTable:nameTable];
+        instance->stackCapacity  = MAX(MIN(maxNodes, (NSUInteger) 1024), (NSUInteger) 16);
+        instance->stack          = (ESXPElement * __unsafe_unretained *) realloc(instance->stack, instance->stackCapacity * sizeof(ESXPElement *));
         return instance;
     }
     else {
@@ -42,27 +265,54 @@
     }
 }
 
++ (ESXPSAX2DOM *)newBuild:(NSUInteger)maxNodes recordName:(NSString *)recordName recordHandler:(ESXPRecordHandler)recordHandler
+{
+    ESXPSAX2DOM *instance = [ESXPSAX2DOM newBuild:maxNodes];
+    if (instance) {
+        instance.recordName    = recordName;
+        instance.recordHandler = recordHandler;
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc
+{
+    free(self->stack);
+    free(self->openSymbols);
+}
+
 // MARK: NSXMLParserDelegate Implementation
-- (void) parserDidStartDocument:(NSXMLParser *)parser { [self.stack push:[self.document getRootNode]]; }
+- (void) parserDidStartDocument:(NSXMLParser *)parser { [self beginDocument]; }
 
 - (void)parser:(NSXMLParser *)parser didStartElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName attributes:(NSDictionary *)attributeDict
 {
     if (kDEBUG)
         NSLog(@"PARSER:didStartElement ==> %@", elementName);
     
-    ESXPElement *tmp = [ESXPElement newBuild:elementName parentNode:[self.stack peek]];
+    // Keep the interned copy of the names, the ones from the parser go away with the event.
+    ESXPNameTable                 *nameTable = [self.document getNameTable];
+    NSString * __unsafe_unretained name      = nil;
+    NSUInteger                    symbol     = [nameTable internName:elementName interned:&name];
+    ESXPElement                   *element   = [self beginElement:name symbol:symbol attributeCount:[attributeDict count]];
+    if (element == nil)
+        return;
     
     // Add the attributes to the node.
     NSEnumerator *enumerator = [attributeDict keyEnumerator];
+    uint64_t     bytes       = 0;
     id key;
-    while ((key = [enumerator nextObject]))
-        [tmp setAttribute:key value:[attributeDict objectForKey:key]];
+    while ((key = [enumerator nextObject])) {
+        NSString *value = [attributeDict objectForKey:key];
+        [nameTable internName:key interned:&name];
+        [element setAttribute:name value:value];
+        bytes += kOBJECT_BYTES + 2 * sizeof(id) + [value lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    }
     
-    // Append the new node into the stack.
-    ESXPElement *last = (ESXPElement *)[self.stack peek];
-    [last appendChild:tmp];
-    [self.stack push:tmp];
-    self.lastSibling = nil;
+    if (bytes > 0)
+        [self account:(ESXPDocumentFootprint) { 0, 0, 0, bytes }];
 }
 
 -(void) parser:(NSXMLParser *)parser foundCharacters:(NSString *)string
@@ -70,11 +320,10 @@
     if (kDEBUG)
         NSLog(@"PARSER:foundCharacters ==> %@", string);
     
-    ESXPElement *last = (ESXPElement *)[self.stack peek];
-    ESXPText    *text = [ESXPText newBuild:nil];
-    [text setNodeValue:string];
+    if (ESXPMetricsEnabled())
+        [self countChunk:[string lengthOfBytesUsingEncoding:NSUTF8StringEncoding]];
     
-    self.lastSibling = (ESXPText *) [last appendChild:text];
+    [self appendText:string];
 }
 
 - (void)parser:(NSXMLParser *)parser didEndElement:(NSString *)elementName namespaceURI:(NSString *)namespaceURI qualifiedName:(NSString *)qName
@@ -82,12 +331,758 @@
     if (kDEBUG)
         NSLog(@"PARSER:didEndElement   ==> %@", elementName);
     
-    [self.stack pop];
-    self.lastSibling = nil;
+    if ([self endElement])
+        [parser abortParsing];
 }
 
-- (void) parserDidEndDocument:(NSXMLParser *)parser { [self.stack pop]; }
+- (void) parserDidEndDocument:(NSXMLParser *)parser { [self endDocument]; }
 
 // MARK: Methods
+- (BOOL)parseData:(NSData *)data frontEnd:(FrontEnds)frontEnd error:(NSError **)error
+{
+    if (data == nil || [data length] == 0)
+        return [self fail:XMLPARSER_NIL_DOCUMENT reason:NSLocalizedString(@"Documento vacio.", @"") underlying:nil error:error];
+    
+    if (frontEnd == FRONTEND_NATIVE) {
+        ESXPTokenizerCallbacks callbacks = { ESXPSAX2DOMStartElement, ESXPSAX2DOMEndElement, ESXPSAX2DOMCharacters };
+        NSError                *cause    = nil;
+        
+        self.tokenizer = [ESXPTokenizer newBuild:callbacks context:(__bridge void *)self];
+        self.source    = data;
+        [self beginDocument];
+        NSUInteger consumed = [self.tokenizer tokenize:[data bytes] length:[data length] final:YES error:&cause];
+        [self endDocument];
+        self.tokenizer = nil;
+        self.source    = nil;
+        
+        if (self.exceeded != 0)
+            return [self failLimit:error];
+        
+        if (consumed == NSNotFound)
+            return [self fail:XMLPARSER_SAX2DOM_ERROR reason:NSLocalizedString(@"Problema convirtiendo de SAX a DOM.", @"") underlying:cause error:error];
+        
+        return YES;
+    }
+    else {
+        self.parser = [[NSXMLParser alloc] initWithData:data];
+        [self.parser setDelegate:self];
+        BOOL     parsed = [self.parser parse];
+        NSError *cause  = [self.parser parserError];
+        self.parser = nil;
+        [self endParse]; // The parser does not end the document when it fails or is aborted.
+        
+        if (self.exceeded != 0)
+            return [self failLimit:error];
+        
+        if (!parsed && !self.stopped)
+            return [self fail:XMLPARSER_SAX2DOM_ERROR reason:NSLocalizedString(@"Problema convirtiendo de SAX a DOM.", @"") underlying:cause error:error];
+        
+        return YES;
+    }
+}
+
+- (BOOL)parseFile:(NSString *)path frontEnd:(FrontEnds)frontEnd error:(NSError **)error
+{
+    NSError *cause = nil;
+    NSData  *data  = [NSData dataWithContentsOfFile:path
+                                            options:(frontEnd == FRONTEND_NATIVE) ? NSDataReadingMappedAlways : 0
+                                              error:&cause];
+    if (data == nil)
+        return [self fail:XMLPARSER_NIL_DOCUMENT reason:NSLocalizedString(@"No se pudo leer el archivo.", @"") underlying:cause error:error];
+    
+    return [self parseData:data frontEnd:frontEnd error:error];
+}
+
+- (BOOL)parseData:(NSData *)data splitAt:(NSString *)recordName threads:(NSUInteger)threads error:(NSError **)error
+{
+    if (threads == 0)
+        threads = [[NSProcessInfo processInfo] activeProcessorCount];
+    threads = MIN(threads, (NSUInteger) 64);
+    
+    const char *bytes   = [data bytes];
+    NSUInteger length   = [data length];
+    NSData     *name    = [recordName dataUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger first    = NSNotFound;
+    NSUInteger last     = NSNotFound;
+    NSUInteger cuts[threads * 4];
+    NSUInteger cutCount = 0;
+    if (threads > 1 && self.recordName == nil && [self.watched count] == 0 && [name length] > 0)
+        cutCount = ESXPFindCuts(bytes, length, [name bytes], [name length], threads * 4, cuts, &first, &last);
+    
+    if (cutCount == 0)
+        return [self parseData:data frontEnd:FRONTEND_NATIVE error:error];
+    
+    // Everything in front of the first record, on this thread. The text right in front of
+    // the record may be left over, it goes with the first piece.
+    ESXPTokenizerCallbacks callbacks = { ESXPSAX2DOMStartElement, ESXPSAX2DOMEndElement, ESXPSAX2DOMCharacters };
+    ESXPNameTable          *table    = [self.document getNameTable];
+    self.tokenizer = [ESXPTokenizer newBuild:callbacks context:(__bridge void *)self];
+    self.source    = data;
+    [self beginDocument];
+    NSUInteger consumed = [self.tokenizer tokenize:bytes length:first final:NO error:NULL];
+    [self.tokenizer dropRest]; // The rest goes with the first piece, the tokenizer goes on after the last.
+    if (self.exceeded != 0) {
+        [self endDocument];
+        self.tokenizer = nil;
+        self.source    = nil;
+        return [self failLimit:error];
+    }
+    
+    // Records already at the depth limit are left to the single thread to report.
+    if (consumed == NSNotFound || [self.tokenizer getDepth] == 0 || (self.maxDepth > 0 && [self depth] >= self.maxDepth)) {
+        [self reset];
+        return [self parseData:data frontEnd:FRONTEND_NATIVE error:error];
+    }
+    
+    // The records are attached to the element open at the cut, so it must be built.
+    if (self.projection != nil)
+        [self buildOpen:self->openCount];
+    
+    // The records, one piece per task.
+    ESXPElement      *parent  = self->stack[self->stackSize - 1];
+    NSMutableArray   *pieces  = [NSMutableArray new];
+    NSOperationQueue *queue   = [NSOperationQueue new];
+    atomic_bool      failed   = false;
+    atomic_bool      *failure = &failed; // Set by the pieces, read once they are all done.
+    queue.maxConcurrentOperationCount = threads;
+    atomic_store_explicit(&self->pieceBytes, 0, memory_order_relaxed);
+    for (NSUInteger i = 0; i < cutCount; i++) {
+        NSUInteger  start = (i == 0) ? consumed : cuts[i];
+        NSUInteger  end   = (i + 1 < cutCount) ? cuts[i + 1] : last;
+        ESXPSAX2DOM *piece = [ESXPSAX2DOM newBuild:self->stackCapacity nameTable:table];
+        piece.lazyValues       = self.lazyValues;
+        piece.coalesceText     = self.coalesceText;
+        piece.ignoreWhitespace = self.ignoreWhitespace;
+        piece.compactText      = self.compactText;
+        piece.maxBytes         = self.maxBytes;
+        piece.maxDepth         = (self.maxDepth > 0 && self.projection == nil) ? self.maxDepth - (self->stackSize - 1) : self.maxDepth;
+        piece.projection       = self.projection;
+        piece->sharedBytes     = &self->pieceBytes;
+        piece->baseBytes       = self->usedBytes;
+        if (self.projection != nil)
+            [piece projectFrom:self];
+        [pieces addObject:piece];
+        [queue addOperationWithBlock:^{
+            @autoreleasepool {
+                if (![piece parseFragment:data range:NSMakeRange(start, end - start) parent:parent])
+                    atomic_store_explicit(failure, true, memory_order_relaxed);
+            }
+        }];
+    }
+    [queue waitUntilAllOperationsAreFinished];
+    
+    // A piece that does not parse on its own was not cut in front of a real record. One
+    // that went past a limit is parsed again too, for the error to come at the right place.
+    if (atomic_load_explicit(&failed, memory_order_relaxed)) {
+        [self reset];
+        return [self parseData:data frontEnd:FRONTEND_NATIVE error:error];
+    }
+    
+    // Attach the records in document order, then finish the document on this thread.
+    [self flushText];
+    for (ESXPSAX2DOM *piece in pieces) {
+        for (id<ESXPNode> node in [[[piece getDOM] getRootNode] getChildNodes])
+            [parent appendChild:node];
+        [self.document mergeStatistics:[[piece getDOM] getStatistics] depth:self->stackSize - 1];
+        [self account:[[piece getDOM] getFootprint]];
+    }
+    
+    NSError *cause = nil;
+    if (self.exceeded == 0)
+        consumed = [self.tokenizer tokenize:bytes + last length:length - last final:YES error:&cause];
+    [self endDocument];
+    self.tokenizer = nil;
+    self.source    = nil;
+    
+    if (self.exceeded != 0)
+        return [self failLimit:error];
+    
+    if (consumed == NSNotFound)
+        return [self fail:XMLPARSER_SAX2DOM_ERROR reason:NSLocalizedString(@"Problema convirtiendo de SAX a DOM.", @"") underlying:cause error:error];
+    
+    if (self.buildTagIndex)
+        [self.document indexTags];
+    
+    return YES;
+}
+
+- (BOOL)parseFile:(NSString *)path splitAt:(NSString *)recordName threads:(NSUInteger)threads error:(NSError **)error
+{
+    NSError *cause = nil;
+    NSData  *data  = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:&cause];
+    if (data == nil)
+        return [self fail:XMLPARSER_NIL_DOCUMENT reason:NSLocalizedString(@"No se pudo leer el archivo.", @"") underlying:cause error:error];
+    
+    return [self parseData:data splitAt:recordName threads:threads error:error];
+}
+
+- (BOOL)pushData:(NSData *)data final:(BOOL)final error:(NSError **)error
+{
+    if (self.pushBuffer == nil) {
+        ESXPTokenizerCallbacks callbacks = { ESXPSAX2DOMStartElement, ESXPSAX2DOMEndElement, ESXPSAX2DOMCharacters };
+        
+        self.tokenizer  = [ESXPTokenizer newBuild:callbacks context:(__bridge void *)self];
+        self.pushBuffer = [NSMutableData new];
+        self.pushOffset = 0;
+        [self beginDocument];
+    }
+    
+    if (data != nil)
+        [self.pushBuffer appendData:data];
+    
+    NSError    *cause    = nil;
+    NSUInteger offset    = self.pushOffset;
+    NSUInteger consumed  = [self.tokenizer tokenize:(const char *) [self.pushBuffer bytes] + offset length:[self.pushBuffer length] - offset final:final error:&cause];
+    if (!final && consumed != NSNotFound && ![self.tokenizer isAborted]) {
+        // Keep what the tokenizer could not complete for the next chunk. A coalesced run
+        // still pointing into the buffer is decoded before the bytes move.
+        if (self.pendingRaw.bytes != NULL)
+            [self pendingString];
+        
+        // The consumed bytes are only dropped once they are most of the buffer, so the rest
+        // is moved a few times at most and not on every chunk.
+        offset += consumed;
+        if (offset >= kPUSH_COMPACT_BYTES && offset >= [self.pushBuffer length] / 2) {
+            [self.pushBuffer replaceBytesInRange:NSMakeRange(0, offset) withBytes:NULL length:0];
+            offset = 0;
+        }
+        self.pushOffset = offset;
+        return YES;
+    }
+    
+    [self endDocument];
+    self.tokenizer  = nil;
+    self.pushBuffer = nil;
+    
+    if (self.exceeded != 0)
+        return [self failLimit:error];
+    
+    if (consumed == NSNotFound)
+        return [self fail:XMLPARSER_SAX2DOM_ERROR reason:NSLocalizedString(@"Problema convirtiendo de SAX a DOM.", @"") underlying:cause error:error];
+    
+    return YES;
+}
+
+- (BOOL)parseCompressedFile:(NSString *)path error:(NSError **)error
+{
+    ESXPCompressedReader *reader = [ESXPCompressedReader newBuild:path];
+    if (![reader open:error])
+        return NO;
+    
+    // The reader is closed however the parse ends, a handler may throw too, or its thread
+    // would wait for room in the ring forever.
+    @try {
+        NSError *cause = nil;
+        NSData  *chunk = nil;
+        while ((chunk = [reader nextChunk:&cause]) != nil) {
+            BOOL parsed = [self pushData:chunk final:NO error:error];
+            if (!parsed || self.pushBuffer == nil)
+                return parsed; // The parse failed or a handler stopped it, the rest of the file is not needed.
+        }
+        
+        if (cause != nil) {
+            [self endDocument];
+            self.tokenizer  = nil;
+            self.pushBuffer = nil;
+            if (error != NULL)
+                *error = cause;
+            
+            return NO;
+        }
+        
+        return [self pushData:nil final:YES error:error];
+    }
+    @finally {
+        [reader close];
+    }
+}
+
+- (void)watchElement:(NSString *)name handler:(ESXPSubtreeHandler)handler
+{
+    if (self.watched == nil)
+        self.watched = [NSMutableDictionary new];
+    
+    NSNumber *symbol = @([[self.document getNameTable] internName:name]);
+    if (handler != nil)
+        [self.watched setObject:[handler copy] forKey:symbol];
+    else
+        [self.watched removeObjectForKey:symbol];
+}
+
+- (void)reset
+{
+    self.tokenizer   = nil;
+    self.pushBuffer  = nil;
+    self.source      = nil;
+    self.record      = nil;
+    self.stopped     = NO;
+    self.pendingText = nil;
+    self.pendingRaw  = (ESXPRange) { NULL, 0 };
+    self.exceeded    = 0;
+    self.document    = [ESXPDocument newBuild:@"_root" nameTable:[self.document getNameTable]];
+    self->stackSize  = 0;
+}
+
 -(ESXPDocument *)getDOM { return self.document; }
+
+// MARK: Builder
+- (void)beginDocument
+{
+    self.stopped      = NO;
+    self.exceeded     = 0;
+    self->usedBytes   = 0;
+    self->recordBytes = 0;
+    self.recordSymbol = (self.recordName != nil) ? [[self.document getNameTable] internName:self.recordName] : kNO_SYMBOL;
+    if (self.buildTagIndex)
+        [self.document indexTags];
+    
+    // A piece starts inside the open elements of its document, see projectFrom:.
+    self.bound = [self.projection bind:[self.document getNameTable]];
+    if (self.fragmentParent == nil) {
+        self->openCount  = 0;
+        self->builtCount = 0;
+        self->keptDepth  = 0;
+    }
+    
+    [self.document keepStatistics];
+    [self push:[self.document getRootNode]];
+    
+    // Pieces run inside the parse of their document. A parse that starts over keeps its start.
+    if (self.fragmentParent == nil && self->parseStart == 0 && ESXPMetricsEnabled())
+        self->parseStart = [ESXPMetrics beginPhase:PHASE_PARSE];
+}
+
+- (ESXPElement *)beginElement:(NSString *)name symbol:(NSUInteger)symbol attributeCount:(NSUInteger)attributeCount
+{
+    ESXPElement *element = nil;
+    if (self.projection == nil || [self projects:symbol])
+        element = [self buildElement:name symbol:symbol attributeCount:attributeCount];
+    
+    if (self.maxDepth > 0 && [self depth] > self.maxDepth)
+        [self exceed:PARSE_DEPTH_EXCEEDED];
+    
+    return element;
+}
+
+/// Builds a new element as the last child of the current one.
+- (ESXPElement *)buildElement:(NSString *)name symbol:(NSUInteger)symbol attributeCount:(NSUInteger)attributeCount
+{
+    [self flushText];
+    
+    // In streaming mode a record starts its own document, so that it never gets attached to the main tree.
+    ESXPElement *last = self->stack[self->stackSize - 1];
+    if (self.recordSymbol != kNO_SYMBOL && self.record == nil && symbol == self.recordSymbol) {
+        self.record = [ESXPDocument newBuild:@"_root" nameTable:[self.document getNameTable]];
+        last        = [self.record getRootNode];
+        [self.record keepStatistics];
+        if (self.buildTagIndex)
+            [self.record indexTags];
+    }
+    
+    // Append the new node into the stack. Records of a piece already point to the parent they will be attached to.
+    ESXPElement *element = [ESXPElement newBuild:name symbol:symbol parentNode:[self parentFor:last]];
+    [last appendChild:element];
+    [[self target] indexElement:element];
+    [self push:element];
+    self.lastSibling = nil;
+    
+    if (self.record != nil && last == [self.record getRootNode])
+        self.recordDepth = self->stackSize;
+    
+    // The stack holds the root below the open elements, and a record is counted from its own root.
+    [[self target] countElement:(self.record != nil ? self->stackSize - self.recordDepth + 1 : self->stackSize - 1) attributes:attributeCount];
+    if (ESXPMetricsEnabled()) {
+        self->counts[METRIC_ELEMENTS]++;
+        self->counts[METRIC_ATTRIBUTES] += attributeCount;
+        self->counts[METRIC_NODES_ALLOCATED]++;
+    }
+    
+    [self account:(ESXPDocumentFootprint) { self->elementBytes, 0, 0, 0 }];
+    
+    return element;
+}
+
+- (void)appendText:(NSString *)string
+{
+    if ([self skipsText] || ([self dropsWhitespace] && ESXPIsBlankString(string)))
+        return;
+    
+    if (self.coalesceText)
+        [[self pendingString] appendString:string];
+    else if (!self.ignoreWhitespace || !ESXPIsBlankString(string))
+        [self addText:string];
+}
+
+- (void)appendRawText:(ESXPRange)raw escaped:(BOOL)escaped
+{
+    if ([self skipsText])
+        return;
+    
+    if (!self.coalesceText) {
+        if (!self.ignoreWhitespace || !ESXPIsBlank(raw))
+            [self addRawText:raw escaped:escaped];
+    }
+    else if (self.pendingText == nil && self.pendingRaw.bytes == NULL) {
+        // A run made of a single piece stays raw, so lazyValues still holds.
+        self.pendingRaw     = raw;
+        self.pendingEscaped = escaped;
+    }
+    else {
+        [[self pendingString] appendString:ESXPDecodeText(raw, escaped)];
+    }
+}
+
+// Whitespace between records would pile up in the main document for the whole file.
+- (BOOL)dropsWhitespace { return self.recordSymbol != kNO_SYMBOL && self.record == nil; }
+
+- (BOOL)skipsText { return self.projection != nil && self->keptDepth == 0; }
+
+- (BOOL)endElement
+{
+    // A skipped element only left its symbol.
+    if (self.projection != nil) {
+        if (self->openCount-- > self->builtCount)
+            return NO;
+        
+        if (self->keptDepth == self->openCount + 1)
+            self->keptDepth = 0;
+        self->builtCount--;
+    }
+    
+    [self flushText];
+    ESXPElement *element = self->stack[--self->stackSize];
+    self.lastSibling = nil;
+    
+    BOOL               stop    = NO;
+    ESXPSubtreeHandler handler = ([self.watched count] > 0) ? [self.watched objectForKey:@([element getNodeSymbol])] : nil;
+    if (handler != nil) {
+        handler(element, &stop);
+        self.stopped = stop;
+    }
+    
+    if (stop || self.record == nil || self->stackSize + 1 != self.recordDepth)
+        return stop;
+    
+    // Hand the record over and let it go before moving on.
+    self->usedBytes  -= self->recordBytes;
+    self->recordBytes = 0;
+    @autoreleasepool {
+        ESXPDocument *record = self.record;
+        self.record = nil;
+        if (self.recordHandler != nil)
+            self.recordHandler(record, &stop);
+    }
+    
+    self.stopped = stop;
+    return stop;
+}
+
+- (void)endDocument
+{
+    [self flushText];
+    if (self->stackSize > 0)
+        self->stackSize--;
+    
+    if (self.fragmentParent == nil)
+        [self endParse];
+    else
+        [self flushCounts];
+}
+
+- (void)projectFrom:(ESXPSAX2DOM *)builder
+{
+    self->openCapacity = MAX(builder->openCount * 2, (NSUInteger) 16);
+    self->openSymbols  = realloc(self->openSymbols, self->openCapacity * sizeof(NSUInteger));
+    self->openCount    = builder->openCount;
+    self->builtCount   = builder->openCount;
+    self->keptDepth    = builder->keptDepth;
+    memcpy(self->openSymbols, builder->openSymbols, builder->openCount * sizeof(NSUInteger));
+}
+
+- (BOOL)parseFragment:(NSData *)data range:(NSRange)range parent:(ESXPElement *)parent
+{
+    ESXPTokenizerCallbacks callbacks = { ESXPSAX2DOMStartElement, ESXPSAX2DOMEndElement, ESXPSAX2DOMCharacters };
+    
+    self.fragmentParent = parent;
+    self.tokenizer      = [ESXPTokenizer newBuild:callbacks context:(__bridge void *)self fragment:YES];
+    self.source         = data;
+    [self beginDocument];
+    NSUInteger consumed = [self.tokenizer tokenize:(const char *) [data bytes] + range.location length:range.length final:YES error:NULL];
+    [self endDocument];
+    self.tokenizer = nil;
+    self.source    = nil;
+    
+    return consumed != NSNotFound && self.exceeded == 0;
+}
+
+// MARK: Private Methods
+/// Returns the document nodes are added to: the record being built, or the main document.
+- (ESXPDocument *)target { return self.record != nil ? self.record : self.document; }
+
+- (void)addText:(NSString *)string
+{
+    ESXPElement *last   = self->stack[self->stackSize - 1];
+    ESXPText    *text   = nil;
+    NSUInteger  length  = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    uint64_t    objects = 0;
+    if (self.compactText) {
+        NSData    *chunk = nil;
+        ESXPRange bytes  = [[[self target] getTextBuffer] appendString:string chunk:&chunk];
+        text = [ESXPText newBuild:chunk bytes:bytes parentNode:[self parentFor:last]];
+    }
+    else {
+        text    = [ESXPText newBuild:nil parentNode:[self parentFor:last]];
+        objects = kOBJECT_BYTES;
+        [text setNodeValue:string];
+    }
+    [[self target] countText:length];
+    [self account:(ESXPDocumentFootprint) { self->textBytes, 0, objects + length, 0 }];
+    if (ESXPMetricsEnabled())
+        self->counts[METRIC_NODES_ALLOCATED]++;
+    
+    self.lastSibling = (ESXPText *) [last appendChild:text];
+}
+
+- (void)addRawText:(ESXPRange)raw escaped:(BOOL)escaped
+{
+    ESXPElement *last   = self->stack[self->stackSize - 1];
+    ESXPText    *text   = nil;
+    uint64_t    copied  = 0;
+    if (self.lazyValues && self.pushBuffer == nil) {
+        text = [ESXPText newBuild:self.source raw:raw escaped:escaped parentNode:[self parentFor:last]];
+    }
+    else {
+        // Only compactText gets here: the run is copied (and decoded) into the text buffer.
+        NSData    *chunk = nil;
+        ESXPRange bytes  = [[[self target] getTextBuffer] appendText:raw escaped:escaped chunk:&chunk];
+        text   = [ESXPText newBuild:chunk bytes:bytes parentNode:[self parentFor:last]];
+        copied = bytes.length;
+    }
+    [[self target] countText:raw.length];
+    [self account:(ESXPDocumentFootprint) { self->textBytes, 0, copied, 0 }];
+    if (ESXPMetricsEnabled())
+        self->counts[METRIC_NODES_ALLOCATED]++;
+    
+    self.lastSibling = (ESXPText *) [last appendChild:text];
+}
+
+/// Returns the decoded text run being coalesced, starting one if there is none.
+- (NSMutableString *)pendingString
+{
+    if (self.pendingText == nil) {
+        self.pendingText = [NSMutableString new];
+        if (self.pendingRaw.bytes != NULL) {
+            [self.pendingText appendString:ESXPDecodeText(self.pendingRaw, self.pendingEscaped)];
+            self.pendingRaw = (ESXPRange) { NULL, 0 };
+        }
+    }
+    
+    return self.pendingText;
+}
+
+/// Adds the text run being coalesced, if any, as a single text node. Called whenever
+/// markup ends the run: the start or end of an element, or the end of the document.
+- (void)flushText
+{
+    if (self.pendingRaw.bytes != NULL) {
+        ESXPRange raw = self.pendingRaw;
+        self.pendingRaw = (ESXPRange) { NULL, 0 };
+        if (!self.ignoreWhitespace || !ESXPIsBlank(raw))
+            [self addRawText:raw escaped:self.pendingEscaped];
+    }
+    else if (self.pendingText != nil) {
+        NSString *string = [self.pendingText copy];
+        self.pendingText = nil;
+        if (!self.ignoreWhitespace || !ESXPIsBlankString(string))
+            [self addText:string];
+    }
+}
+
+/// Pushes the symbol of a new element and decides whether to build it. The elements it
+/// is nested in are built first if it is, as bare elements without attributes or text.
+///
+/// \param symbol The symbol of the name of the element.
+///
+/// \return YES if the element is built.
+- (BOOL)projects:(NSUInteger)symbol
+{
+    if (self->openCount == self->openCapacity) {
+        self->openCapacity = MAX(self->openCapacity * 2, (NSUInteger) 16);
+        self->openSymbols  = realloc(self->openSymbols, self->openCapacity * sizeof(NSUInteger));
+    }
+    self->openSymbols[self->openCount++] = symbol;
+    
+    // Records are built even when nothing in them is kept, for the handler to get every one.
+    BOOL kept   = self->keptDepth == 0 && [self.bound keeps:self->openSymbols count:self->openCount];
+    BOOL record = self.recordSymbol != kNO_SYMBOL && self.record == nil && symbol == self.recordSymbol;
+    if (self->keptDepth == 0 && !kept && !record)
+        return NO;
+    
+    [self buildOpen:self->openCount - 1];
+    if (kept)
+        self->keptDepth = self->openCount;
+    self->builtCount++;
+    
+    return YES;
+}
+
+/// Builds the open elements skipped so far, outermost first.
+///
+/// \param count The count of open elements that must be built.
+- (void)buildOpen:(NSUInteger)count
+{
+    ESXPNameTable *nameTable = [self.document getNameTable];
+    while (self->builtCount < count) {
+        NSUInteger symbol = self->openSymbols[self->builtCount++];
+        [self buildElement:[nameTable nameForSymbol:symbol] symbol:symbol attributeCount:0];
+    }
+}
+
+/// Returns the depth of the current element, skipped or not.
+- (NSUInteger)depth { return (self.projection != nil) ? self->openCount : self->stackSize - 1; }
+
+- (ESXPElement *)parentFor:(ESXPElement *)last { return (self.fragmentParent != nil && self->stackSize == 1) ? self.fragmentParent : last; }
+
+- (void)push:(ESXPElement *)element
+{
+    if (self->stackSize == self->stackCapacity) {
+        self->stackCapacity = MAX(self->stackCapacity * 2, (NSUInteger) 16);
+        self->stack         = (ESXPElement * __unsafe_unretained *) realloc(self->stack, self->stackCapacity * sizeof(ESXPElement *));
+    }
+    
+    self->stack[self->stackSize++] = element;
+}
+
+- (void)countChunk:(NSUInteger)bytes
+{
+    self->counts[METRIC_TEXT_CHUNKS]++;
+    self->counts[METRIC_TEXT_BYTES] += bytes;
+}
+
+- (void)account:(ESXPDocumentFootprint)bytes
+{
+    uint64_t total = bytes.nodeBytes + bytes.textBytes + bytes.attributeBytes;
+    [[self target] addFootprint:bytes];
+    self->usedBytes += total;
+    if (self.record != nil)
+        self->recordBytes += total;
+    
+    // The pieces of a parse on many threads share its budget.
+    uint64_t used = self->usedBytes;
+    if (self->sharedBytes != NULL)
+        used = self->baseBytes + atomic_fetch_add_explicit(self->sharedBytes, total, memory_order_relaxed) + total;
+    
+    if (self.maxBytes > 0 && self.exceeded == 0 && used + [[self.document getNameTable] getByteCount] > self.maxBytes)
+        [self exceed:PARSE_BUDGET_EXCEEDED];
+}
+
+/// Stops the parse after the current event because a limit was passed.
+- (void)exceed:(ErrorCodes)limit
+{
+    if (self.exceeded != 0)
+        return;
+    
+    self.exceeded = limit;
+    [self.tokenizer abort];
+    [self.parser abortParsing];
+}
+
+/// Fails the parse with the error of the limit that was passed.
+- (BOOL)failLimit:(NSError **)error
+{
+    NSString *reason = (self.exceeded == PARSE_DEPTH_EXCEEDED)
+        ? NSLocalizedString(@"El documento excede la profundidad maxima.", @"")
+        : NSLocalizedString(@"El documento excede el presupuesto de memoria.", @"");
+    
+    return [self fail:self.exceeded reason:reason underlying:nil error:error];
+}
+
+/// Adds what this builder counted to ESXPMetrics.
+- (void)flushCounts
+{
+    for (NSUInteger i = 0; i < METRIC_COUNT; i++) {
+        if (self->counts[i] > 0) {
+            [ESXPMetrics add:self->counts[i] counter:(MetricCounters) i];
+            self->counts[i] = 0;
+        }
+    }
+}
+
+/// Ends the parse phase, if it is being measured. Safe to call more than once.
+- (void)endParse
+{
+    [self flushCounts];
+    [ESXPMetrics endPhase:PHASE_PARSE start:self->parseStart];
+    self->parseStart = 0;
+}
+
+- (BOOL)fail:(ErrorCodes)code reason:(NSString *)reason underlying:(NSError *)cause error:(NSError **)error
+{
+    [self endParse];
+    if (error != NULL) {
+        NSString            *domain   = @"net.apkc.projects.ErrorDomain";
+        NSMutableDictionary *userInfo = [@{ NSLocalizedDescriptionKey : reason } mutableCopy];
+        if (cause != nil)
+            [userInfo setObject:cause forKey:NSUnderlyingErrorKey];
+        
+        *error = [NSError errorWithDomain:domain code:code userInfo:userInfo];
+    }
+    
+    if (kDEBUG)
+        NSLog(@"ERROR ==> %@ (%@)", reason, [cause localizedDescription]);
+    
+    return NO;
+}
 @end
+
+// MARK: Native Front End
+static void ESXPSAX2DOMStartElement(void *context, ESXPRange name, const ESXPTokenAttribute *attributes, NSUInteger attributeCount)
+{
+    ESXPSAX2DOM                   *builder   = (__bridge ESXPSAX2DOM *)context;
+    ESXPNameTable                 *nameTable = [builder.document getNameTable];
+    NSString * __unsafe_unretained interned  = nil;
+    NSUInteger                    symbol     = [nameTable internBytes:name.bytes length:name.length interned:&interned];
+    ESXPElement                   *element   = [builder beginElement:interned symbol:symbol attributeCount:attributeCount];
+    if (element == nil || attributeCount == 0)
+        return;
+    
+    NSString * __unsafe_unretained names[attributeCount];
+    for (NSUInteger i = 0; i < attributeCount; i++)
+        [nameTable internBytes:attributes[i].name.bytes length:attributes[i].name.length interned:&names[i]];
+    
+    uint64_t bytes = 0;
+    if (builder.lazyValues && builder.pushBuffer == nil) {
+        [element setRawAttributes:attributes names:names count:attributeCount source:builder.source];
+        bytes = attributeCount * sizeof(ESXPTokenAttribute);
+    }
+    else {
+        for (NSUInteger i = 0; i < attributeCount; i++) {
+            [element setAttribute:names[i] value:ESXPDecodeAttribute(attributes[i].value)];
+            bytes += kOBJECT_BYTES + 2 * sizeof(id) + attributes[i].value.length;
+        }
+    }
+    
+    [builder account:(ESXPDocumentFootprint) { 0, 0, 0, bytes }];
+}
+
+static void ESXPSAX2DOMEndElement(void *context, ESXPRange name)
+{
+    ESXPSAX2DOM *builder = (__bridge ESXPSAX2DOM *)context;
+    if ([builder endElement])
+        [builder.tokenizer abort];
+}
+
+static void ESXPSAX2DOMCharacters(void *context, ESXPRange text, BOOL escaped)
+{
+    ESXPSAX2DOM *builder = (__bridge ESXPSAX2DOM *)context;
+    if (ESXPMetricsEnabled())
+        [builder countChunk:text.length];
+    
+    if ([builder skipsText] || ([builder dropsWhitespace] && ESXPIsBlank(text)))
+        return;
+    
+    if ((builder.lazyValues && builder.pushBuffer == nil) || builder.compactText)
+        [builder appendRawText:text escaped:escaped];
+    else
+        [builder appendText:ESXPDecodeText(text, escaped)];
+}
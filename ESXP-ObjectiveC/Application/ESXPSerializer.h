@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ESXPDocument.h"
+#import "ESXPNode.h"
+
+/// Writes documents and subtrees out as XML.
+///
+/// <p>
+/// Output goes through a fixed size buffer to a file descriptor, an NSOutputStream or an
+/// NSMutableData. The tree is walked with the parent and sibling links instead of
+/// recursion or a stack, so the memory used does not depend on the size or depth of what
+/// is written. Text and attribute values are escaped, names are encoded once per interned name.
+/// </p>
+///
+/// <p>
+/// With prettyPrint set, elements are put on lines of their own, indented by depth, and
+/// text made only of whitespace is left out. This changes the whitespace of mixed content
+/// and is meant for data oriented XML. Attributes are written in no particular order.
+/// </p>
+///
+/// <p>
+/// The first write error stops all output; it is returned by the write or flush call that
+/// found it and by every call after it.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPSerializer : NSObject
+// MARK: Properties
+@property (nonatomic, assign) BOOL       prettyPrint;
+@property (nonatomic, assign) NSUInteger indentWidth;
+
+// MARK: Builders
+/// Builder of new instances writing to a file descriptor. Follows the Builder Pattern.
+///
+/// \param fileDescriptor The descriptor, open for writing. Not closed by the serializer.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPSerializer *)newBuildToFileDescriptor:(int)fileDescriptor;
+
+/// Builder of new instances writing to a stream. Follows the Builder Pattern.
+///
+/// \param stream The stream, already open.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPSerializer *)newBuildToStream:(NSOutputStream *)stream;
+
+/// Builder of new instances appending to a data object. Follows the Builder Pattern.
+///
+/// \param data The data to append to.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPSerializer *)newBuildToData:(NSMutableData *)data;
+
+// MARK: Methods
+/// Writes a document: the XML declaration followed by the children of the root node,
+/// which stands for the document itself.
+///
+/// \param document The document.
+/// \param error    Set if the output can not be written.
+///
+/// \return YES if everything was written to the buffer or the output.
+- (BOOL)writeDocument:(ESXPDocument *)document error:(NSError **)error;
+
+/// Writes a node and everything below it.
+///
+/// \param node  The node.
+/// \param error Set if the output can not be written.
+///
+/// \return YES if everything was written to the buffer or the output.
+- (BOOL)writeNode:(id<ESXPNode>)node error:(NSError **)error;
+
+/// Writes out what is left in the buffer. Must be called once done, the serializer does
+/// not flush on its own when it goes away.
+///
+/// \param error Set if the output can not be written.
+///
+/// \return YES if everything was written to the output.
+- (BOOL)flush:(NSError **)error;
+@end
@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <errno.h>
+#import <unistd.h>
+#import "ESXPConstants.h"
+#import "ESXPSerializer.h"
+#import "ESXPText.h"
+#import "ESXPTokenizer.h"
+
+static NSUInteger const kBUFFER_SIZE = 64 * 1024; // The bytes kept before writing to the output.
+
+/// Returns the UTF-8 bytes of a string, without copying when the string can give them.
+static inline const char *ESXPUTF8(NSString *string, NSUInteger *length)
+{
+    const char *bytes = CFStringGetCStringPtr((__bridge CFStringRef) string, kCFStringEncodingUTF8);
+    if (bytes == NULL)
+        bytes = [string UTF8String];
+    
+    *length = strlen(bytes);
+    return bytes;
+}
+
+/// Returns the reference replacing a byte, or NULL if the byte is written as is.
+static inline const char *ESXPEscape(char c, BOOL attribute)
+{
+    switch (c) {
+        case '&':  return "&amp;";
+        case '<':  return "&lt;";
+        case '>':  return "&gt;";
+        case '\r': return "&#13;";
+        case '"':  return attribute ? "&quot;" : NULL;
+        case '\t': return attribute ? "&#9;" : NULL;
+        case '\n': return attribute ? "&#10;" : NULL;
+        default:   return NULL;
+    }
+}
+
+/// Returns YES if a run of UTF-8 bytes holds only whitespace.
+static inline BOOL ESXPIsBlankBytes(ESXPRange text)
+{
+    for (NSUInteger i = 0; i < text.length; i++)
+        if (text.bytes[i] != ' ' && text.bytes[i] != '\t' && text.bytes[i] != '\n' && text.bytes[i] != '\r')
+            return NO;
+    
+    return YES;
+}
+
+@interface ESXPSerializer ()
+{
+    char           *buffer;        // The bytes not yet written to the output.
+    NSUInteger     length;         // The count of bytes in the buffer.
+    int            fileDescriptor; // The output when writing to a descriptor, -1 otherwise.
+    NSOutputStream *stream;        // The output when writing to a stream.
+    NSMutableData  *data;          // The output when writing to a data object.
+    NSError        *failure;       // The first write error, after which nothing is written.
+    NSMutableArray *names;         // The UTF-8 bytes of every name written, by symbol.
+    NSMutableArray *nameKeys;      // The interned name each entry of names was encoded from.
+    BOOL           textWritten;    // If the last thing written was text, pretty printing leaves it alone.
+    BOOL           started;        // If anything was written, the first tag goes on the first line.
+}
+@end
+
+@implementation ESXPSerializer
+// MARK: Builders
++ (ESXPSerializer *)newBuildToFileDescriptor:(int)fileDescriptor
+{
+    ESXPSerializer *instance = [ESXPSerializer newBuild];
+    if (instance) {
+        instance->fileDescriptor = fileDescriptor;
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
++ (ESXPSerializer *)newBuildToStream:(NSOutputStream *)stream
+{
+    ESXPSerializer *instance = [ESXPSerializer newBuild];
+    if (instance) {
+        instance->stream = stream;
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
++ (ESXPSerializer *)newBuildToData:(NSMutableData *)data
+{
+    ESXPSerializer *instance = [ESXPSerializer newBuild];
+    if (instance) {
+        instance->data = data;
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
++ (ESXPSerializer *)newBuild
+{
+    ESXPSerializer *instance = [[ESXPSerializer alloc] init];
+    if (instance) {
+        instance->buffer         = malloc(kBUFFER_SIZE);
+        instance->length         = 0;
+        instance->fileDescriptor = -1;
+        instance->names          = [NSMutableArray new];
+        instance->nameKeys       = [NSMutableArray new];
+        instance.indentWidth     = 2;
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc { free(self->buffer); }
+
+// MARK: Methods
+- (BOOL)writeDocument:(ESXPDocument *)document error:(NSError **)error
+{
+    // Pretty printing breaks the line before the first tag itself.
+    static char const declaration[] = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+    [self put:declaration length:sizeof(declaration) - 1];
+    if (!self.prettyPrint)
+        [self put:"\n" length:1];
+    
+    for (id<ESXPNode> node = [[document getRootNode] getFirstChild]; node != nil && self->failure == nil; node = [node getNextSibling])
+        [self writeNode:node error:NULL];
+    
+    if (self.prettyPrint)
+        [self put:"\n" length:1];
+    
+    return [self check:error];
+}
+
+- (BOOL)writeNode:(id<ESXPNode>)start error:(NSError **)error
+{
+    // Go down the first children and along the siblings, closing the elements left behind
+    // on the way back up, until the start node is closed.
+    id<ESXPNode> node  = start;
+    NSUInteger   depth = 0;
+    while (node != nil && self->failure == nil) {
+        if ([self open:node depth:depth]) {
+            node = [node getFirstChild];
+            depth++;
+            continue;
+        }
+        
+        while (![node isEqual:start] && [node getNextSibling] == nil) {
+            node = [node getParentNode];
+            depth--;
+            [self close:node depth:depth];
+        }
+        
+        node = [node isEqual:start] ? nil : [node getNextSibling];
+    }
+    
+    return [self check:error];
+}
+
+- (BOOL)flush:(NSError **)error
+{
+    [self drain];
+    return [self check:error];
+}
+
+// MARK: Private Methods
+/// Writes a node, leaving the start tag open if it has children.
+///
+/// \return YES if the node has children to write, and its end tag is still to come.
+- (BOOL)open:(id<ESXPNode>)node depth:(NSUInteger)depth
+{
+    if ([node getNodeType] == TEXT_NODE) {
+        // Text held as UTF-8 bytes is written from them, without making a string.
+        ESXPRange bytes;
+        if ([node isKindOfClass:[ESXPText class]] && [(ESXPText *) node getValueBytes:&bytes]) {
+            if (self.prettyPrint && ESXPIsBlankBytes(bytes))
+                return NO;
+            
+            [self putEscapedBytes:bytes.bytes length:bytes.length attribute:NO];
+            self->textWritten = YES;
+            return NO;
+        }
+        
+        NSString *text = [node getNodeValue];
+        if (self.prettyPrint && [[text stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] length] == 0)
+            return NO;
+        
+        [self putEscaped:text attribute:NO];
+        self->textWritten = YES;
+        return NO;
+    }
+    
+    if ([node getNodeType] == COMMENT_NODE) {
+        NSUInteger commentLength = 0;
+        const char *comment = ESXPUTF8([node getNodeValue], &commentLength);
+        [self breakLine:depth];
+        [self put:"<!--" length:4];
+        [self put:comment length:commentLength];
+        [self put:"-->" length:3];
+        self->textWritten = NO;
+        return NO;
+    }
+    
+    [self breakLine:depth];
+    [self put:"<" length:1];
+    [self putName:node];
+    if ([node hasAttributes]) {
+        NSDictionary *attributes = [node getAttributes];
+        for (NSString *name in attributes) {
+            NSUInteger nameLength = 0;
+            const char *nameBytes = ESXPUTF8(name, &nameLength);
+            [self put:" " length:1];
+            [self put:nameBytes length:nameLength];
+            [self put:"=\"" length:2];
+            [self putEscaped:[attributes objectForKey:name] attribute:YES];
+            [self put:"\"" length:1];
+        }
+    }
+    
+    self->textWritten = NO;
+    if ([node getFirstChild] == nil) {
+        [self put:"/>" length:2];
+        return NO;
+    }
+    
+    [self put:">" length:1];
+    return YES;
+}
+
+- (void)close:(id<ESXPNode>)node depth:(NSUInteger)depth
+{
+    if (!self->textWritten)
+        [self breakLine:depth];
+    
+    [self put:"</" length:2];
+    [self putName:node];
+    [self put:">" length:1];
+    self->textWritten = NO;
+}
+
+/// Starts a new line indented to a depth, when pretty printing and not right after text.
+- (void)breakLine:(NSUInteger)depth
+{
+    if (!self.prettyPrint || self->textWritten)
+        return;
+    
+    if (self->started)
+        [self put:"\n" length:1];
+    
+    static char const spaces[] = "                                ";
+    for (NSUInteger indent = depth * self.indentWidth; indent > 0; ) {
+        NSUInteger count = MIN(indent, sizeof(spaces) - 1);
+        [self put:spaces length:count];
+        indent -= count;
+    }
+}
+
+- (void)putName:(id<ESXPNode>)node
+{
+    // Symbols belong to a name table, and nodes of documents with other tables may be
+    // written by the same serializer. The interned name, which is one instance per table
+    // and symbol and is kept alive by the cache, tells whether an entry is still good.
+    NSUInteger symbol = [node getNodeSymbol];
+    NSString   *key   = [node getNodeName];
+    NSData     *name  = nil;
+    if (symbol != kNO_SYMBOL && symbol < [self->names count] && [self->nameKeys objectAtIndex:symbol] == key)
+        name = [self->names objectAtIndex:symbol];
+    
+    if (name == nil) {
+        name = [key dataUsingEncoding:NSUTF8StringEncoding];
+        if (symbol == kNO_SYMBOL) {
+            [self put:[name bytes] length:[name length]];
+            return;
+        }
+        
+        while ([self->names count] <= symbol) {
+            [self->names addObject:[NSNull null]];
+            [self->nameKeys addObject:[NSNull null]];
+        }
+        [self->names replaceObjectAtIndex:symbol withObject:name];
+        [self->nameKeys replaceObjectAtIndex:symbol withObject:key];
+    }
+    
+    [self put:[name bytes] length:[name length]];
+}
+
+- (void)putEscaped:(NSString *)string attribute:(BOOL)attribute
+{
+    NSUInteger length = 0;
+    const char *bytes = ESXPUTF8(string, &length);
+    [self putEscapedBytes:bytes length:length attribute:attribute];
+}
+
+- (void)putEscapedBytes:(const char *)bytes length:(NSUInteger)length attribute:(BOOL)attribute
+{
+    // Copy the runs between the bytes to escape as they are.
+    NSUInteger run = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        const char *reference = ESXPEscape(bytes[i], attribute);
+        if (reference == NULL)
+            continue;
+        
+        [self put:bytes + run length:i - run];
+        [self put:reference length:strlen(reference)];
+        run = i + 1;
+    }
+    [self put:bytes + run length:length - run];
+}
+
+- (void)put:(const char *)bytes length:(NSUInteger)count
+{
+    self->started = YES;
+    if (self->length + count > kBUFFER_SIZE)
+        [self drain];
+    
+    if (count > kBUFFER_SIZE) {
+        [self output:bytes length:count];
+        return;
+    }
+    
+    memcpy(self->buffer + self->length, bytes, count);
+    self->length += count;
+}
+
+- (void)drain
+{
+    [self output:self->buffer length:self->length];
+    self->length = 0;
+}
+
+- (void)output:(const char *)bytes length:(NSUInteger)count
+{
+    if (self->failure != nil || count == 0)
+        return;
+    
+    if (self->data != nil) {
+        [self->data appendBytes:bytes length:count];
+        return;
+    }
+    
+    NSError *cause = nil;
+    while (count > 0) {
+        NSInteger written;
+        if (self->stream != nil) {
+            written = [self->stream write:(const uint8_t *) bytes maxLength:count];
+            if (written <= 0)
+                cause = [self->stream streamError];
+        }
+        else {
+            written = write(self->fileDescriptor, bytes, count);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                cause = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        }
+        
+        if (written <= 0) {
+            NSMutableDictionary *userInfo = [@{ NSLocalizedDescriptionKey : NSLocalizedString(@"No se pudo escribir el XML.", @"") } mutableCopy];
+            if (cause != nil)
+                [userInfo setObject:cause forKey:NSUnderlyingErrorKey];
+            self->failure = [NSError errorWithDomain:@"net.apkc.projects.ErrorDomain" code:SERIALIZER_WRITE_ERROR userInfo:userInfo];
+            return;
+        }
+        
+        bytes += written;
+        count -= written;
+    }
+}
+
+- (BOOL)check:(NSError **)error
+{
+    if (self->failure == nil)
+        return YES;
+    
+    if (error != NULL)
+        *error = self->failure;
+    
+    return NO;
+}
+@end
@@ -25,7 +25,6 @@
  */
 
 #import <Foundation/Foundation.h>
-#import "AKDataStructures.h"
 #import "ESXPElement.h"
 #import "ESXPNode.h"
 #import "ESXPStackDOMWalker.h"
@@ -57,36 +56,52 @@
 /// </pre>
 ///
 /// <p>
-/// The algorithm starts by adding the root node into the stack. Then on the
-/// first call to the method nextNode() it removes the root node from the stack
-/// but adds all its children into it, obeying the order last to first. This last
-/// step makes it possible to visit the nodes from left to right.<br/>
-/// This step is repeated until there are no more nodes in the pile.
+/// The algorithm starts by adding the root node into the stack. Then every call to
+/// the method nextNode() removes the node on top of the stack and adds, in this order,
+/// its next sibling and its first child. The child ends up on top, so the subtree of a
+/// node is visited before its next sibling, from left to right. The stack only ever
+/// holds one node per level of the tree.
 /// </p>
 ///
 /// <p>
 /// Sample behavior of the stack while loading the tree:
 ///
 /// <pre>
-///               DOC   NRO<br/>
-///         CLI   CTA   CTA   CTA         PIN<br/>
-///         AUTH  AUTH  AUTH  AUTH  AUTH  EST<br/>
-///         CTAS  CTAS  CTAS  CTAS  CTAS  CTAS<br/>
-///         TXT   TXT   TXT   TXT   TXT   TXT<br/>
-/// TRX     INFO  INFO  INFO  INFO  INFO  INFO<br/>
+///                     NRO<br/>
+///               DOC   CTA   CTA         PIN<br/>
+/// TRX     CLI   AUTH  AUTH  AUTH  AUTH  CTAS<br/>
 ///
 /// init()  It.1  It.2  It.3  It.4  It.5  It.6
 /// </pre>
 /// </p>
 ///
+/// <p>
+/// Skipping the descendants of a node is then a single pop of its first child, no
+/// matter how big the subtree is.
+/// </p>
+///
+/// <p>
+/// The stack is a plain C array that grows as needed, so maxNodes is only a hint. A
+/// walker can be moved onto a new root with reset:nodesToProcess: without allocating,
+/// and ESXPProcessor takes its walkers from a per-thread pool (see borrow and giveBack:).
+/// Besides hasNext/nextNode, a walker can be traversed with for...in or with a block
+/// visitor, both of which run the loop without a message send per node.
+/// </p>
+///
 /// \author Andreas P. Koenzen <akc at apkc.net>
 /// \see    Builder Pattern
-@interface ESXPStackDOMWalker : NSObject
+@interface ESXPStackDOMWalker : NSObject <NSFastEnumeration>
 {
-    id<ESXPNode>   currentNode;
-    NSMutableArray *currentChildren;
-    AKStack        *nodes;
-    unsigned short nodesToProcess;
+    id<ESXPNode>   currentNode;    // The last node returned.
+    void           **nodes;        // The stack, the next node to visit at every level, retained by hand.
+    NSUInteger     nodeCount;      // The count of nodes in the stack.
+    NSUInteger     nodeCapacity;   // The count of nodes allocated.
+    BOOL           rootPending;    // If the root was not returned yet. Its siblings are never visited.
+    BOOL           childPushed;    // If the first child of the last node returned is on top of the stack.
+    unsigned short nodesToProcess; // The type of the nodes to visit.
+    NSMutableArray *batch;         // The nodes handed out by the last fast enumeration call.
+    uint64_t       visited;        // The nodes returned since the last reset, for ESXPMetrics.
+    NSUInteger     highWater;      // The deepest stack since the last reset, for ESXPMetrics.
 }
 
 // MARK: Builders
@@ -95,12 +110,52 @@
 /// \return A new instance of this class or nil if any problem.
 + (ESXPStackDOMWalker *)newBuild;
 
+/// Takes a walker from the pool of the current thread, or builds one if the pool is empty.
+/// Give it back with giveBack: when done.
+///
+/// \return A walker, to be configured or reset before use.
++ (ESXPStackDOMWalker *)borrow;
+
+/// Returns a walker to the pool of the current thread.
+///
+/// \param walker A walker taken with borrow on this thread.
++ (void)giveBack:(ESXPStackDOMWalker *)walker;
+
 // MARK: Methods
-- (ESXPStackDOMWalker *)configure:(NSUInteger)maxNodes rootNode:(ESXPElement *)rootNode nodesToProcess:(unsigned short)ntp;
+/// Configures this walker to start at a given node.
+///
+/// \param maxNodes The expected maximum count of nodes in the stack. Only a hint.
+/// \param rootNode The node to start from. It is the first node returned.
+/// \param ntp      The type of the nodes to visit below the root, ELEMENT_NODE or TEXT_NODE.
+///
+/// \return This walker.
+- (ESXPStackDOMWalker *)configure:(NSUInteger)maxNodes rootNode:(id<ESXPNode>)rootNode nodesToProcess:(unsigned short)ntp;
+
+/// Moves this walker onto a new root, reusing its stack.
+///
+/// \param rootNode The node to start from. It is the first node returned.
+/// \param ntp      The type of the nodes to visit below the root, ELEMENT_NODE or TEXT_NODE.
+///
+/// \return This walker.
+- (ESXPStackDOMWalker *)reset:(id<ESXPNode>)rootNode nodesToProcess:(unsigned short)ntp;
 
+/// Returns the next node in document order.
+///
+/// \return The next node, or nil at the end.
 - (id<ESXPNode>)nextNode;
 
+/// Skips the descendants of the last node returned, in constant time. Not to be used
+/// inside for...in, which runs ahead of the loop body, use visit: instead.
 - (void)skipChildren;
 
+/// Returns YES if there are more nodes.
+///
+/// \return YES if there are more nodes.
 - (BOOL)hasNext;
+
+/// Visits the remaining nodes in document order.
+///
+/// \param visitor The block to call for every node. Set skipChildren to skip the
+///                descendants of the node, and stop to end the traversal.
+- (void)visit:(void (^)(id<ESXPNode> node, BOOL *skipChildren, BOOL *stop))visitor;
 @end
@@ -24,67 +24,198 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#import "ESXPConstants.h"
+#import "ESXPMetrics.h"
 #import "ESXPStackDOMWalker.h"
 
+static NSString * const kWALKER_POOL     = @"net.apkc.projects.ESXPStackDOMWalkerPool"; // The key of the pool in the thread dictionary.
+static NSUInteger const kWALKER_POOL_MAX = 8;                                            // The maximum count of idle walkers per thread.
+
 @implementation ESXPStackDOMWalker
+/// Returns the node itself or the first of its following siblings of a given type.
+static inline id<ESXPNode> ESXPWalkerMatch(id<ESXPNode> node, unsigned short type)
+{
+    while (node != nil && [node getNodeType] != type)
+        node = [node getNextSibling];
+    
+    return node;
+}
+
+/// Pushes a node, growing the stack as needed.
+static inline void ESXPWalkerPush(ESXPStackDOMWalker *walker, id<ESXPNode> node)
+{
+    if (walker->nodeCount == walker->nodeCapacity) {
+        walker->nodeCapacity *= 2;
+        walker->nodes         = realloc(walker->nodes, walker->nodeCapacity * sizeof(void *));
+    }
+    
+    walker->nodes[walker->nodeCount++] = (__bridge_retained void *) node;
+    if (walker->nodeCount > walker->highWater)
+        walker->highWater = walker->nodeCount;
+}
+
+/// Pops the next node and pushes its next sibling and first child. A function, so that
+/// the loops of this class do not send a message per node.
+static id<ESXPNode> ESXPWalkerNext(ESXPStackDOMWalker *walker)
+{
+    if (walker->nodeCount == 0)
+        return nil;
+    
+    id<ESXPNode> node = (__bridge_transfer id<ESXPNode>) walker->nodes[--walker->nodeCount];
+    BOOL         root = walker->rootPending;
+    walker->currentNode = node;
+    walker->rootPending = NO;
+    walker->childPushed = NO;
+    walker->visited++;
+    
+    if (walker->nodesToProcess != ELEMENT_NODE && walker->nodesToProcess != TEXT_NODE)
+        return node;
+    
+    id<ESXPNode> sibling = root ? nil : ESXPWalkerMatch([node getNextSibling], walker->nodesToProcess);
+    if (sibling != nil)
+        ESXPWalkerPush(walker, sibling);
+    
+    id<ESXPNode> child = ESXPWalkerMatch([node getFirstChild], walker->nodesToProcess);
+    if (child != nil) {
+        ESXPWalkerPush(walker, child);
+        walker->childPushed = YES;
+    }
+    
+    return node;
+}
+
 // MARK: Builders
 + (ESXPStackDOMWalker *)newBuild
 {
     ESXPStackDOMWalker *instance = [[ESXPStackDOMWalker alloc] init];
-    if (instance)
+    if (instance) {
+        instance->nodeCapacity = 64;
+        instance->nodes        = malloc(instance->nodeCapacity * sizeof(void *));
         return instance;
-    else
+    }
+    else {
         return nil;
+    }
+}
+
++ (ESXPStackDOMWalker *)borrow
+{
+    NSMutableArray     *pool   = [[[NSThread currentThread] threadDictionary] objectForKey:kWALKER_POOL];
+    ESXPStackDOMWalker *walker = [pool lastObject];
+    if (walker == nil)
+        return [ESXPStackDOMWalker newBuild];
+    
+    [pool removeLastObject];
+    return walker;
+}
+
++ (void)giveBack:(ESXPStackDOMWalker *)walker
+{
+    NSMutableDictionary *threadDictionary = [[NSThread currentThread] threadDictionary];
+    NSMutableArray      *pool             = [threadDictionary objectForKey:kWALKER_POOL];
+    if (pool == nil) {
+        pool = [NSMutableArray new];
+        [threadDictionary setObject:pool forKey:kWALKER_POOL];
+    }
+    
+    // Do not keep the last tree alive through an idle walker.
+    [walker reset:nil nodesToProcess:walker->nodesToProcess];
+    if ([pool count] < kWALKER_POOL_MAX)
+        [pool addObject:walker];
+}
+
+- (void)dealloc
+{
+    [self clear];
+    free(self->nodes);
 }
 
 // MARK: Methods
-- (ESXPStackDOMWalker *)configure:(NSUInteger)maxNodes rootNode:(ESXPElement *)rootNode nodesToProcess:(unsigned short)ntp
+- (ESXPStackDOMWalker *)configure:(NSUInteger)maxNodes rootNode:(id<ESXPNode>)rootNode nodesToProcess:(unsigned short)ntp
 {
-    if (rootNode == nil) {
-        return self;
+    if (maxNodes > self->nodeCapacity) {
+        self->nodeCapacity = maxNodes;
+        self->nodes        = realloc(self->nodes, self->nodeCapacity * sizeof(void *));
     }
     
-    self->nodes = [[AKStack alloc] initWithSize:maxNodes];
-    [self->nodes push:rootNode];
+    return [self reset:rootNode nodesToProcess:ntp];
+}
+
+- (ESXPStackDOMWalker *)reset:(id<ESXPNode>)rootNode nodesToProcess:(unsigned short)ntp
+{
+    [self clear];
     self->nodesToProcess = ntp;
+    if (rootNode != nil) {
+        ESXPWalkerPush(self, rootNode);
+        self->rootPending = YES;
+    }
     
     return self;
 }
 
-- (id<ESXPNode>)nextNode
+- (id<ESXPNode>)nextNode { return ESXPWalkerNext(self); }
+
+- (void)skipChildren
 {
-    if (![self hasNext])
-        return nil;
+    // The first child of the last node stands for its whole subtree.
+    if (self->childPushed) {
+        CFBridgingRelease(self->nodes[--self->nodeCount]);
+        self->childPushed = NO;
+    }
+}
+
+- (BOOL)hasNext { return self->nodeCount > 0; }
+
+- (void)visit:(void (^)(id<ESXPNode> node, BOOL *skipChildren, BOOL *stop))visitor
+{
+    BOOL stop = NO;
+    while (self->nodeCount > 0 && !stop) {
+        BOOL skip = NO;
+        visitor(ESXPWalkerNext(self), &skip, &stop);
+        if (skip)
+            [self skipChildren];
+    }
+}
+
+// MARK: NSFastEnumeration Implementation
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state objects:(id __unsafe_unretained [])buffer count:(NSUInteger)len
+{
+    // The nodes must outlive the batch (arena nodes exist only while someone holds them).
+    if (self->batch == nil)
+        self->batch = [NSMutableArray arrayWithCapacity:len];
+    [self->batch removeAllObjects];
     
-    self->currentNode = [self->nodes pop];
-    self->currentChildren = [self->currentNode getChildNodes];
-    
-    int childLen = (self->currentChildren != nil) ? (int) [self->currentChildren count] : 0;
-    for (int i = childLen - 1; i >= 0; i--) {
-        switch (self->nodesToProcess) {
-            case ELEMENT_NODE:
-                if ([[self->currentChildren objectAtIndex:i] getNodeType] == ELEMENT_NODE)
-                    [self->nodes push:[self->currentChildren objectAtIndex:i]];
-                break;
-            case TEXT_NODE:
-                if ([[self->currentChildren objectAtIndex:i] getNodeType] == TEXT_NODE)
-                    [self->nodes push:[self->currentChildren objectAtIndex:i]];
-                break;
-        }
+    NSUInteger count = 0;
+    while (count < len && self->nodeCount > 0) {
+        id<ESXPNode> node = ESXPWalkerNext(self);
+        [self->batch addObject:node];
+        buffer[count++] = node;
     }
     
-    return self->currentNode;
+    state->state        = 1;
+    state->itemsPtr     = buffer;
+    state->mutationsPtr = &state->extra[0];
+    
+    return count;
 }
 
-- (void)skipChildren
+// MARK: Private Methods
+- (void)clear
 {
-    int childLen = (self->currentChildren != nil) ? (int) [self->currentChildren count] : 0;
-    for (int i = 0; i < childLen; i++) {
-        id<ESXPNode> child = [self->nodes peek];
-        if ([child isEqualNode:[self->currentChildren objectAtIndex:i]])
-            [self->nodes pop];
+    while (self->nodeCount > 0)
+        CFBridgingRelease(self->nodes[--self->nodeCount]);
+    
+    self->rootPending = NO;
+    self->childPushed = NO;
+    self->currentNode = nil;
+    [self->batch removeAllObjects];
+    
+    // The walk is over, hand its counts to the metrics.
+    if (self->visited > 0 && ESXPMetricsEnabled()) {
+        [ESXPMetrics add:self->visited counter:METRIC_WALKER_NODES];
+        [ESXPMetrics raise:self->highWater counter:METRIC_WALKER_STACK_MAX];
     }
+    self->visited   = 0;
+    self->highWater = 0;
 }
-
-- (BOOL)hasNext { return [self->nodes size] > 0; }
 @end
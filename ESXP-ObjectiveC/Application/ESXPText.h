@@ -26,16 +26,80 @@
 
 #import <Foundation/Foundation.h>
 #import "ESXPNode.h"
+#import "ESXPTokenizer.h"
 
 @class ESXPElement;
 
 /// Class for representing DOM Text.
 ///
+/// <p>
+/// A text node can be built over a raw, still escaped, run of bytes of the input. The
+/// run is decoded into an NSString the first time the value is asked for, and the
+/// string is kept from then on.
+/// </p>
+///
+/// <p>
+/// A text node can also be built over decoded UTF-8 bytes in the ESXPTextBuffer of its
+/// document. Those bytes are its value for good: getNodeValue makes a new NSString from
+/// them on every call and keeps none, so text takes its UTF-8 size in memory and not
+/// the one of a string. Callers reading a value many times should keep the string, or
+/// read the bytes with getValueBytes: or getValueData without any string at all.
+/// </p>
+///
 /// \author Andreas P. Koenzen <akc at apkc.net>
 @interface ESXPText : NSObject <ESXPNode>
 {
-    ESXPElement *parent; // The parent node of this node.
-    NSString    *name;   // The name of this node.
-    NSString    *value;  // The value of this node.
+    __weak ESXPElement               *parent;          // The parent node of this node. Weak, the parent owns its children.
+    __weak id<ESXPNode>              previousSibling; // The node before this one in the parent. Weak.
+    __weak id<ESXPNode>              nextSibling;     // The node after this one in the parent. Weak.
+    NSString                         *name;           // The name of this node.
+    NSString                         *value;          // The value of this node, nil until the raw run is decoded.
+    NSData                           *source;         // The input holding the raw run, nil once decoded.
+    ESXPRange                        raw;             // The raw run inside the input.
+    BOOL                             escaped;         // If the raw run has references or line endings to decode.
+    BOOL                             buffered;        // If the run is decoded bytes in a text buffer, never turned into a kept string.
 }
+
+// MARK: Builders
+/// Builder of new instances over a raw run of the input. Follows the Builder Pattern.
+///
+/// \param source     The input, kept alive until the run is decoded.
+/// \param raw        The raw run inside the input.
+/// \param escaped    If the run has references or line endings to decode.
+/// \param parentNode The parent node of this node.
+///
+/// \return A new instance of ESXPText if available, otherwise return NIL.
++ (ESXPText *)newBuild:(NSData *)source raw:(ESXPRange)raw escaped:(BOOL)escaped parentNode:(id<ESXPNode>)parentNode;
+
+/// Builder of new instances over decoded UTF-8 bytes, i.e. in an ESXPTextBuffer. Follows
+/// the Builder Pattern.
+///
+/// \param chunk      The data holding the bytes, kept alive by the node.
+/// \param bytes      The bytes inside the data.
+/// \param parentNode The parent node of this node.
+///
+/// \return A new instance of ESXPText if available, otherwise return NIL.
++ (ESXPText *)newBuild:(NSData *)chunk bytes:(ESXPRange)bytes parentNode:(id<ESXPNode>)parentNode;
+
+// MARK: Methods
+/// Returns the UTF-8 bytes of the value without copying them, if the node holds them
+/// decoded. They are valid for as long as this node is not changed or released.
+///
+/// \param bytes Set to the bytes of the value, if any. May be NULL to only test.
+///
+/// \return YES if the node holds its value as decoded UTF-8 bytes.
+- (BOOL)getValueBytes:(ESXPRange *)bytes;
+
+/// Returns the UTF-8 bytes of the value as data. The data shares the bytes of the node
+/// when it holds them decoded, and keeps them alive; otherwise they are encoded from
+/// the value.
+///
+/// \return The UTF-8 bytes of the value.
+- (NSData *)getValueData;
+
+/// Tests whether getNodeValue still has to decode a raw run of the input and keep the
+/// string, that is, whether reading the value writes to the node.
+///
+/// \return YES if the value is still to be decoded.
+- (BOOL)needsDecoding;
 @end
@@ -24,6 +24,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#import "ESXPConstants.h"
 #import "ESXPElement.h"
 #import "ESXPText.h"
 
@@ -53,11 +54,44 @@
     return instance;
 }
 
++ (ESXPText *)newBuild:(NSData *)source raw:(ESXPRange)raw escaped:(BOOL)escaped parentNode:(id<ESXPNode>)parentNode
+{
+    ESXPText *instance = [[ESXPText alloc] init];
+    if (instance) {
+        instance->parent  = (ESXPElement *)parentNode;
+        instance->name    = @"#text";
+        instance->value   = nil;
+        instance->source  = source;
+        instance->raw     = raw;
+        instance->escaped = escaped;
+    }
+    
+    return instance;
+}
+
++ (ESXPText *)newBuild:(NSData *)chunk bytes:(ESXPRange)bytes parentNode:(id<ESXPNode>)parentNode
+{
+    ESXPText *instance = [[ESXPText alloc] init];
+    if (instance) {
+        instance->parent   = (ESXPElement *)parentNode;
+        instance->name     = @"#text";
+        instance->value    = nil;
+        instance->source   = chunk;
+        instance->raw      = bytes;
+        instance->escaped  = NO;
+        instance->buffered = YES;
+    }
+    
+    return instance;
+}
+
 - (id<ESXPNode>)appendChild:(id<ESXPNode>)newChild { return nil; }
 
-- (void)countElementNodes:(unsigned short *)counter {}
+- (void)countElementNodes:(uint64_t *)counter {}
+
+- (NSString *)description { return [NSString stringWithFormat:@"<TEXT> Name: %@ - Value: %@\n", self->name, [self getNodeValue]]; }
 
-- (NSString *)description { return [NSString stringWithFormat:@"<TEXT> Name: %@ - Value: %@\n", self->name, self->value]; }
+- (NSString *)getAttribute:(NSString *)attributeName { return nil; }
 
 - (NSDictionary *)getAttributes { return nil; }
 
@@ -73,14 +107,31 @@
 
 - (NSString *)getNamespaceURI { return @""; }
 
+- (id<ESXPNode>)getNextSibling { return self->nextSibling; }
+
 - (NSString *)getNodeName { return self->name; }
 
+- (NSUInteger)getNodeSymbol { return kNO_SYMBOL; }
+
 - (unsigned short)getNodeType { return TEXT_NODE; }
 
-- (NSString *)getNodeValue { return self->value; }
+- (NSString *)getNodeValue
+{
+    if (self->buffered && self->source != nil)
+        return ESXPDecodeText(self->raw, NO);
+    
+    if (self->value == nil && self->source != nil) {
+        self->value  = ESXPDecodeText(self->raw, self->escaped);
+        self->source = nil;
+    }
+    
+    return self->value;
+}
 
 - (id<ESXPNode>)getParentNode { return self->parent; }
 
+- (id<ESXPNode>)getPreviousSibling { return self->previousSibling; }
+
 - (BOOL)hasAttributes { return false; }
 
 - (BOOL)hasChildNodes { return false; }
@@ -91,6 +142,12 @@
 
 - (BOOL)isSameNode:(id<ESXPNode>)other { return false; }
 
+- (void)linkSiblings:(id<ESXPNode>)previous next:(id<ESXPNode>)next
+{
+    self->previousSibling = previous;
+    self->nextSibling     = next;
+}
+
 - (NSString *)lookupNamespaceURI:(NSString *)prefix { return @""; }
 
 - (void)normalize { /* Do nothing, cause TEXT_NODES can't have TEXT_NODES. */ }
@@ -109,5 +166,35 @@
 
 - (id<ESXPNode>)replaceChild:(id<ESXPNode>)newChild oldChild:(id<ESXPNode>)oldChild { return nil; }
 
-- (void)setNodeValue:(NSString *)nodeValue { self->value = nodeValue; }
+- (void)setNodeValue:(NSString *)nodeValue
+{
+    self->value    = nodeValue;
+    self->source   = nil;
+    self->buffered = NO;
+}
+
+// MARK: Methods
+- (BOOL)getValueBytes:(ESXPRange *)bytes
+{
+    if (self->source == nil || self->escaped || self->value != nil)
+        return NO;
+    
+    if (bytes != NULL)
+        *bytes = self->raw;
+    
+    return YES;
+}
+
+- (NSData *)getValueData
+{
+    ESXPRange bytes;
+    if (![self getValueBytes:&bytes])
+        return [[self getNodeValue] dataUsingEncoding:NSUTF8StringEncoding];
+    
+    // The data keeps the chunk, or the input, alive instead of copying from it.
+    NSData *source = self->source;
+    return [[NSData alloc] initWithBytesNoCopy:(void *) bytes.bytes length:bytes.length deallocator:^(void *unused, NSUInteger length) { (void) source; }];
+}
+
+- (BOOL)needsDecoding { return !self->buffered && self->value == nil && self->source != nil; }
 @end
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import "ESXPTokenizer.h"
+
+/// Storage for the UTF-8 bytes of the text nodes of a document.
+///
+/// <p>
+/// Text is copied, decoded, into chunks of a fixed size, one run after the other, and a
+/// text node keeps the chunk holding its bytes together with their range. Runs longer
+/// than a quarter of a chunk get a chunk of their own, sized to fit. Chunks are never
+/// moved or grown once handed out, so ranges stay valid for as long as a node holds its
+/// chunk, and a chunk goes away with the last node using it.
+/// </p>
+///
+/// <p>
+/// A buffer is filled by a single builder at a time and is not thread safe.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPTextBuffer : NSObject
+{
+    NSMutableData *current;   // The chunk being filled, nil until the first run.
+    NSUInteger    used;       // The bytes of the current chunk already handed out.
+    NSUInteger    chunkSize;  // The bytes of a shared chunk.
+    uint64_t      byteCount;  // The bytes of all runs appended.
+}
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param chunkSize The bytes of a chunk shared by many runs.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPTextBuffer *)newBuild:(NSUInteger)chunkSize;
+
+// MARK: Methods
+/// Appends a run of character data, decoding it on the way.
+///
+/// \param text    The raw bytes.
+/// \param escaped If the run has references or line endings to decode.
+/// \param chunk   Set to the chunk holding the decoded bytes.
+///
+/// \return The decoded bytes, inside the chunk.
+- (ESXPRange)appendText:(ESXPRange)text escaped:(BOOL)escaped chunk:(NSData **)chunk;
+
+/// Appends the UTF-8 bytes of a string.
+///
+/// \param string The string.
+/// \param chunk  Set to the chunk holding the bytes.
+///
+/// \return The bytes, inside the chunk.
+- (ESXPRange)appendString:(NSString *)string chunk:(NSData **)chunk;
+
+/// Returns the bytes of all runs appended.
+///
+/// \return The bytes of all runs appended.
+- (uint64_t)getByteCount;
+@end
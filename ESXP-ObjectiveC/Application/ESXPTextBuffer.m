@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ESXPTextBuffer.h"
+
+@implementation ESXPTextBuffer
+// MARK: Builders
++ (ESXPTextBuffer *)newBuild:(NSUInteger)chunkSize
+{
+    ESXPTextBuffer *instance = [[ESXPTextBuffer alloc] init];
+    if (instance) {
+        instance->chunkSize = MAX(chunkSize, (NSUInteger) 1024);
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+// MARK: Methods
+- (ESXPRange)appendText:(ESXPRange)text escaped:(BOOL)escaped chunk:(NSData **)chunk
+{
+    char       *out    = [self reserve:text.length chunk:chunk];
+    NSUInteger written = ESXPDecodeTextBytes(text, escaped, out);
+    return [self commit:written chunk:chunk];
+}
+
+- (ESXPRange)appendString:(NSString *)string chunk:(NSData **)chunk
+{
+    NSUInteger length  = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    char       *out    = [self reserve:length chunk:chunk];
+    NSUInteger written = 0;
+    [string getBytes:out maxLength:length usedLength:&written encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0, [string length]) remainingRange:NULL];
+    return [self commit:written chunk:chunk];
+}
+
+- (uint64_t)getByteCount { return self->byteCount; }
+
+// MARK: Private Methods
+/// Returns room for a run, in the current chunk or in a chunk of its own.
+///
+/// \param length The most bytes the run may take.
+/// \param chunk  Set to the chunk the room is in.
+///
+/// \return The room.
+- (char *)reserve:(NSUInteger)length chunk:(NSData **)chunk
+{
+    // Long runs would waste the rest of a shared chunk.
+    if (length > self->chunkSize / 4) {
+        NSMutableData *own = [NSMutableData dataWithLength:MAX(length, (NSUInteger) 1)];
+        *chunk = own;
+        return [own mutableBytes];
+    }
+    
+    if (self->current == nil || self->used + length > self->chunkSize) {
+        self->current = [NSMutableData dataWithLength:self->chunkSize];
+        self->used    = 0;
+    }
+    
+    *chunk = self->current;
+    return (char *) [self->current mutableBytes] + self->used;
+}
+
+/// Hands out the bytes written in the room given by reserve:chunk:.
+///
+/// \param written The bytes written.
+/// \param chunk   The chunk the room is in.
+///
+/// \return The bytes written, inside the chunk.
+- (ESXPRange)commit:(NSUInteger)written chunk:(NSData **)chunk
+{
+    self->byteCount += written;
+    if (*chunk != self->current) {
+        // A chunk of its own is trimmed to the decoded length, which may move it.
+        [(NSMutableData *) *chunk setLength:written];
+        return (ESXPRange) { [*chunk bytes], written };
+    }
+    
+    ESXPRange bytes = { (const char *) [self->current bytes] + self->used, written };
+    self->used += written;
+    return bytes;
+}
+@end
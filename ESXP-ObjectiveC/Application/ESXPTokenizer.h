@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/// A run of bytes inside the input. Nothing is copied, the bytes belong to the input.
+typedef struct ESXPRange
+{
+    const char *bytes;
+    NSUInteger length;
+} ESXPRange;
+
+/// An attribute of a start tag. The value is still escaped, see ESXPDecodeAttribute.
+typedef struct ESXPTokenAttribute
+{
+    ESXPRange name;
+    ESXPRange value;
+} ESXPTokenAttribute;
+
+/// Functions called by the tokenizer for every event. The context is the one given to
+/// the tokenizer at build time.
+typedef struct ESXPTokenizerCallbacks
+{
+    void (*startElement)(void *context, ESXPRange name, const ESXPTokenAttribute *attributes, NSUInteger attributeCount);
+    void (*endElement)(void *context, ESXPRange name);
+    void (*characters)(void *context, ESXPRange text, BOOL escaped); // Escaped is YES if the text needs ESXPDecodeText.
+} ESXPTokenizerCallbacks;
+
+/// Decodes a run of character data: replaces entity and character references and
+/// normalizes line endings, the same way NSXMLParser does.
+///
+/// \param text    The raw bytes.
+/// \param escaped If NO the bytes are taken as they are.
+///
+/// \return The decoded text.
+NSString *ESXPDecodeText(ESXPRange text, BOOL escaped);
+
+/// Decodes a run of character data like ESXPDecodeText, but to UTF-8 bytes.
+///
+/// \param text    The raw bytes.
+/// \param escaped If NO the bytes are copied as they are.
+/// \param out     A buffer at least as long as the run, a decoded run is never longer.
+///
+/// \return The count of bytes written.
+NSUInteger ESXPDecodeTextBytes(ESXPRange text, BOOL escaped, char *out);
+
+/// Decodes an attribute value: replaces entity and character references and turns
+/// whitespace characters into spaces, the same way NSXMLParser does.
+///
+/// \param value The raw bytes.
+///
+/// \return The decoded value.
+NSString *ESXPDecodeAttribute(ESXPRange value);
+
+/// XML tokenizer working directly on a buffer of UTF-8 bytes.
+///
+/// <p>
+/// The tokenizer scans the buffer for markup with memchr (which is vectorized by the C
+/// library on every platform we target) and reports names, attribute values and text
+/// as ranges into the buffer. No object is allocated per event, and the input is never
+/// copied, so a memory mapped file can be tokenized in place.
+/// </p>
+///
+/// <p>
+/// It understands elements, attributes, character and entity references (the five
+/// predefined ones and numeric ones), comments, processing instructions, CDATA sections
+/// and a DOCTYPE with an internal subset. Comments, processing instructions and the
+/// DOCTYPE are skipped. CDATA sections are skipped too, since ESXPSAX2DOM drops them
+/// when driven by NSXMLParser and both front ends must build the same document. Text
+/// outside the document element is not reported. A numeric reference to a code point
+/// XML does not allow (i.e. a surrogate, or past U+10FFFF) and an attribute given twice
+/// in the same tag are errors, as NSXMLParser has them.
+/// </p>
+///
+/// <p>
+/// Input can be given in pieces: tokenize:length:final:error: stops in front of the
+/// first incomplete token and returns how many bytes were consumed. The caller must
+/// hand the rest back, followed by more input, on the next call (or call dropRest). The
+/// tokenizer remembers how far it looked into the incomplete token, so text, comments,
+/// processing instructions and CDATA sections are not scanned again from their start
+/// when they span many pieces.
+/// </p>
+///
+/// <p>
+/// A tokenizer built for a fragment takes a piece cut out of the middle of a document,
+/// i.e. a run of records: any number of top level elements, with the text between them
+/// reported, and nothing at all is fine too. Elements must still be balanced.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPTokenizer : NSObject
+{
+    ESXPTokenizerCallbacks callbacks;         // The functions to report events to.
+    void                   *context;          // The first argument to the callbacks.
+    ESXPTokenAttribute     *attributes;       // The attributes of the current start tag.
+    NSUInteger             attributeCapacity; // The count of attributes allocated.
+    char                   *names;            // The names of the open elements, one after the other.
+    NSUInteger             namesLength;       // Bytes used for the names of the open elements.
+    NSUInteger             namesCapacity;     // Bytes allocated for the names of the open elements.
+    NSUInteger             *nameStarts;       // The offset of each open element name.
+    NSUInteger             depth;             // The count of open elements.
+    NSUInteger             depthCapacity;     // The count of open elements allocated.
+    BOOL                   seenRoot;          // If the document element was already opened.
+    BOOL                   fragment;          // If the input is a fragment rather than a document.
+    BOOL                   aborted;           // If abort was called.
+    NSUInteger             resumeAt;          // Bytes of the incomplete token already scanned, 0 if none.
+}
+
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param callbacks The functions to report events to.
+/// \param context   The first argument to the callbacks.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPTokenizer *)newBuild:(ESXPTokenizerCallbacks)callbacks context:(void *)context;
+
+/// Builder of new instances for fragments. Follows the Builder Pattern.
+///
+/// \param callbacks The functions to report events to.
+/// \param context   The first argument to the callbacks.
+/// \param fragment  YES if the input is a fragment of a document.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPTokenizer *)newBuild:(ESXPTokenizerCallbacks)callbacks context:(void *)context fragment:(BOOL)fragment;
+
+// MARK: Methods
+/// Tokenizes a buffer.
+///
+/// \param bytes  The buffer.
+/// \param length The count of bytes in the buffer.
+/// \param final  YES if there is no more input after this buffer.
+/// \param error  Set if the XML is not well formed.
+///
+/// \return The count of bytes consumed, or NSNotFound on error.
+- (NSUInteger)tokenize:(const char *)bytes length:(NSUInteger)length final:(BOOL)final error:(NSError **)error;
+
+/// Forgets the incomplete token the last call stopped in front of. Must be called when
+/// the next call does not start with the rest of the last buffer.
+- (void)dropRest;
+
+/// Stops the tokenizer after the current event. Can be called from a callback.
+- (void)abort;
+
+/// Returns YES if abort was called.
+///
+/// \return YES if abort was called.
+- (BOOL)isAborted;
+
+/// Returns the count of open elements.
+///
+/// \return The count of open elements.
+- (NSUInteger)getDepth;
+@end
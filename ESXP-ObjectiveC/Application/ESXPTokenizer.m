@@ -0,0 +1,622 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "ESXPConstants.h"
+#import "ESXPTokenizer.h"
+
+static inline BOOL ESXPIsSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+static inline BOOL ESXPIsNameEnd(char c) { return ESXPIsSpace(c) || c == '/' || c == '>' || c == '='; }
+
+static inline const char *ESXPSkipSpaces(const char *p, const char *end)
+{
+    while (p < end && ESXPIsSpace(*p))
+        p++;
+    
+    return p;
+}
+
+static BOOL ESXPIsBlank(const char *p, NSUInteger length)
+{
+    for (NSUInteger i = 0; i < length; i++)
+        if (!ESXPIsSpace(p[i]))
+            return NO;
+    
+    return YES;
+}
+
+/// Finds a terminator, i.e. "-->", jumping between candidates with memchr.
+///
+/// \return The start of the terminator, or NULL if it is not in the buffer.
+static const char *ESXPFind(const char *p, const char *end, const char *needle, NSUInteger needleLength)
+{
+    while (p + needleLength <= end) {
+        const char *hit = memchr(p, needle[0], (end - p) - needleLength + 1);
+        if (hit == NULL)
+            return NULL;
+        if (memcmp(hit, needle, needleLength) == 0)
+            return hit;
+        
+        p = hit + 1;
+    }
+    
+    return NULL;
+}
+
+/// Returns where to go on looking for a terminator, given how many bytes of the token
+/// were scanned by the last call. A terminator may straddle the end of those bytes.
+///
+/// \return The later of from and the first byte not fully scanned.
+static inline const char *ESXPResume(const char *from, const char *token, NSUInteger scanned, NSUInteger needleLength)
+{
+    if (scanned < needleLength || token + scanned - (needleLength - 1) < from)
+        return from;
+    
+    return token + scanned - (needleLength - 1);
+}
+
+/// Skips a DOCTYPE, including an internal subset.
+///
+/// \return The first byte after the DOCTYPE, or NULL if it is not complete in the buffer.
+static const char *ESXPSkipDoctype(const char *p, const char *end)
+{
+    char quote  = 0;
+    BOOL subset = NO;
+    for (; p < end; p++) {
+        char c = *p;
+        if (quote != 0) {
+            if (c == quote)
+                quote = 0;
+        }
+        else if (c == '"' || c == '\'') {
+            quote = c;
+        }
+        else if (c == '[') {
+            subset = YES;
+        }
+        else if (c == ']') {
+            subset = NO;
+        }
+        else if (c == '>' && !subset) {
+            return p + 1;
+        }
+    }
+    
+    return NULL;
+}
+
+/// Returns YES if a code point is a character XML allows, i.e. not a surrogate.
+static inline BOOL ESXPIsChar(uint32_t c)
+{
+    return c == 0x9 || c == 0xA || c == 0xD || (c >= 0x20 && c <= 0xD7FF) || (c >= 0xE000 && c <= 0xFFFD) || (c >= 0x10000 && c <= 0x10FFFF);
+}
+
+static NSUInteger ESXPEncodeUTF8(uint32_t codePoint, char *out)
+{
+    if (codePoint < 0x80) {
+        out[0] = (char) codePoint;
+        return 1;
+    }
+    else if (codePoint < 0x800) {
+        out[0] = (char) (0xC0 | (codePoint >> 6));
+        out[1] = (char) (0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    else if (codePoint < 0x10000) {
+        out[0] = (char) (0xE0 | (codePoint >> 12));
+        out[1] = (char) (0x80 | ((codePoint >> 6) & 0x3F));
+        out[2] = (char) (0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    else {
+        out[0] = (char) (0xF0 | (codePoint >> 18));
+        out[1] = (char) (0x80 | ((codePoint >> 12) & 0x3F));
+        out[2] = (char) (0x80 | ((codePoint >> 6) & 0x3F));
+        out[3] = (char) (0x80 | (codePoint & 0x3F));
+        return 4;
+    }
+}
+
+/// Resolves the reference between '&' and ';'.
+///
+/// \return YES if the reference is known.
+static BOOL ESXPResolveReference(const char *ref, NSUInteger length, uint32_t *codePoint)
+{
+    if (length == 2 && memcmp(ref, "lt", 2) == 0)
+        *codePoint = '<';
+    else if (length == 2 && memcmp(ref, "gt", 2) == 0)
+        *codePoint = '>';
+    else if (length == 3 && memcmp(ref, "amp", 3) == 0)
+        *codePoint = '&';
+    else if (length == 4 && memcmp(ref, "quot", 4) == 0)
+        *codePoint = '"';
+    else if (length == 4 && memcmp(ref, "apos", 4) == 0)
+        *codePoint = '\'';
+    else if (length > 1 && ref[0] == '#') {
+        BOOL       hex   = (ref[1] == 'x');
+        NSUInteger i     = hex ? 2 : 1;
+        uint32_t   value = 0;
+        if (i == length)
+            return NO;
+        
+        for (; i < length; i++) {
+            char c = ref[i];
+            if (c >= '0' && c <= '9')
+                value = value * (hex ? 16 : 10) + (c - '0');
+            else if (hex && c >= 'a' && c <= 'f')
+                value = value * 16 + (c - 'a' + 10);
+            else if (hex && c >= 'A' && c <= 'F')
+                value = value * 16 + (c - 'A' + 10);
+            else
+                return NO;
+            
+            if (value > 0x10FFFF)
+                return NO;
+        }
+        
+        if (!ESXPIsChar(value))
+            return NO;
+        
+        *codePoint = value;
+    }
+    else
+        return NO;
+    
+    return YES;
+}
+
+/// Checks the character references of a run, which must resolve to characters XML
+/// allows. Other references are kept as they are when decoding.
+///
+/// \return NO if a character reference does not resolve.
+static BOOL ESXPCheckReferences(const char *p, NSUInteger length)
+{
+    const char *end = p + length;
+    while ((p = memchr(p, '&', end - p)) != NULL) {
+        p++;
+        if (p == end || *p != '#')
+            continue;
+        
+        const char *semicolon = memchr(p, ';', end - p);
+        uint32_t   codePoint  = 0;
+        if (semicolon == NULL || !ESXPResolveReference(p, semicolon - p, &codePoint))
+            return NO;
+        
+        p = semicolon + 1;
+    }
+    
+    return YES;
+}
+
+/// Decodes into a buffer at least as long as the input, a decoded run is never longer.
+///
+/// \return The count of bytes written.
+static NSUInteger ESXPDecode(ESXPRange in, char *out, BOOL attribute)
+{
+    const char *src = in.bytes;
+    NSUInteger o    = 0;
+    NSUInteger i    = 0;
+    while (i < in.length) {
+        char c = src[i];
+        if (c == '&') {
+            const char *semicolon = memchr(src + i, ';', in.length - i);
+            uint32_t   codePoint  = 0;
+            if (semicolon != NULL && ESXPResolveReference(src + i + 1, semicolon - (src + i + 1), &codePoint)) {
+                o += ESXPEncodeUTF8(codePoint, out + o);
+                i  = semicolon - src + 1;
+                continue;
+            }
+            
+            // Unknown reference, keep it as it is.
+            out[o++] = c;
+            i++;
+        }
+        else if (c == '\r') {
+            out[o++] = attribute ? ' ' : '\n';
+            i += (i + 1 < in.length && src[i + 1] == '\n') ? 2 : 1;
+        }
+        else if (attribute && (c == '\n' || c == '\t')) {
+            out[o++] = ' ';
+            i++;
+        }
+        else {
+            out[o++] = c;
+            i++;
+        }
+    }
+    
+    return o;
+}
+
+static NSString *ESXPDecodeRange(ESXPRange in, BOOL attribute)
+{
+    char       stackBuffer[256];
+    char       *buffer = in.length <= sizeof(stackBuffer) ? stackBuffer : malloc(in.length);
+    NSUInteger length  = ESXPDecode(in, buffer, attribute);
+    NSString   *string = [[NSString alloc] initWithBytes:buffer length:length encoding:NSUTF8StringEncoding];
+    if (buffer != stackBuffer)
+        free(buffer);
+    
+    return string != nil ? string : @"";
+}
+
+NSString *ESXPDecodeText(ESXPRange text, BOOL escaped)
+{
+    if (!escaped) {
+        NSString *string = [[NSString alloc] initWithBytes:text.bytes length:text.length encoding:NSUTF8StringEncoding];
+        return string != nil ? string : @"";
+    }
+    
+    return ESXPDecodeRange(text, NO);
+}
+
+NSUInteger ESXPDecodeTextBytes(ESXPRange text, BOOL escaped, char *out)
+{
+    if (!escaped) {
+        memcpy(out, text.bytes, text.length);
+        return text.length;
+    }
+    
+    return ESXPDecode(text, out, NO);
+}
+
+NSString *ESXPDecodeAttribute(ESXPRange value)
+{
+    for (NSUInteger i = 0; i < value.length; i++) {
+        char c = value.bytes[i];
+        if (c == '&' || c == '\r' || c == '\n' || c == '\t')
+            return ESXPDecodeRange(value, YES);
+    }
+    
+    return ESXPDecodeText(value, NO);
+}
+
+@implementation ESXPTokenizer
+// MARK: Builders
++ (ESXPTokenizer *)newBuild:(ESXPTokenizerCallbacks)callbacks context:(void *)context { return [ESXPTokenizer newBuild:callbacks context:context fragment:NO]; }
+
++ (ESXPTokenizer *)newBuild:(ESXPTokenizerCallbacks)callbacks context:(void *)context fragment:(BOOL)fragment
+{
+    ESXPTokenizer *instance = [[ESXPTokenizer alloc] init];
+    if (instance) {
+        instance->callbacks         = callbacks;
+        instance->context           = context;
+        instance->fragment          = fragment;
+        instance->attributeCapacity = 16;
+        instance->attributes        = malloc(sizeof(ESXPTokenAttribute) * instance->attributeCapacity);
+        instance->namesCapacity     = 1024;
+        instance->names             = malloc(instance->namesCapacity);
+        instance->depthCapacity     = 64;
+        instance->nameStarts        = malloc(sizeof(NSUInteger) * instance->depthCapacity);
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc
+{
+    free(self->attributes);
+    free(self->names);
+    free(self->nameStarts);
+}
+
+// MARK: Methods
+- (NSUInteger)tokenize:(const char *)bytes length:(NSUInteger)length final:(BOOL)final error:(NSError **)error
+{
+    const char *start = bytes;
+    const char *p     = bytes;
+    const char *end   = bytes + length;
+    NSUInteger resume = MIN(self->resumeAt, length); // Bytes of the first token already scanned.
+    self->resumeAt = 0;
+    
+    // Skip the byte order mark.
+    if (!self->seenRoot && !self->fragment && length >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+        p += 3;
+    
+    while (p < end && !self->aborted) {
+        // Text.
+        if (*p != '<') {
+            const char *lt = (resume < (NSUInteger) (end - p)) ? memchr(p + resume, '<', end - p - resume) : NULL;
+            if (lt == NULL) {
+                if (!final) {
+                    self->resumeAt = end - p;
+                    break; // The text may go on in the next buffer.
+                }
+                
+                lt = end;
+            }
+            
+            NSUInteger textLength = lt - p;
+            if (self->depth > 0 || self->fragment) {
+                BOOL reference = memchr(p, '&', textLength) != NULL;
+                if (reference && !ESXPCheckReferences(p, textLength))
+                    return [self fail:@"Invalid character reference" at:p - start error:error];
+                
+                BOOL escaped = reference || memchr(p, '\r', textLength) != NULL;
+                self->callbacks.characters(self->context, (ESXPRange) { p, textLength }, escaped);
+            }
+            else if (!ESXPIsBlank(p, textLength)) {
+                return [self fail:@"Content outside of the document element" at:p - start error:error];
+            }
+            
+            p      = lt;
+            resume = 0;
+            continue;
+        }
+        
+        // Markup.
+        const char *next      = NULL; // The first byte after the token, NULL if it is not complete.
+        NSString   *malformed = nil;  // Why the token is not well formed, nil if it is.
+        NSUInteger available  = end - p;
+        if (available < 2) {
+            next = NULL;
+        }
+        else if (p[1] == '?') {
+            const char *t = ESXPFind(ESXPResume(p + 2, p, resume, 2), end, "?>", 2);
+            next = (t != NULL) ? t + 2 : NULL;
+        }
+        else if (p[1] == '!') {
+            if (available >= 4 && memcmp(p, "<!--", 4) == 0) {
+                const char *t = ESXPFind(ESXPResume(p + 4, p, resume, 3), end, "-->", 3);
+                next = (t != NULL) ? t + 3 : NULL;
+            }
+            else if (available >= 9 && memcmp(p, "<![CDATA[", 9) == 0) {
+                const char *t = ESXPFind(ESXPResume(p + 9, p, resume, 3), end, "]]>", 3);
+                next = (t != NULL) ? t + 3 : NULL;
+            }
+            else if (available >= 9 && memcmp(p, "<!DOCTYPE", 9) == 0) {
+                next = ESXPSkipDoctype(p + 9, end);
+            }
+            else if (available >= 9) {
+                malformed = @"Malformed markup";
+            }
+        }
+        else if (p[1] == '/') {
+            next = [self endTag:p end:end malformed:&malformed];
+        }
+        else {
+            next = [self startTag:p end:end malformed:&malformed];
+        }
+        
+        if (malformed != nil)
+            return [self fail:malformed at:p - start error:error];
+        
+        if (next == NULL) {
+            if (!final) {
+                self->resumeAt = end - p;
+                break; // The token may be completed by the next buffer.
+            }
+            
+            return [self fail:@"Unexpected end of document" at:p - start error:error];
+        }
+        
+        p      = next;
+        resume = 0;
+    }
+    
+    if (final && !self->aborted) {
+        if (!self->seenRoot && !self->fragment)
+            return [self fail:@"Document is empty" at:p - start error:error];
+        if (self->depth > 0)
+            return [self fail:@"Unclosed element" at:p - start error:error];
+    }
+    
+    return p - start;
+}
+
+- (void)dropRest { self->resumeAt = 0; }
+
+- (void)abort { self->aborted = YES; }
+
+- (BOOL)isAborted { return self->aborted; }
+
+- (NSUInteger)getDepth { return self->depth; }
+
+// MARK: Private Methods
+- (const char *)startTag:(const char *)p end:(const char *)end malformed:(NSString **)malformed
+{
+    // Name.
+    const char *q         = p + 1;
+    const char *nameStart = q;
+    while (q < end && !ESXPIsNameEnd(*q))
+        q++;
+    if (q == end)
+        return NULL;
+    if (q == nameStart) {
+        *malformed = @"Malformed markup";
+        return NULL;
+    }
+    
+    ESXPRange  name        = { nameStart, q - nameStart };
+    NSUInteger count       = 0;
+    BOOL       selfClosing = NO;
+    
+    // Attributes.
+    for (;;) {
+        q = ESXPSkipSpaces(q, end);
+        if (q == end)
+            return NULL;
+        
+        if (*q == '>') {
+            q++;
+            break;
+        }
+        
+        if (*q == '/') {
+            if (q + 1 == end)
+                return NULL;
+            if (q[1] != '>') {
+                *malformed = @"Malformed markup";
+                return NULL;
+            }
+            
+            q          += 2;
+            selfClosing = YES;
+            break;
+        }
+        
+        const char *attributeStart = q;
+        while (q < end && !ESXPIsNameEnd(*q))
+            q++;
+        if (q == end)
+            return NULL;
+        if (q == attributeStart) {
+            *malformed = @"Malformed markup";
+            return NULL;
+        }
+        
+        ESXPRange attributeName = { attributeStart, q - attributeStart };
+        q = ESXPSkipSpaces(q, end);
+        if (q == end)
+            return NULL;
+        if (*q != '=') {
+            *malformed = @"Malformed markup";
+            return NULL;
+        }
+        
+        q = ESXPSkipSpaces(q + 1, end);
+        if (q == end)
+            return NULL;
+        
+        char quote = *q;
+        if (quote != '"' && quote != '\'') {
+            *malformed = @"Malformed markup";
+            return NULL;
+        }
+        
+        const char *valueEnd = memchr(q + 1, quote, end - (q + 1));
+        if (valueEnd == NULL)
+            return NULL;
+        
+        ESXPRange value = { q + 1, valueEnd - (q + 1) };
+        if (memchr(value.bytes, '&', value.length) != NULL && !ESXPCheckReferences(value.bytes, value.length)) {
+            *malformed = @"Invalid character reference";
+            return NULL;
+        }
+        
+        for (NSUInteger i = 0; i < count; i++) {
+            ESXPRange other = self->attributes[i].name;
+            if (other.length == attributeName.length && memcmp(other.bytes, attributeName.bytes, attributeName.length) == 0) {
+                *malformed = @"Duplicate attribute";
+                return NULL;
+            }
+        }
+        
+        if (count == self->attributeCapacity) {
+            self->attributeCapacity *= 2;
+            self->attributes         = realloc(self->attributes, sizeof(ESXPTokenAttribute) * self->attributeCapacity);
+        }
+        self->attributes[count++] = (ESXPTokenAttribute) { attributeName, value };
+        q = valueEnd + 1;
+    }
+    
+    // Only one document element.
+    if (self->depth == 0 && self->seenRoot && !self->fragment) {
+        *malformed = @"Malformed markup";
+        return NULL;
+    }
+    
+    [self pushName:name];
+    self->callbacks.startElement(self->context, name, self->attributes, count);
+    if (selfClosing) {
+        [self popName];
+        self->callbacks.endElement(self->context, name);
+    }
+    
+    return q;
+}
+
+- (const char *)endTag:(const char *)p end:(const char *)end malformed:(NSString **)malformed
+{
+    const char *q         = p + 2;
+    const char *nameStart = q;
+    while (q < end && !ESXPIsNameEnd(*q))
+        q++;
+    
+    ESXPRange name = { nameStart, q - nameStart };
+    q = ESXPSkipSpaces(q, end);
+    if (q == end)
+        return NULL;
+    
+    // Must close the last open element.
+    if (*q != '>' || self->depth == 0) {
+        *malformed = @"Malformed markup";
+        return NULL;
+    }
+    
+    NSUInteger top = self->nameStarts[self->depth - 1];
+    if (self->namesLength - top != name.length || memcmp(self->names + top, name.bytes, name.length) != 0) {
+        *malformed = @"Malformed markup";
+        return NULL;
+    }
+    
+    [self popName];
+    self->callbacks.endElement(self->context, name);
+    
+    return q + 1;
+}
+
+- (void)pushName:(ESXPRange)name
+{
+    if (self->depth == self->depthCapacity) {
+        self->depthCapacity *= 2;
+        self->nameStarts     = realloc(self->nameStarts, sizeof(NSUInteger) * self->depthCapacity);
+    }
+    
+    if (self->namesLength + name.length > self->namesCapacity) {
+        self->namesCapacity = MAX(self->namesCapacity * 2, self->namesLength + name.length);
+        self->names         = realloc(self->names, self->namesCapacity);
+    }
+    
+    memcpy(self->names + self->namesLength, name.bytes, name.length);
+    self->nameStarts[self->depth++] = self->namesLength;
+    self->namesLength              += name.length;
+    self->seenRoot                  = YES;
+}
+
+- (void)popName
+{
+    self->depth--;
+    self->namesLength = self->nameStarts[self->depth];
+}
+
+- (NSUInteger)fail:(NSString *)reason at:(NSUInteger)offset error:(NSError **)error
+{
+    if (error != NULL) {
+        NSString     *domain   = @"net.apkc.projects.ErrorDomain";
+        NSString     *desc     = [NSString stringWithFormat:@"%@ at byte %lu.", reason, (unsigned long) offset];
+        NSDictionary *userInfo = @{ NSLocalizedDescriptionKey : desc };
+        *error = [NSError errorWithDomain:domain code:XMLPARSER_MALFORMED_XML userInfo:userInfo];
+    }
+    
+    if (kDEBUG)
+        NSLog(@"TOKENIZER:error ==> %@ at byte %lu", reason, (unsigned long) offset);
+    
+    return NSNotFound;
+}
+@end
@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+#import <stdio.h>
+#import <sys/resource.h>
+#import <time.h>
+#import "ESXPArenaDocument.h"
+#import "ESXPBinding.h"
+#import "ESXPConstants.h"
+#import "ESXPDumpGenerator.h"
+#import "ESXPFieldSet.h"
+#import "ESXPProcessor.h"
+#import "ESXPProjection.h"
+#import "ESXPSAX2Arena.h"
+#import "ESXPSAX2DOM.h"
+#import "ESXPWikiPage.h"
+
+// Command line benchmark of parsing and processing MediaWiki dumps.
+//
+// Writing a dump:
+//     esxp-benchmark -generate dump.xml -size 64M [-seed 1]
+// Measuring one parsing mode on it:
+//     esxp-benchmark -input dump.xml [-mode native] [-repeat 3] [-threads 4]
+//
+// Every measurement is printed to the standard output as one JSON object per line. The
+// peak RSS is the one of the whole process, so each run measures a single mode.
+
+static NSArray *ESXPModes(void)
+{
+    return @[ @"nsxmlparser", @"native", @"lazy", @"coalesce", @"parallel", @"projected", @"arena", @"snapshot", @"streaming", @"compressed" ];
+}
+
+static double ESXPNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/// Returns the peak resident set size of the process, in KiB.
+static uint64_t ESXPPeakRSS(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return (uint64_t) usage.ru_maxrss / 1024; // Bytes on Darwin.
+#else
+    return (uint64_t) usage.ru_maxrss;
+#endif
+}
+
+/// Parses sizes such as 1048576, 512K, 64M or 4G, in powers of 1024.
+static uint64_t ESXPParseSize(NSString *size)
+{
+    uint64_t value  = strtoull([size UTF8String], NULL, 10);
+    unichar  suffix = [size length] > 0 ? [[size uppercaseString] characterAtIndex:[size length] - 1] : 0;
+    switch (suffix) {
+        case 'G': return value << 30;
+        case 'M': return value << 20;
+        case 'K': return value << 10;
+        default:  return value;
+    }
+}
+
+static void ESXPReport(NSDictionary *result)
+{
+    NSData *json = [NSJSONSerialization dataWithJSONObject:result options:0 error:NULL];
+    fwrite([json bytes], 1, [json length], stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+static int ESXPFail(NSString *what, NSError *error)
+{
+    fprintf(stderr, "esxp-benchmark: %s: %s\n", [what UTF8String], [[error description] UTF8String]);
+    return 1;
+}
+
+/// The mapping of ESXPProcessorTest, binding every field of a page.
+static ESXPBinding *ESXPWikiBinding(void)
+{
+    ESXPBinding *binding = [ESXPBinding newBuild:[ESXPWikiPage class]];
+    [binding bindProperty:@"_title" name:@"title" parent:@"page" attribute:nil];
+    [binding bindProperty:@"_ns" name:@"ns" parent:@"page" attribute:nil];
+    [binding bindProperty:@"_id" name:@"id" parent:@"page" attribute:nil];
+    [binding bindProperty:@"_revId" name:@"id" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revParentId" name:@"parentid" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revTimestamp" name:@"timestamp" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revContributorUsername" name:@"username" parent:@"contributor" attribute:nil];
+    [binding bindProperty:@"_revContributorId" name:@"id" parent:@"contributor" attribute:nil];
+    [binding bindProperty:@"_revMinor" name:@"minor" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revComment" name:@"comment" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revText" name:@"text" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revTextId" name:@"text" parent:@"revision" attribute:@"id"];
+    [binding bindProperty:@"_revTextBytes" name:@"text" parent:@"revision" attribute:@"bytes"];
+    [binding bindProperty:@"_revSHA1" name:@"sha1" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revModel" name:@"model" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revFormat" name:@"format" parent:@"revision" attribute:nil];
+    return binding;
+}
+
+/// Parses a dump in one of the modes. Streaming binds the pages as they are parsed and
+/// leaves no document, only the count of pages.
+static BOOL ESXPParse(NSString *mode, NSString *input, NSUInteger maxNodes, NSUInteger threads, ESXPDocument **doc, uint64_t *pages, NSError **error)
+{
+    *doc = nil;
+    if ([mode isEqualToString:@"arena"]) {
+        NSData        *data   = [NSData dataWithContentsOfFile:input options:NSDataReadingMappedIfSafe error:error];
+        NSXMLParser   *parser = [[NSXMLParser alloc] initWithData:data];
+        ESXPSAX2Arena *arena  = [ESXPSAX2Arena newBuild:maxNodes];
+        [parser setDelegate:arena];
+        if (data == nil || ![parser parse]) {
+            if (error != NULL && data != nil)
+                *error = [parser parserError];
+            return NO;
+        }
+        *doc = [arena getDOM];
+        return YES;
+    }
+    
+    if ([mode isEqualToString:@"snapshot"]) {
+        *doc = [ESXPArenaDocument newBuildFromSnapshot:[input stringByAppendingPathExtension:@"esxp"] error:error];
+        return *doc != nil;
+    }
+    
+    // Compressed streams the gzip copy of the dump, decompressed while it is parsed.
+    if ([mode isEqualToString:@"streaming"] || [mode isEqualToString:@"compressed"]) {
+        __block uint64_t count   = 0;
+        ESXPSAX2DOM      *builder = [ESXPSAX2DOM newBuild:1000 recordName:@"page" recordHandler:[ESXPWikiBinding() recordHandler:^(id object, BOOL *stop) {
+            count++;
+        }]];
+        BOOL parsed = [mode isEqualToString:@"compressed"]
+            ? [builder parseCompressedFile:[input stringByAppendingPathExtension:@"gz"] error:error]
+            : [builder parseFile:input frontEnd:FRONTEND_NATIVE error:error];
+        if (!parsed)
+            return NO;
+        *pages = count;
+        return YES;
+    }
+    
+    ESXPSAX2DOM *builder = [ESXPSAX2DOM newBuild:maxNodes];
+    BOOL        parsed   = NO;
+    if ([mode isEqualToString:@"parallel"]) {
+        parsed = [builder parseFile:input splitAt:@"page" threads:threads error:error];
+    }
+    else {
+        // Projected keeps what the queries below ask for, but not the revision text.
+        if ([mode isEqualToString:@"projected"])
+            builder.projection = [ESXPProjection newBuild:@[ @"page/title", @"page/id", @"revision/id", @"/mediawiki/logitem" ]];
+        builder.lazyValues       = [mode isEqualToString:@"lazy"];
+        builder.coalesceText     = [mode isEqualToString:@"coalesce"];
+        builder.ignoreWhitespace = [mode isEqualToString:@"coalesce"];
+        parsed = [builder parseFile:input frontEnd:[mode isEqualToString:@"nsxmlparser"] ? FRONTEND_NSXMLPARSER : FRONTEND_NATIVE error:error];
+    }
+    
+    *doc = parsed ? [builder getDOM] : nil;
+    return parsed;
+}
+
+/// Runs a query many times and reports the fastest, median and slowest run.
+static void ESXPTimeQuery(NSString *mode, NSString *name, NSUInteger repeat, id (^query)(void))
+{
+    NSMutableArray *times = [NSMutableArray new];
+    NSUInteger     count  = 0;
+    for (NSUInteger i = 0; i < repeat; i++) {
+        @autoreleasepool {
+            double start  = ESXPNow();
+            id     result = query();
+            [times addObject:@((ESXPNow() - start) * 1e6)];
+            count = [result respondsToSelector:@selector(count)] ? [result count] : (result != nil);
+        }
+    }
+    [times sortUsingSelector:@selector(compare:)];
+    
+    ESXPReport(@{ @"benchmark"   : @"query",
+                  @"mode"        : mode,
+                  @"query"       : name,
+                  @"repeat"      : @(repeat),
+                  @"results"     : @(count),
+                  @"min_us"      : [times firstObject],
+                  @"median_us"   : [times objectAtIndex:[times count] / 2],
+                  @"max_us"      : [times lastObject] });
+}
+
+static void ESXPQueries(NSString *mode, ESXPDocument *doc, NSUInteger maxNodes, NSUInteger repeat, NSUInteger threads)
+{
+    ESXPProcessor *processor = [ESXPProcessor newBuild:maxNodes];
+    ESXPNameTable *nameTable = [doc getNameTable];
+    ESXPQuery     *pages     = [processor compileQuery:@"/mediawiki/page"];
+    ESXPQuery     *revisions = [processor compileQuery:@"revision/id"];
+    ESXPFieldSet  *fields    = [ESXPFieldSet newBuild];
+    [fields addField:@"title" parent:@"page" attribute:nil];
+    [fields addField:@"id" parent:@"revision" attribute:nil];
+    [fields addField:@"text" parent:@"revision" attribute:@"bytes"];
+    
+    double start = ESXPNow();
+    [doc freeze];
+    ESXPReport(@{ @"benchmark" : @"freeze", @"mode" : mode, @"seconds" : @(ESXPNow() - start) });
+    
+    NSArray *records = [processor queryNodes:pages document:doc];
+    
+    // The logitem comes after every page, so searching for it walks the whole tree.
+    ESXPTimeQuery(mode, @"searchTagValue", repeat, ^id {
+        return [processor searchTagValue:doc rootNodeName:@"mediawiki" tagName:@"action" strict:NO];
+    });
+    ESXPTimeQuery(mode, @"searchTagAttributeValue", repeat, ^id {
+        return [processor searchTagAttributeValue:doc rootNodeName:@"mediawiki" tagName:@"text" attributeName:@"bytes" strict:NO];
+    });
+    ESXPTimeQuery(mode, @"searchNode", repeat, ^id {
+        return [processor searchNode:doc rootNodeName:@"mediawiki" tagName:@"logitem"];
+    });
+    ESXPTimeQuery(mode, @"queryNodes", repeat, ^id {
+        return [processor queryNodes:pages document:doc];
+    });
+    ESXPTimeQuery(mode, @"queryValue", repeat, ^id {
+        NSMutableArray *values = [NSMutableArray arrayWithCapacity:[records count]];
+        for (id<ESXPNode> record in records)
+            [values addObject:[processor queryValue:revisions node:record nameTable:nameTable strict:NO]];
+        return values;
+    });
+    ESXPTimeQuery(mode, @"extractFields", repeat, ^id {
+        NSMutableArray *values = [NSMutableArray arrayWithCapacity:[records count]];
+        for (id<ESXPNode> record in records)
+            [values addObject:[processor extractFields:fields node:record nameTable:nameTable]];
+        return values;
+    });
+    ESXPTimeQuery(mode, @"searchNodes:threads", repeat, ^id {
+        return [processor searchNodes:doc tagName:@"page" threads:threads];
+    });
+    ESXPTimeQuery(mode, @"queryValues:threads", repeat, ^id {
+        return [processor queryValues:revisions nodes:records document:doc threads:threads];
+    });
+    ESXPTimeQuery(mode, @"extractFields:threads", repeat, ^id {
+        return [processor extractFields:fields nodes:records document:doc threads:threads];
+    });
+    
+    ESXPBinding *binding = ESXPWikiBinding();
+    start = ESXPNow();
+    NSUInteger count = [[binding bindAll:doc recordName:@"page"] count];
+    ESXPReport(@{ @"benchmark" : @"extraction", @"mode" : mode, @"pages" : @(count), @"seconds" : @(ESXPNow() - start), @"peak_rss_kib" : @(ESXPPeakRSS()) });
+}
+
+int main(int argc, const char *argv[])
+{
+    @autoreleasepool {
+        NSUserDefaults *arguments = [NSUserDefaults standardUserDefaults];
+        NSString       *generate  = [arguments stringForKey:@"generate"];
+        NSString       *input     = [arguments stringForKey:@"input"];
+        NSString       *mode      = [arguments stringForKey:@"mode"] ?: @"native";
+        NSUInteger     repeat     = [arguments integerForKey:@"repeat"] > 0 ? (NSUInteger) [arguments integerForKey:@"repeat"] : 3;
+        NSUInteger     threads    = [arguments integerForKey:@"threads"] > 0 ? (NSUInteger) [arguments integerForKey:@"threads"] : 4;
+        NSError        *error     = nil;
+        
+        if (generate != nil) {
+            uint64_t          size       = ESXPParseSize([arguments stringForKey:@"size"] ?: @"64M");
+            uint64_t          seed       = [arguments objectForKey:@"seed"] ? (uint64_t) [arguments integerForKey:@"seed"] : 1;
+            ESXPDumpGenerator *generator = [ESXPDumpGenerator newBuild:seed];
+            double            start      = ESXPNow();
+            if (![generator writeFile:generate size:size error:&error])
+                return ESXPFail(generate, error);
+            
+            ESXPReport(@{ @"benchmark" : @"generate",
+                          @"output"    : generate,
+                          @"seed"      : @(seed),
+                          @"bytes"     : [[[NSFileManager defaultManager] attributesOfItemAtPath:generate error:NULL] objectForKey:NSFileSize],
+                          @"pages"     : @([generator getPageCount]),
+                          @"seconds"   : @(ESXPNow() - start) });
+            return 0;
+        }
+        
+        if (input == nil || ![ESXPModes() containsObject:mode]) {
+            fprintf(stderr,
+                    "usage: esxp-benchmark -generate <file> [-size 64M] [-seed 1]\n"
+                    "       esxp-benchmark -input <file> [-mode native] [-repeat 3] [-threads 4]\n"
+                    "modes: %s\n", [[ESXPModes() componentsJoinedByString:@" "] UTF8String]);
+            return 1;
+        }
+        
+        NSNumber   *bytes   = [[[NSFileManager defaultManager] attributesOfItemAtPath:input error:&error] objectForKey:NSFileSize];
+        NSUInteger maxNodes = (NSUInteger) ([bytes unsignedLongLongValue] / 64) + 1000; // About one node per 64 bytes of dump.
+        if (bytes == nil)
+            return ESXPFail(input, error);
+        
+        // The snapshot is written once and reused by later runs.
+        NSString *snapshot = [input stringByAppendingPathExtension:@"esxp"];
+        if ([mode isEqualToString:@"snapshot"] && ![[NSFileManager defaultManager] fileExistsAtPath:snapshot]) {
+            @autoreleasepool {
+                ESXPDocument *built = nil;
+                if (!ESXPParse(@"native", input, maxNodes, threads, &built, NULL, &error) || ![built writeSnapshot:snapshot error:&error])
+                    return ESXPFail(snapshot, error);
+            }
+        }
+        
+        ESXPDocument *doc = nil;
+        for (NSUInteger run = 0; run < repeat; run++) {
+            doc = nil; // Drop the last document before building the next one.
+            @autoreleasepool {
+                uint64_t pages   = 0;
+                double   start   = ESXPNow();
+                BOOL     parsed  = ESXPParse(mode, input, maxNodes, threads, &doc, &pages, &error);
+                double   seconds = ESXPNow() - start;
+                if (!parsed)
+                    return ESXPFail(input, error);
+                
+                ESXPReport(@{ @"benchmark"      : @"parse",
+                              @"mode"           : mode,
+                              @"input"          : input,
+                              @"bytes"          : bytes,
+                              @"run"            : @(run),
+                              @"seconds"        : @(seconds),
+                              @"mib_per_second" : @([bytes doubleValue] / (1 << 20) / seconds),
+                              @"element_nodes"  : @(doc ? [doc getElementNodeCount] : 0),
+                              @"pages"          : @(pages),
+                              @"peak_rss_kib"   : @(ESXPPeakRSS()) });
+            }
+        }
+        
+        if (doc != nil)
+            ESXPQueries(mode, doc, maxNodes, repeat, threads);
+    }
+    return 0;
+}
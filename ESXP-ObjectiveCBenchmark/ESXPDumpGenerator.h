@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <Foundation/Foundation.h>
+
+/// Writes synthetic MediaWiki dumps for benchmarking.
+///
+/// <p>
+/// The dumps follow the export format of test.xsd and fill every field of ESXPWikiPage: a
+/// siteinfo block, pages with one revision each and a logitem at the very end, so that
+/// searches for it walk the whole tree. Titles, comments and texts are drawn from small
+/// word lists with a seeded generator, mixing in entities and non ASCII text. The same
+/// seed and size always give the same bytes.
+/// </p>
+///
+/// \author Andreas P. Koenzen <akc at apkc.net>
+/// \see    Builder Pattern
+@interface ESXPDumpGenerator : NSObject
+// MARK: Builders
+/// Builder of new instances. Follows the Builder Pattern.
+///
+/// \param seed The seed of the generator.
+///
+/// \return A new instance of this class or nil if any problem.
++ (ESXPDumpGenerator *)newBuild:(uint64_t)seed;
+
+// MARK: Methods
+/// Writes a dump. Pages are added until the file reaches the size, so it ends up at most
+/// one page and the closing elements bigger.
+///
+/// \param path  The file to write, replaced if it exists.
+/// \param size  The size of the file, in bytes.
+/// \param error Set if the file can not be written.
+///
+/// \return YES if the dump was written.
+- (BOOL)writeFile:(NSString *)path size:(uint64_t)size error:(NSError **)error;
+
+/// Returns the count of pages of the last dump written.
+///
+/// \return The count of pages.
+- (uint64_t)getPageCount;
+@end
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2014, Andreas P. Koenzen <akc at apkc.net>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import <errno.h>
+#import <stdio.h>
+#import <time.h>
+#import "ESXPDumpGenerator.h"
+
+/// A word of the generated text: its bytes in the file and its length once the entities
+/// are decoded, which is what the bytes attribute of a text counts.
+typedef struct ESXPDumpWord
+{
+    const char *raw;
+    NSUInteger length;
+} ESXPDumpWord;
+
+static ESXPDumpWord const kWORDS[] = {
+    { "the", 3 }, { "of", 2 }, { "and", 3 }, { "in", 2 }, { "was", 3 }, { "is", 2 },
+    { "river", 5 }, { "city", 4 }, { "county", 6 }, { "history", 7 }, { "population", 10 },
+    { "railway", 7 }, { "station", 7 }, { "album", 5 }, { "released", 8 }, { "species", 7 },
+    { "footballer", 10 }, { "church", 6 }, { "village", 7 }, { "census", 6 },
+    { "Zürich", 7 }, { "café", 5 }, { "São Paulo", 10 }, { "東京", 6 }, { "Ελλάδα", 12 },
+    { "[[United States]]", 17 }, { "[[Category:Living people]]", 26 }, { "'''bold'''", 10 },
+    { "{{Infobox settlement", 20 }, { "| name = x}}", 12 }, { "== History ==\n", 14 },
+    { "&lt;ref&gt;", 5 }, { "&lt;/ref&gt;", 6 }, { "&quot;quoted&quot;", 8 }, { "A &amp; B", 5 },
+};
+static NSUInteger const kWORD_COUNT = sizeof(kWORDS) / sizeof(kWORDS[0]);
+
+static const char *const kUSERS[] = { "Rambot", "Koavf", "BD2412", "Ser Amantio di Nicolao", "Bearcat", "Jürgen", "Ohconfucius" };
+static NSUInteger const kUSER_COUNT = sizeof(kUSERS) / sizeof(kUSERS[0]);
+
+static NSUInteger const kNAMESPACES[] = { 0, 0, 0, 0, 0, 1, 2, 4, 10, 14 };
+static NSUInteger const kNAMESPACE_COUNT = sizeof(kNAMESPACES) / sizeof(kNAMESPACES[0]);
+
+static time_t const kFIRST_TIMESTAMP = 979516800; // 2001-01-15T00:00:00Z, the first edit.
+
+@interface ESXPDumpGenerator ()
+{
+    uint64_t state;     // The state of the xorshift generator.
+    uint64_t pageCount; // The count of pages of the last dump.
+    char     *text;     // The text of the page being written.
+    size_t   capacity;  // The bytes allocated for the text.
+}
+@end
+
+@implementation ESXPDumpGenerator
+// MARK: Builders
++ (ESXPDumpGenerator *)newBuild:(uint64_t)seed
+{
+    ESXPDumpGenerator *instance = [[ESXPDumpGenerator alloc] init];
+    if (instance) {
+        instance->state     = seed ? seed : 0x9E3779B97F4A7C15ULL; // Zero would stay zero.
+        instance->pageCount = 0;
+        instance->capacity  = 16 * 1024;
+        instance->text      = malloc(instance->capacity);
+        return instance;
+    }
+    else {
+        return nil;
+    }
+}
+
+- (void)dealloc { free(self->text); }
+
+// MARK: Methods
+- (BOOL)writeFile:(NSString *)path size:(uint64_t)size error:(NSError **)error
+{
+    FILE *file = fopen([path fileSystemRepresentation], "w");
+    if (file == NULL) {
+        if (error != NULL)
+            *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{ NSFilePathErrorKey : path }];
+        return NO;
+    }
+    setvbuf(file, NULL, _IOFBF, 1024 * 1024);
+    
+    fputs("<mediawiki xmlns=\"http://www.mediawiki.org/xml/export-0.8/\" "
+          "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
+          "xsi:schemaLocation=\"http://www.mediawiki.org/xml/export-0.8/ http://www.mediawiki.org/xml/export-0.8.xsd\" "
+          "version=\"0.8\" xml:lang=\"en\">\n"
+          "  <siteinfo>\n"
+          "    <sitename>Wikipedia</sitename>\n"
+          "    <base>http://en.wikipedia.org/wiki/Main_Page</base>\n"
+          "    <generator>MediaWiki 1.22wmf2</generator>\n"
+          "    <case>first-letter</case>\n"
+          "    <namespaces>\n"
+          "      <namespace key=\"0\" case=\"first-letter\" />\n"
+          "      <namespace key=\"1\" case=\"first-letter\">Talk</namespace>\n"
+          "      <namespace key=\"2\" case=\"first-letter\">User</namespace>\n"
+          "    </namespaces>\n"
+          "  </siteinfo>\n", file);
+    
+    self->pageCount = 0;
+    while ((uint64_t) ftello(file) < size && !ferror(file))
+        [self writePage:file];
+    
+    fprintf(file,
+            "  <logitem>\n"
+            "    <id>%llu</id>\n"
+            "    <timestamp>2013-05-01T00:00:00Z</timestamp>\n"
+            "    <contributor>\n"
+            "      <username>%s</username>\n"
+            "      <id>1</id>\n"
+            "    </contributor>\n"
+            "    <type>delete</type>\n"
+            "    <action>delete</action>\n"
+            "    <logtitle>Page %llu</logtitle>\n"
+            "  </logitem>\n"
+            "</mediawiki>\n",
+            (unsigned long long) self->pageCount + 1, kUSERS[0], (unsigned long long) self->pageCount);
+    
+    BOOL failed = ferror(file) != 0;
+    int  cause  = errno;
+    if (fclose(file) != 0 || failed) {
+        if (error != NULL)
+            *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:cause userInfo:@{ NSFilePathErrorKey : path }];
+        return NO;
+    }
+    
+    return YES;
+}
+
+- (uint64_t)getPageCount { return self->pageCount; }
+
+// MARK: Private Methods
+/// Returns the next number of the generator (xorshift64*).
+- (uint64_t)next
+{
+    self->state ^= self->state >> 12;
+    self->state ^= self->state << 25;
+    self->state ^= self->state >> 27;
+    return self->state * 0x2545F4914F6CDD1DULL;
+}
+
+- (const ESXPDumpWord *)nextWord { return &kWORDS[[self next] % kWORD_COUNT]; }
+
+- (void)writePage:(FILE *)file
+{
+    uint64_t page     = ++self->pageCount;
+    uint64_t revision = 100000 + page * 7;
+    
+    // Titles and comments skip the words with markup.
+    const ESXPDumpWord *first  = &kWORDS[[self next] % 25];
+    const ESXPDumpWord *second = &kWORDS[[self next] % 25];
+    fprintf(file,
+            "  <page>\n"
+            "    <title>%s %s %llu</title>\n"
+            "    <ns>%lu</ns>\n"
+            "    <id>%llu</id>\n"
+            "    <revision>\n"
+            "      <id>%llu</id>\n",
+            first->raw, second->raw, (unsigned long long) page,
+            (unsigned long) kNAMESPACES[[self next] % kNAMESPACE_COUNT],
+            (unsigned long long) page,
+            (unsigned long long) revision);
+    
+    if ([self next] % 4 != 0)
+        fprintf(file, "      <parentid>%llu</parentid>\n", (unsigned long long) (revision - 1 - [self next] % 1000));
+    
+    char      timestamp[32];
+    struct tm when;
+    time_t    seconds = kFIRST_TIMESTAMP + (time_t) ((page * 613) % 400000000 + [self next] % 600);
+    gmtime_r(&seconds, &when);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &when);
+    fprintf(file, "      <timestamp>%s</timestamp>\n", timestamp);
+    
+    if ([self next] % 5 != 0)
+        fprintf(file,
+                "      <contributor>\n"
+                "        <username>%s</username>\n"
+                "        <id>%llu</id>\n"
+                "      </contributor>\n",
+                kUSERS[[self next] % kUSER_COUNT], (unsigned long long) ([self next] % 20000000));
+    else
+        fprintf(file,
+                "      <contributor>\n"
+                "        <ip>%u.%u.%u.%u</ip>\n"
+                "      </contributor>\n",
+                (unsigned) ([self next] % 223 + 1), (unsigned) ([self next] % 256), (unsigned) ([self next] % 256), (unsigned) ([self next] % 256));
+    
+    if ([self next] % 3 == 0)
+        fputs("      <minor />\n", file);
+    
+    if ([self next] % 2 == 0)
+        fprintf(file, "      <comment>%s %s &amp; %s</comment>\n", [self nextWord]->raw, first->raw, second->raw);
+    
+    // Most texts are short, a few are long, as in the real dumps.
+    NSUInteger target = (NSUInteger) (64 << ([self next] % 8)) + [self next] % 256;
+    NSUInteger length = 0;
+    size_t     used   = 0;
+    while (length < target) {
+        const ESXPDumpWord *word = [self nextWord];
+        size_t             bytes = strlen(word->raw);
+        if (used + bytes + 2 > self->capacity) {
+            self->capacity *= 2;
+            self->text      = realloc(self->text, self->capacity);
+        }
+        
+        memcpy(self->text + used, word->raw, bytes);
+        used   += bytes;
+        length += word->length;
+        self->text[used++] = ' ';
+        length++;
+    }
+    
+    char sha1[32];
+    for (NSUInteger i = 0; i < 31; i++)
+        sha1[i] = "0123456789abcdefghijklmnopqrstuvwxyz"[[self next] % 36];
+    sha1[31] = '\0';
+    
+    fprintf(file, "      <text xml:space=\"preserve\" id=\"%llu\" bytes=\"%lu\">", (unsigned long long) (revision + 3), (unsigned long) length);
+    fwrite(self->text, 1, used, file);
+    fprintf(file,
+            "</text>\n"
+            "      <sha1>%s</sha1>\n"
+            "      <model>wikitext</model>\n"
+            "      <format>text/x-wiki</format>\n"
+            "    </revision>\n"
+            "  </page>\n",
+            sha1);
+}
+@end
@@ -0,0 +1,27 @@
+#!/bin/sh
+#
+# Generates dumps of the given sizes (1M 16M 256M by default) and runs every parsing mode
+# on each, appending the results to results.jsonl. Dumps are kept between runs.
+#
+#     ./run.sh 1M 64M 1G
+#
+set -e
+
+BENCHMARK=./obj/esxp-benchmark
+DUMPS=${DUMPS:-dumps}
+RESULTS=${RESULTS:-results.jsonl}
+REPEAT=${REPEAT:-3}
+THREADS=${THREADS:-4}
+MODES=${MODES:-"nsxmlparser native lazy coalesce parallel projected arena snapshot streaming compressed"}
+
+[ $# -gt 0 ] || set -- 1M 16M 256M
+mkdir -p "$DUMPS"
+
+for size in "$@"; do
+    dump="$DUMPS/enwiki-$size.xml"
+    [ -f "$dump" ] || "$BENCHMARK" -generate "$dump" -size "$size" >> "$RESULTS"
+    [ -f "$dump.gz" ] || gzip -c "$dump" > "$dump.gz"
+    for mode in $MODES; do
+        "$BENCHMARK" -input "$dump" -mode "$mode" -repeat "$REPEAT" -threads "$THREADS" >> "$RESULTS"
+    done
+done
@@ -25,6 +25,7 @@
  */
 
 #import <Foundation/Foundation.h>
+#import "ESXPBinding.h"
 #import "ESXPConstants.h"
 #import "ESXPElement.h"
 #import "ESXPNode.h"
@@ -39,6 +40,8 @@
 // MARK: Properties
 @property ESXPProcessor      *processor;
 @property ESXPStackDOMWalker *walker;
+@property id<ESXPNode>       root;
+@property ESXPNameTable      *nameTable;
 /// Configure this XML processor.
 ///
 /// \param doc      The document to parse.
@@ -47,4 +50,10 @@
 /// \return This instance.
 - (ESXPProcessorTest *)configure:(ESXPDocument *)doc rootNode:(NSString *)rootNode;
 - (NSArray *)getPages;
+
+/// Returns the same pages as getPages, mapped by an ESXPBinding in a single traversal
+/// of every page.
+///
+/// \return The pages.
+- (NSArray *)getBoundPages;
 @end
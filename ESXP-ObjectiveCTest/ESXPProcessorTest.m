@@ -39,7 +39,9 @@
 - (ESXPProcessorTest *)configure:(ESXPDocument *)doc rootNode:(NSString *)rootNode
 {
     @try {
-        self.walker = [[ESXPStackDOMWalker newBuild] configure:self->_processor.maxNodes rootNode:(ESXPElement *)[self.processor searchNode:doc rootNodeName:rootNode tagName:@"mediawiki"] nodesToProcess:ELEMENT_NODE];
+        self.nameTable = [doc getNameTable];
+        self.root      = [self.processor searchNode:doc rootNodeName:rootNode tagName:@"mediawiki"];
+        self.walker    = [[ESXPStackDOMWalker newBuild] configure:self->_processor.maxNodes rootNode:self.root nodesToProcess:ELEMENT_NODE];
     }
     @catch (NSException *exception) {
         NSString     *domain   = @"net.apkc.projects.ErrorDomain";
@@ -133,4 +135,33 @@
         return [NSMutableArray new];
     }
 }
+
+- (NSArray *)getBoundPages
+{
+    NSMutableArray *pages = [NSMutableArray new];
+    
+    // Declare the mapping once, every page is then bound in a single traversal.
+    ESXPQuery   *q_page  = [self.processor compileQuery:@"page"];
+    ESXPBinding *binding = [ESXPBinding newBuild:[ESXPWikiPage class]];
+    [binding bindProperty:@"_title" name:@"title" parent:@"page" attribute:nil];
+    [binding bindProperty:@"_ns" name:@"ns" parent:@"page" attribute:nil];
+    [binding bindProperty:@"_id" name:@"id" parent:@"page" attribute:nil];
+    [binding bindProperty:@"_revId" name:@"id" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revParentId" name:@"parentid" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revTimestamp" name:@"timestamp" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revContributorUsername" name:@"username" parent:@"contributor" attribute:nil];
+    [binding bindProperty:@"_revContributorId" name:@"id" parent:@"contributor" attribute:nil];
+    [binding bindProperty:@"_revMinor" name:@"minor" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revComment" name:@"comment" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revText" name:@"text" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revTextId" name:@"text" parent:@"revision" attribute:@"id"];
+    [binding bindProperty:@"_revTextBytes" name:@"text" parent:@"revision" attribute:@"bytes"];
+    [binding bindProperty:@"_revSHA1" name:@"sha1" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revModel" name:@"model" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revFormat" name:@"format" parent:@"revision" attribute:nil];
+    for (id<ESXPNode> node in [self.processor queryNodes:q_page node:self.root nameTable:self.nameTable])
+        [pages addObject:[binding bind:node nameTable:self.nameTable]];
+    
+    return pages;
+}
 @end
@@ -26,10 +26,20 @@
 
 #import <UIKit/UIKit.h>
 #import <XCTest/XCTest.h>
+#import <bzlib.h>
+#import <zlib.h>
+#import "ESXPArenaDocument.h"
+#import "ESXPBatchProcessor.h"
+#import "ESXPCompressedReader.h"
 #import "ESXPConstants.h"
 #import "ESXPDocument.h"
+#import "ESXPMetrics.h"
 #import "ESXPSAX2DOM.h"
 #import "ESXPProcessorTest.h"
+#import "ESXPProjection.h"
+#import "ESXPRecordEnumerator.h"
+#import "ESXPSAX2Arena.h"
+#import "ESXPSerializer.h"
 
 @interface ESXPTest : XCTestCase
 // MARK: Properties
@@ -56,7 +66,7 @@
     NSXMLParser *parser = [[NSXMLParser alloc] initWithData:data];
     
     // Create an instance of our parser delegate and assign it to the parser
-    ESXPSAX2DOM *parserDelegate = [[ESXPSAX2DOM alloc] init];
+    ESXPSAX2DOM *parserDelegate = [ESXPSAX2DOM newBuild:1000];
     [parser setDelegate:parserDelegate];
     
     // Invoke the parser and check the result
@@ -76,7 +86,7 @@
     self.processor = [ESXPProcessorTest new];
     self.processor = [self.processor configure:self.doc rootNode:@"mediawiki"];
     
-    NSLog(@"ELEMENT NODES COUNT ==> %u", [self.doc getElementNodeCount]);
+    NSLog(@"ELEMENT NODES COUNT ==> %llu", (unsigned long long) [self.doc getElementNodeCount]);
 }
 
 - (void)tearDown
@@ -93,6 +103,750 @@
     XCTAssert(YES, @"Pass");
 }
 
+- (void)testStreamingRecords
+{
+    NSString *xmlFile = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    
+    // Block.
+    __block NSUInteger count = 0;
+    ESXPSAX2DOM *builder = [ESXPSAX2DOM newBuild:1000 recordName:@"catalog_item" recordHandler:^(ESXPDocument *record, BOOL *stop) {
+        count++;
+        XCTAssertEqualObjects([[[[record getRootNode] getChildNodes] firstObject] getNodeName], @"catalog_item");
+    }];
+    NSXMLParser *parser = [[NSXMLParser alloc] initWithData:[NSData dataWithContentsOfFile:xmlFile]];
+    [parser setDelegate:builder];
+    XCTAssert([parser parse]);
+    XCTAssertEqual(count, 2);
+    
+    // Enumerator.
+    ESXPProcessor        *processor  = [ESXPProcessor newBuild:1000];
+    ESXPRecordEnumerator *enumerator = [ESXPRecordEnumerator newBuild:[NSInputStream inputStreamWithFileAtPath:xmlFile] recordName:@"catalog_item" maxNodes:1000];
+    NSMutableArray       *numbers    = [NSMutableArray new];
+    for (ESXPDocument *record in enumerator)
+        [numbers addObject:[processor searchTagValue:record rootNodeName:@"catalog_item" tagName:@"item_number" strict:YES]];
+    XCTAssertNil([enumerator error]);
+    XCTAssertEqualObjects(numbers, (@[ @"QWZ5671", @"RRX9856" ]));
+    
+    // A node kept after its record is gone stays usable, without a parent.
+    __block id<ESXPNode> kept = nil;
+    @autoreleasepool {
+        ESXPSAX2DOM *keeper = [ESXPSAX2DOM newBuild:100 recordName:@"b" recordHandler:^(ESXPDocument *record, BOOL *stop) {
+            kept = [[[record getRootNode] getFirstChild] getFirstChild];
+        }];
+        XCTAssert([keeper parseData:[@"<a><b><c>x</c></b></a>" dataUsingEncoding:NSUTF8StringEncoding] frontEnd:FRONTEND_NATIVE error:NULL]);
+    }
+    XCTAssertEqualObjects([kept getNodeName], @"c");
+    XCTAssertNil([kept getParentNode]);
+}
+
+- (void)testArenaDocument
+{
+    NSString *xmlFile = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    NSData   *data    = [NSData dataWithContentsOfFile:xmlFile];
+    
+    NSXMLParser *parser  = [[NSXMLParser alloc] initWithData:data];
+    ESXPSAX2DOM *objects = [ESXPSAX2DOM newBuild:1000];
+    [parser setDelegate:objects];
+    XCTAssert([parser parse]);
+    
+    parser = [[NSXMLParser alloc] initWithData:data];
+    ESXPSAX2Arena *arena = [ESXPSAX2Arena newBuild:1000];
+    [parser setDelegate:arena];
+    XCTAssert([parser parse]);
+    
+    ESXPProcessor *processor = [ESXPProcessor newBuild:1000];
+    XCTAssertEqual([[objects getDOM] getElementNodeCount], [[arena getDOM] getElementNodeCount]);
+    XCTAssertEqualObjects([processor searchTagValue:[arena getDOM] rootNodeName:@"catalog" tagName:@"price" strict:YES], @"39.95");
+    XCTAssertEqualObjects([processor searchTagAttributeValue:[arena getDOM] rootNodeName:@"catalog" tagName:@"size" attributeName:@"description" strict:YES], @"Medium");
+}
+
+- (void)testNativeFrontEnd
+{
+    NSString      *xmlFile   = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    ESXPSAX2DOM   *objects   = [ESXPSAX2DOM newBuild:1000];
+    ESXPSAX2DOM   *native    = [ESXPSAX2DOM newBuild:1000];
+    NSError       *error     = nil;
+    ESXPProcessor *processor = [ESXPProcessor newBuild:1000];
+    
+    XCTAssert([objects parseFile:xmlFile frontEnd:FRONTEND_NSXMLPARSER error:&error], @"%@", error);
+    XCTAssert([native parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssertEqual([[objects getDOM] getElementNodeCount], [[native getDOM] getElementNodeCount]);
+    XCTAssertEqualObjects([processor searchTagAttributeValue:[native getDOM] rootNodeName:@"catalog" tagName:@"catalog_item" attributeName:@"gender" strict:YES], @"Men's");
+    XCTAssertEqualObjects([processor searchTagValue:[native getDOM] rootNodeName:@"catalog" tagName:@"color_swatch" strict:YES],
+                          [processor searchTagValue:[objects getDOM] rootNodeName:@"catalog" tagName:@"color_swatch" strict:YES]);
+    
+    // Not well formed.
+    ESXPSAX2DOM *broken = [ESXPSAX2DOM newBuild:1000];
+    XCTAssertFalse([broken parseData:[@"<a><b></a>" dataUsingEncoding:NSUTF8StringEncoding] frontEnd:FRONTEND_NATIVE error:&error]);
+    XCTAssertEqual([error code], XMLPARSER_SAX2DOM_ERROR);
+    for (NSString *xml in @[ @"<a>&#xD800;</a>", @"<a>&#x110000;</a>", @"<a>&#0;</a>", @"<a b=\"&#55296;\"/>", @"<a b=\"1\" b=\"2\"/>" ]) {
+        XCTAssertFalse([[ESXPSAX2DOM newBuild:1000] parseData:[xml dataUsingEncoding:NSUTF8StringEncoding] frontEnd:FRONTEND_NATIVE error:&error], @"%@", xml);
+        XCTAssertEqual([error code], XMLPARSER_SAX2DOM_ERROR);
+    }
+}
+
+- (void)testLazyValues
+{
+    ESXPSAX2DOM   *lazy      = [ESXPSAX2DOM newBuild:1000];
+    NSError       *error     = nil;
+    ESXPProcessor *processor = [ESXPProcessor newBuild:1000];
+    
+    lazy.lazyValues = YES;
+    XCTAssert([lazy parseData:[@"<a><b id=\"x &amp; y\">1 &lt; 2</b></a>" dataUsingEncoding:NSUTF8StringEncoding] frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssertEqualObjects([processor searchTagAttributeValue:[lazy getDOM] rootNodeName:@"a" tagName:@"b" attributeName:@"id" strict:YES], @"x & y");
+    XCTAssertEqualObjects([processor searchTagValue:[lazy getDOM] rootNodeName:@"a" tagName:@"b" strict:YES], @"1 < 2");
+}
+
+- (void)testTagIndex
+{
+    NSString      *xmlFile   = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    ESXPSAX2DOM   *indexed   = [ESXPSAX2DOM newBuild:1000];
+    NSError       *error     = nil;
+    ESXPProcessor *processor = [ESXPProcessor newBuild:1000];
+    
+    indexed.buildTagIndex = YES;
+    XCTAssert([indexed parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssert([[indexed getDOM] hasTagIndex]);
+    XCTAssertEqual([[[indexed getDOM] getElementsByTagName:@"catalog_item"] count], (NSUInteger) 2);
+    XCTAssertEqual([[[indexed getDOM] getElementsByTagName:@"missing"] count], (NSUInteger) 0);
+    XCTAssertEqual([[[indexed getDOM] getElementsByTagName:@"_root"] count], (NSUInteger) 0);
+    XCTAssertEqualObjects([processor searchTagAttributeValue:[indexed getDOM] rootNodeName:@"catalog" tagName:@"catalog_item" attributeName:@"gender" strict:YES], @"Men's");
+    
+    // Same answer without the index.
+    ESXPSAX2DOM *plain = [ESXPSAX2DOM newBuild:1000];
+    XCTAssert([plain parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssertEqualObjects([[[indexed getDOM] getElementsByTagName:@"size"] valueForKey:@"description"],
+                          [[[plain getDOM] getElementsByTagName:@"size"] valueForKey:@"description"]);
+    XCTAssertEqual([[[plain getDOM] getElementsByTagName:@"_root"] count], (NSUInteger) 0);
+}
+
+- (void)testQuery
+{
+    NSString      *xmlFile   = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    ESXPSAX2DOM   *dom       = [ESXPSAX2DOM newBuild:1000];
+    NSError       *error     = nil;
+    ESXPProcessor *processor = [ESXPProcessor newBuild:1000];
+    
+    XCTAssert([dom parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    ESXPDocument *doc = [dom getDOM];
+    XCTAssertEqual([[processor queryNodes:[processor compileQuery:@"//color_swatch"] document:doc] count], (NSUInteger) 15);
+    XCTAssertEqualObjects([processor queryValues:[processor compileQuery:@"//catalog_item/@gender"] node:[doc getRootNode] nameTable:[doc getNameTable]], (@[ @"Men's", @"Women's" ]));
+    XCTAssertEqualObjects([processor queryValue:[processor compileQuery:@"/catalog/product/catalog_item[2]/size[1]/@description"] node:[doc getRootNode] nameTable:[doc getNameTable] strict:YES], @"Small");
+    XCTAssertEqualObjects([processor queryValue:[processor compileQuery:@"catalog//size[2]/color_swatch"] node:[doc getRootNode] nameTable:[doc getNameTable] strict:YES], @"Red");
+    XCTAssertThrowsSpecificNamed([processor compileQuery:@"catalog/"], NSException, @"InvalidQueryException");
+    XCTAssertThrowsSpecificNamed([processor compileQuery:@"a[0]"], NSException, @"InvalidQueryException");
+}
+
+- (void)testFieldSet
+{
+    NSString      *xmlFile   = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    ESXPSAX2DOM   *dom       = [ESXPSAX2DOM newBuild:1000];
+    NSError       *error     = nil;
+    ESXPProcessor *processor = [ESXPProcessor newBuild:1000];
+    ESXPFieldSet  *fields    = [ESXPFieldSet newBuild];
+    
+    NSUInteger f_number = [fields addField:@"item_number" parent:nil attribute:nil];
+    NSUInteger f_size   = [fields addField:@"size" parent:@"catalog_item" attribute:@"description"];
+    NSUInteger f_image  = [fields addField:@"color_swatch" parent:nil attribute:@"image"];
+    NSUInteger f_none   = [fields addField:@"missing" parent:nil attribute:nil];
+    
+    XCTAssert([dom parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    NSArray *items  = [[dom getDOM] getElementsByTagName:@"catalog_item"];
+    NSArray *values = [processor extractFields:fields node:[items objectAtIndex:1] nameTable:[[dom getDOM] getNameTable]];
+    XCTAssertEqualObjects([values objectAtIndex:f_number], @"RRX9856");
+    XCTAssertEqualObjects([values objectAtIndex:f_size], @"Small");
+    XCTAssertEqualObjects([values objectAtIndex:f_image], @"red_cardigan.jpg");
+    XCTAssertEqualObjects([values objectAtIndex:f_none], @"");
+}
+
+- (void)testBinding
+{
+    NSData      *xml     = [@"<mediawiki><page><title>A</title><id>1</id><revision><id>10</id><text bytes=\"3\">abc</text></revision></page>"
+                             @"<page><title>B</title><id>2</id><revision><id>20</id><text bytes=\"0\"></text></revision></page></mediawiki>" dataUsingEncoding:NSUTF8StringEncoding];
+    ESXPBinding *binding = [ESXPBinding newBuild:[ESXPWikiPage class]];
+    NSError     *error   = nil;
+    
+    [binding bindProperty:@"_title" name:@"title" parent:@"page" attribute:nil];
+    [binding bindProperty:@"_id" name:@"id" parent:@"page" attribute:nil];
+    [binding bindProperty:@"_revId" name:@"id" parent:@"revision" attribute:nil];
+    [binding bindProperty:@"_revTextBytes" name:@"text" parent:@"revision" attribute:@"bytes"];
+    XCTAssertThrowsSpecificNamed([binding bindProperty:@"_missing" name:@"x" parent:nil attribute:nil], NSException, @"InvalidBindingException");
+    
+    // Over a built document.
+    ESXPSAX2DOM *dom = [ESXPSAX2DOM newBuild:1000];
+    XCTAssert([dom parseData:xml frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    NSArray *pages = [binding bindAll:[dom getDOM] recordName:@"page"];
+    XCTAssertEqual([pages count], (NSUInteger) 2);
+    XCTAssertEqualObjects([[pages objectAtIndex:0] _revId], @"10");
+    XCTAssertEqualObjects([[pages objectAtIndex:1] _revTextBytes], @"0");
+    
+    // While streaming.
+    NSMutableArray *streamed = [NSMutableArray new];
+    ESXPSAX2DOM    *stream   = [ESXPSAX2DOM newBuild:1000 recordName:@"page" recordHandler:[binding recordHandler:^(id object, BOOL *stop) {
+        [streamed addObject:object];
+    }]];
+    XCTAssert([stream parseData:xml frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssertEqualObjects([streamed valueForKey:@"_title"], (@[ @"A", @"B" ]));
+}
+
+- (void)testWalker
+{
+    NSString    *xmlFile = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    ESXPSAX2DOM *dom     = [ESXPSAX2DOM newBuild:1000];
+    NSError     *error   = nil;
+    
+    XCTAssert([dom parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    
+    // A tiny stack hint, the walker grows as needed.
+    ESXPStackDOMWalker *walker = [[ESXPStackDOMWalker newBuild] configure:1 rootNode:[[dom getDOM] getRootNode] nodesToProcess:ELEMENT_NODE];
+    NSUInteger         all     = 0;
+    for (id<ESXPNode> node in walker)
+        all++;
+    XCTAssertEqual(all, (NSUInteger) [[dom getDOM] getElementNodeCount] + 1);
+    
+    // Reused, skipping the swatches under every size.
+    __block NSUInteger visited = 0;
+    [[walker reset:[[dom getDOM] getRootNode] nodesToProcess:ELEMENT_NODE] visit:^(id<ESXPNode> node, BOOL *skipChildren, BOOL *stop) {
+        visited++;
+        *skipChildren = [[node getNodeName] isEqualToString:@"size"];
+    }];
+    XCTAssertEqual(visited, all - 15);
+}
+
+- (void)testSiblings
+{
+    NSData        *xml    = [@"<a><b/>text<c/><d/></a>" dataUsingEncoding:NSUTF8StringEncoding];
+    ESXPSAX2DOM   *dom    = [ESXPSAX2DOM newBuild:1000];
+    ESXPSAX2Arena *arena  = [ESXPSAX2Arena newBuild:1000];
+    NSXMLParser   *parser = [[NSXMLParser alloc] initWithData:xml];
+    NSError       *error  = nil;
+    
+    XCTAssert([dom parseData:xml frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    id<ESXPNode> a = [[[dom getDOM] getRootNode] getFirstChild];
+    XCTAssertEqualObjects([[a getFirstChild] getNodeName], @"b");
+    XCTAssertEqualObjects([[[a getFirstChild] getNextSibling] getNodeValue], @"text");
+    XCTAssertEqualObjects([[[a getLastChild] getPreviousSibling] getNodeName], @"c");
+    XCTAssertNil([[a getLastChild] getNextSibling]);
+    XCTAssertNil([[a getFirstChild] getPreviousSibling]);
+    
+    [parser setDelegate:arena];
+    XCTAssert([parser parse]);
+    id<ESXPNode> arenaA = [[[arena getDOM] getRootNode] getFirstChild];
+    XCTAssertEqualObjects([[[arenaA getLastChild] getPreviousSibling] getNodeName], @"c");
+}
+
+- (void)testParallelParse
+{
+    NSMutableString *xml = [NSMutableString stringWithString:@"<?xml version=\"1.0\"?>\n<mediawiki>\n  <siteinfo><sitename>Test</sitename></siteinfo>\n"];
+    for (NSUInteger i = 0; i < 200; i++)
+        [xml appendFormat:@"  <page>\n    <title>Page %lu</title>\n    <id>%lu</id>\n    <revision id=\"%lu\"><text>a &amp; b</text></revision>\n  </page >\n", (unsigned long) i, (unsigned long) i, (unsigned long) i * 7];
+    [xml appendString:@"</mediawiki>\n"];
+    
+    NSData      *data     = [xml dataUsingEncoding:NSUTF8StringEncoding];
+    ESXPSAX2DOM *serial   = [ESXPSAX2DOM newBuild:1000];
+    ESXPSAX2DOM *parallel = [ESXPSAX2DOM newBuild:1000];
+    NSError     *error    = nil;
+    
+    XCTAssert([serial parseData:data frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssert([parallel parseData:data splitAt:@"page" threads:4 error:&error], @"%@", error);
+    XCTAssertEqual([[parallel getDOM] getElementNodeCount], [[serial getDOM] getElementNodeCount]);
+    XCTAssertEqualObjects([ESXPDocument printDocument:[parallel getDOM]], [ESXPDocument printDocument:[serial getDOM]]);
+    
+    id<ESXPNode> mediawiki = [[[parallel getDOM] getRootNode] getFirstChild];
+    XCTAssertEqual([[mediawiki getLastChild] getParentNode], mediawiki);
+}
+
+- (void)testNameTableThreads
+{
+    // Many threads interning the same names while the table grows, which publishes new
+    // slots and entries under the readers.
+    ESXPNameTable    *table = [ESXPNameTable newBuild];
+    NSOperationQueue *queue = [NSOperationQueue new];
+    for (NSUInteger t = 0; t < 8; t++) {
+        [queue addOperationWithBlock:^{
+            for (NSUInteger i = 0; i < 2000; i++) {
+                NSString                      *name     = [NSString stringWithFormat:@"n%lu", (unsigned long) (i * 7 + t) % 1000];
+                NSString * __unsafe_unretained interned = nil;
+                NSUInteger                    symbol    = [table internName:name interned:&interned];
+                XCTAssertEqualObjects(interned, name);
+                XCTAssertEqual([table nameForSymbol:symbol], interned);
+                XCTAssertEqual([table symbolForName:name], symbol);
+            }
+        }];
+    }
+    [queue waitUntilAllOperationsAreFinished];
+    XCTAssertEqual([table count], (NSUInteger) 1000);
+    XCTAssertEqual([table symbolForName:@"missing"], kNO_SYMBOL);
+}
+
+- (void)testParallelQueries
+{
+    NSString      *xmlFile   = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    ESXPSAX2DOM   *builder   = [ESXPSAX2DOM newBuild:1000];
+    ESXPProcessor *processor = [ESXPProcessor newBuild:1000];
+    NSError       *error     = nil;
+    
+    XCTAssert([builder parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    ESXPDocument  *doc       = [builder getDOM];
+    XCTAssertThrowsSpecificNamed([processor searchNodes:doc tagName:@"color_swatch" threads:4], NSException, @"UnfrozenDocumentException");
+    [doc freeze];
+    XCTAssert([doc isFrozen]);
+    XCTAssertThrowsSpecificNamed([doc normalize], NSException, @"FrozenDocumentException");
+    
+    NSArray *swatches = [processor searchNodes:doc tagName:@"color_swatch" threads:4];
+    XCTAssertEqual([swatches count], 15);
+    XCTAssertEqualObjects(swatches, [doc getElementsByTagName:@"color_swatch"]);
+    
+    NSArray      *items  = [processor searchNodes:doc tagName:@"catalog_item" threads:4];
+    ESXPFieldSet *fields = [ESXPFieldSet newBuild];
+    [fields addField:@"item_number" parent:@"catalog_item" attribute:nil];
+    XCTAssertEqualObjects([processor extractFields:fields nodes:items document:doc threads:4], (@[ @[ @"QWZ5671" ], @[ @"RRX9856" ] ]));
+    XCTAssertEqualObjects([processor queryValues:[processor compileQuery:@"item_number"] nodes:items document:doc threads:4], (@[ @"QWZ5671", @"RRX9856" ]));
+    
+    // Reading the attributes of a frozen element without any leaves it untouched.
+    id<ESXPNode>     number = [[doc getElementsByTagName:@"item_number"] objectAtIndex:0];
+    NSDictionary     *empty = [number getAttributes];
+    NSOperationQueue *queue = [NSOperationQueue new];
+    for (NSUInteger i = 0; i < 64; i++) {
+        [queue addOperationWithBlock:^{
+            for (NSUInteger j = 0; j < 1000; j++)
+                XCTAssertEqual([number getAttributes], empty);
+        }];
+    }
+    [queue waitUntilAllOperationsAreFinished];
+    XCTAssertEqual([empty count], (NSUInteger) 0);
+}
+
+- (void)testBatchProcessor
+{
+    NSMutableArray *values = [NSMutableArray new];
+    NSMutableArray *errors = [NSMutableArray new];
+    NSMutableArray *order  = [NSMutableArray new];
+    ESXPBatchProcessor *batch = [ESXPBatchProcessor newBuild:4 maxPending:8 ordered:YES maxNodes:100 extractor:^id(ESXPDocument *document, ESXPProcessor *processor) {
+        return [processor searchTagValue:document rootNodeName:@"doc" tagName:@"n" strict:YES];
+    } consumer:^(NSUInteger index, id result, NSError *error) {
+        [order addObject:@(index)];
+        if (error != nil)
+            [errors addObject:@(index)];
+        else
+            [values addObject:result];
+    }];
+    
+    for (NSUInteger i = 0; i < 100; i++) {
+        NSString *xml = (i == 50) ? @"<doc><n>broken</doc>" : [NSString stringWithFormat:@"<doc><n>%lu</n></doc>", (unsigned long) i];
+        XCTAssertEqual([batch submitData:[xml dataUsingEncoding:NSUTF8StringEncoding]], i);
+    }
+    [batch finish];
+    
+    XCTAssertEqual([order count], 100);
+    for (NSUInteger i = 0; i < 100; i++)
+        XCTAssertEqualObjects([order objectAtIndex:i], @(i));
+    XCTAssertEqualObjects(errors, @[ @50 ]);
+    XCTAssertEqualObjects([values objectAtIndex:51], @"52");
+    XCTAssertThrowsSpecificNamed([batch submitData:[NSData data]], NSException, @"BatchClosedException");
+}
+
+- (void)testSnapshot
+{
+    NSString    *xmlFile  = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    NSString    *snapFile = [NSTemporaryDirectory() stringByAppendingPathComponent:@"test_complex.esxp"];
+    ESXPSAX2DOM *builder  = [ESXPSAX2DOM newBuild:1000];
+    NSError     *error    = nil;
+    
+    XCTAssert([builder parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssert([[builder getDOM] writeSnapshot:snapFile error:&error], @"%@", error);
+    
+    ESXPArenaDocument *loaded = [ESXPArenaDocument newBuildFromSnapshot:snapFile error:&error];
+    XCTAssertNotNil(loaded, @"%@", error);
+    XCTAssert([loaded isFrozen]);
+    XCTAssertEqual([loaded getElementNodeCount], [[builder getDOM] getElementNodeCount]);
+    
+    NSArray *swatches = [loaded getElementsByTagName:@"color_swatch"];
+    XCTAssertEqual([swatches count], 15);
+    XCTAssertEqualObjects([[swatches firstObject] getAttribute:@"image"], @"red_cardigan.jpg");
+    XCTAssertEqualObjects([[[swatches firstObject] getFirstChild] getNodeValue], @"Red");
+    XCTAssertEqualObjects([[ESXPProcessor newBuild:1000] searchTagValue:loaded rootNodeName:@"catalog" tagName:@"item_number" strict:YES], @"QWZ5671");
+    
+    // Anything else is refused.
+    XCTAssertNil([ESXPArenaDocument newBuildFromSnapshot:xmlFile error:&error]);
+    XCTAssertEqual([error code], SNAPSHOT_INVALID);
+    
+    // So is a snapshot of the right size with a row out of bounds. The parents come after
+    // the header (56 bytes up to the counts, then the statistics), the types and the names.
+    NSMutableData *corrupt   = [NSMutableData dataWithContentsOfFile:snapFile];
+    NSUInteger    nodeCount  = [loaded getNodeCount];
+    NSUInteger    parents    = 56 + sizeof(ESXPDocumentStatistics) + ((nodeCount + 7) & ~(NSUInteger) 7) + ((nodeCount * 4 + 7) & ~(NSUInteger) 7);
+    ((uint32_t *) ((char *) [corrupt mutableBytes] + parents))[1] = 0x7FFFFFFF;
+    XCTAssert([corrupt writeToFile:snapFile atomically:YES]);
+    XCTAssertNil([ESXPArenaDocument newBuildFromSnapshot:snapFile error:&error]);
+    XCTAssertEqual([error code], SNAPSHOT_INVALID);
+    [[NSFileManager defaultManager] removeItemAtPath:snapFile error:nil];
+}
+
+- (void)testCoalesceText
+{
+    NSData *xml = [@"<a>x &amp; y<!-- c --> z<b> </b>\n  <c/></a>" dataUsingEncoding:NSUTF8StringEncoding];
+    for (NSNumber *frontEnd in @[ @(FRONTEND_NSXMLPARSER), @(FRONTEND_NATIVE) ]) {
+        ESXPSAX2DOM *builder = [ESXPSAX2DOM newBuild:100];
+        NSError     *error   = nil;
+        builder.coalesceText     = YES;
+        builder.ignoreWhitespace = YES;
+        builder.lazyValues       = YES;
+        
+        XCTAssert([builder parseData:xml frontEnd:[frontEnd intValue] error:&error], @"%@", error);
+        id<ESXPNode> a = [[[builder getDOM] getRootNode] getFirstChild];
+        XCTAssertEqual([[a getChildNodes] count], 3);
+        XCTAssertEqualObjects([[a getFirstChild] getNodeValue], @"x & y z");
+        XCTAssertFalse([[[a getFirstChild] getNextSibling] hasChildNodes]);
+        XCTAssertEqualObjects([[a getLastChild] getNodeName], @"c");
+    }
+}
+
+- (void)testStatistics
+{
+    NSData *xml = [@"<a x=\"1\"><b y=\"2\" z=\"3\">h\u00e9</b><c><d/></c></a>" dataUsingEncoding:NSUTF8StringEncoding];
+    for (NSNumber *frontEnd in @[ @(FRONTEND_NSXMLPARSER), @(FRONTEND_NATIVE) ]) {
+        ESXPSAX2DOM *builder = [ESXPSAX2DOM newBuild:100];
+        NSError     *error   = nil;
+        XCTAssert([builder parseData:xml frontEnd:[frontEnd intValue] error:&error], @"%@", error);
+        
+        ESXPDocumentStatistics kept = [[builder getDOM] getStatistics];
+        XCTAssertEqual(kept.elementCount, 4);
+        XCTAssertEqual(kept.attributeCount, 3);
+        XCTAssertEqual(kept.textNodeCount, 1);
+        XCTAssertEqual(kept.textBytes, 3);
+        XCTAssertEqual(kept.maxDepth, 3);
+        
+        // Counting by hand gives the same numbers.
+        [[builder getDOM] countStatistics];
+        ESXPDocumentStatistics counted = [[builder getDOM] getStatistics];
+        XCTAssertEqual(memcmp(&kept, &counted, sizeof(kept)), 0);
+        XCTAssertEqual([[ESXPArenaDocument newBuildFromDocument:[builder getDOM]] getStatistics].maxDepth, 3);
+    }
+}
+
+- (void)testSerializer
+{
+    NSData      *xml     = [@"<a k=\"1 &quot;2&quot;\"><b>x &amp; y</b><c/></a>" dataUsingEncoding:NSUTF8StringEncoding];
+    ESXPSAX2DOM *builder = [ESXPSAX2DOM newBuild:100];
+    NSError     *error   = nil;
+    builder.coalesceText = YES;
+    XCTAssert([builder parseData:xml frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    
+    NSMutableData  *output     = [NSMutableData new];
+    ESXPSerializer *serializer = [ESXPSerializer newBuildToData:output];
+    XCTAssert([serializer writeDocument:[builder getDOM] error:&error], @"%@", error);
+    XCTAssert([serializer flush:&error], @"%@", error);
+    
+    // What is written parses back to the same values.
+    ESXPSAX2DOM *reread = [ESXPSAX2DOM newBuild:100];
+    reread.coalesceText = YES;
+    XCTAssert([reread parseData:output frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    id<ESXPNode> a = [[[reread getDOM] getRootNode] getFirstChild];
+    XCTAssertEqualObjects([a getAttribute:@"k"], @"1 \"2\"");
+    XCTAssertEqualObjects([[[a getFirstChild] getFirstChild] getNodeValue], @"x & y");
+    XCTAssertEqualObjects([[a getLastChild] getNodeName], @"c");
+    
+    [output setLength:0];
+    serializer             = [ESXPSerializer newBuildToData:output];
+    serializer.prettyPrint = YES;
+    XCTAssert([serializer writeNode:[[[builder getDOM] getRootNode] getFirstChild] error:&error], @"%@", error);
+    XCTAssert([serializer flush:&error], @"%@", error);
+    NSString *pretty = [[NSString alloc] initWithData:output encoding:NSUTF8StringEncoding];
+    XCTAssert([pretty containsString:@"\n  <b>x &amp; y</b>\n  <c/>\n</a>"], @"%@", pretty);
+    
+    // Documents with their own name tables give the same symbols to other names.
+    ESXPSAX2DOM *first  = [ESXPSAX2DOM newBuild:10];
+    ESXPSAX2DOM *second = [ESXPSAX2DOM newBuild:10];
+    XCTAssert([first parseData:[@"<x/>" dataUsingEncoding:NSUTF8StringEncoding] frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssert([second parseData:[@"<y/>" dataUsingEncoding:NSUTF8StringEncoding] frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    [output setLength:0];
+    serializer = [ESXPSerializer newBuildToData:output];
+    XCTAssert([serializer writeNode:[[[first getDOM] getRootNode] getFirstChild] error:&error], @"%@", error);
+    XCTAssert([serializer writeNode:[[[second getDOM] getRootNode] getFirstChild] error:&error], @"%@", error);
+    XCTAssert([serializer flush:&error], @"%@", error);
+    XCTAssertEqualObjects([[NSString alloc] initWithData:output encoding:NSUTF8StringEncoding], @"<x/><y/>");
+}
+
+- (void)testMetrics
+{
+    NSString       *xmlFile   = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    ESXPProcessor  *processor = [ESXPProcessor newBuild:1000];
+    NSMutableArray *phases    = [NSMutableArray new];
+    NSError        *error     = nil;
+    
+    [ESXPMetrics reset];
+    [ESXPMetrics setPhaseHook:^(MetricPhases phase, BOOL begin) { [phases addObject:@(begin ? phase : -1 - phase)]; }];
+    [ESXPMetrics setEnabled:YES];
+    ESXPSAX2DOM *builder = [ESXPSAX2DOM newBuild:1000];
+    XCTAssert([builder parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssertEqualObjects([processor searchTagValue:[builder getDOM] rootNodeName:@"catalog" tagName:@"item_number" strict:YES], @"QWZ5671");
+    [ESXPMetrics setEnabled:NO];
+    [ESXPMetrics setPhaseHook:nil];
+    
+    ESXPMetricsStatistics metrics = [ESXPMetrics getStatistics];
+    XCTAssertEqual(metrics.counters[METRIC_ELEMENTS], [[builder getDOM] getStatistics].elementCount);
+    XCTAssertEqual(metrics.counters[METRIC_NODES_ALLOCATED], [[builder getDOM] getStatistics].elementCount + [[builder getDOM] getStatistics].textNodeCount);
+    XCTAssertGreaterThan(metrics.counters[METRIC_TEXT_CHUNKS], 0);
+    XCTAssertGreaterThan(metrics.counters[METRIC_WALKER_NODES], 0);
+    XCTAssertGreaterThan(metrics.counters[METRIC_WALKER_STACK_MAX], 0);
+    XCTAssertEqual(metrics.counters[METRIC_QUERY_RESULTS], 1);
+    XCTAssertEqual(metrics.timers[PHASE_PARSE].count, 1);
+    XCTAssertEqual(metrics.timers[PHASE_SEARCH].count, 1);
+    XCTAssertEqualObjects(phases, (@[ @(PHASE_PARSE), @(-1 - PHASE_PARSE), @(PHASE_SEARCH), @(-1 - PHASE_SEARCH) ]));
+    
+    // Nothing is counted while off.
+    XCTAssert([[ESXPSAX2DOM newBuild:1000] parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssertEqual([ESXPMetrics getStatistics].timers[PHASE_PARSE].count, 1);
+    XCTAssertEqual([ESXPMetrics getStatistics].counters[METRIC_ELEMENTS], metrics.counters[METRIC_ELEMENTS]);
+}
+
+- (void)testLimits
+{
+    NSString *xmlFile = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    NSData   *nested  = [@"<a><b><c x=\"1\"/></b></a>" dataUsingEncoding:NSUTF8StringEncoding];
+    NSError  *error   = nil;
+    
+    ESXPSAX2DOM *eager = [ESXPSAX2DOM newBuild:1000];
+    ESXPSAX2DOM *lazy  = [ESXPSAX2DOM newBuild:1000];
+    lazy.lazyValues = YES;
+    XCTAssert([eager parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssert([lazy parseFile:xmlFile frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    ESXPDocumentFootprint footprint = [[eager getDOM] getFootprint];
+    XCTAssertGreaterThan(footprint.nodeBytes, 0);
+    XCTAssertGreaterThan(footprint.nameBytes, 0);
+    XCTAssertGreaterThan(footprint.textBytes, [[eager getDOM] getStatistics].textBytes);
+    XCTAssertEqual([[lazy getDOM] getFootprint].textBytes, 0);
+    
+    for (NSNumber *frontEnd in @[ @(FRONTEND_NSXMLPARSER), @(FRONTEND_NATIVE) ]) {
+        ESXPSAX2DOM *budget = [ESXPSAX2DOM newBuild:1000];
+        budget.maxBytes = ESXPFootprintTotal(footprint) / 2;
+        XCTAssertFalse([budget parseFile:xmlFile frontEnd:[frontEnd intValue] error:&error]);
+        XCTAssertEqual([error code], PARSE_BUDGET_EXCEEDED);
+        XCTAssertLessThan([[budget getDOM] getStatistics].elementCount, [[eager getDOM] getStatistics].elementCount);
+        
+        ESXPSAX2DOM *deep = [ESXPSAX2DOM newBuild:1000];
+        deep.maxDepth = 2;
+        XCTAssertFalse([deep parseData:nested frontEnd:[frontEnd intValue] error:&error]);
+        XCTAssertEqual([error code], PARSE_DEPTH_EXCEEDED);
+        
+        deep = [ESXPSAX2DOM newBuild:1000];
+        deep.maxDepth = 3;
+        XCTAssert([deep parseData:nested frontEnd:[frontEnd intValue] error:&error], @"%@", error);
+    }
+}
+
+- (void)testPushParsing
+{
+    NSString      *xmlFile   = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    NSData        *data      = [NSData dataWithContentsOfFile:xmlFile];
+    NSError       *error     = nil;
+    ESXPProcessor *processor = [ESXPProcessor newBuild:1000];
+    ESXPQuery     *query     = [processor compileQuery:@"item_number"];
+    ESXPSAX2DOM   *whole     = [ESXPSAX2DOM newBuild:1000];
+    XCTAssert([whole parseData:data frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    
+    for (NSNumber *lazy in @[ @NO, @YES ]) {
+        ESXPSAX2DOM        *builder   = [ESXPSAX2DOM newBuild:1000];
+        ESXPNameTable      *nameTable = [[builder getDOM] getNameTable];
+        NSMutableArray     *items     = [NSMutableArray new];
+        __block NSUInteger pushed     = 0;
+        builder.lazyValues = [lazy boolValue];
+        [builder watchElement:@"catalog_item" handler:^(ESXPElement *element, BOOL *stop) {
+            [items addObject:[processor queryValue:query node:element nameTable:nameTable strict:YES]];
+            XCTAssertLessThan(pushed, [data length]); // Before the end of the input.
+        }];
+        
+        for (pushed = 0; pushed < [data length]; pushed += 7) {
+            NSData *chunk = [data subdataWithRange:NSMakeRange(pushed, MIN((NSUInteger) 7, [data length] - pushed))];
+            XCTAssert([builder pushData:chunk final:NO error:&error], @"%@", error);
+        }
+        XCTAssert([builder pushData:nil final:YES error:&error], @"%@", error);
+        XCTAssertEqualObjects(items, (@[ @"QWZ5671", @"RRX9856" ]));
+        XCTAssertEqual([[builder getDOM] getStatistics].elementCount, [[whole getDOM] getStatistics].elementCount);
+        XCTAssertEqualObjects([processor queryValue:[processor compileQuery:@"catalog//size[2]/color_swatch"] node:[[builder getDOM] getRootNode] nameTable:nameTable strict:YES], @"Red");
+    }
+    
+    // A handler may stop the parse, and a broken input fails at its last chunk.
+    ESXPSAX2DOM        *stopped = [ESXPSAX2DOM newBuild:1000];
+    __block NSUInteger count    = 0;
+    [stopped watchElement:@"color_swatch" handler:^(ESXPElement *element, BOOL *stop) { *stop = (++count == 3); }];
+    XCTAssert([stopped pushData:data final:YES error:&error], @"%@", error);
+    XCTAssertEqual(count, (NSUInteger) 3);
+    
+    // Text and comments longer than many chunks, which are scanned once and dropped from the buffer.
+    NSString    *run    = [@"" stringByPaddingToLength:100000 withString:@"x" startingAtIndex:0];
+    NSData      *input  = [[NSString stringWithFormat:@"<a>%@<!--%@-->%@</a>", run, run, run] dataUsingEncoding:NSUTF8StringEncoding];
+    ESXPSAX2DOM *pusher = [ESXPSAX2DOM newBuild:1000];
+    for (NSUInteger offset = 0; offset < [input length]; offset += 1000)
+        XCTAssert([pusher pushData:[input subdataWithRange:NSMakeRange(offset, MIN((NSUInteger) 1000, [input length] - offset))] final:NO error:&error], @"%@", error);
+    XCTAssert([pusher pushData:nil final:YES error:&error], @"%@", error);
+    NSArray *texts = [[[[pusher getDOM] getRootNode] getFirstChild] getChildNodes];
+    XCTAssertEqual([texts count], (NSUInteger) 2);
+    for (id<ESXPNode> text in texts)
+        XCTAssertEqualObjects([text getNodeValue], run);
+    
+    ESXPSAX2DOM *broken = [ESXPSAX2DOM newBuild:1000];
+    XCTAssert([broken pushData:[@"<a><b>" dataUsingEncoding:NSUTF8StringEncoding] final:NO error:&error], @"%@", error);
+    XCTAssertFalse([broken pushData:[@"</a>" dataUsingEncoding:NSUTF8StringEncoding] final:YES error:&error]);
+    XCTAssertEqual([error code], XMLPARSER_SAX2DOM_ERROR);
+}
+
+- (void)testProjection
+{
+    NSString       *xmlFile    = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    NSData         *data       = [NSData dataWithContentsOfFile:xmlFile];
+    NSError        *error      = nil;
+    ESXPProcessor  *processor  = [ESXPProcessor newBuild:1000];
+    ESXPProjection *projection = [ESXPProjection newBuild:@[ @"catalog_item/item_number", @"/catalog/product/catalog_item/size" ]];
+    
+    for (NSUInteger run = 0; run < 4; run++) {
+        ESXPSAX2DOM *builder = [ESXPSAX2DOM newBuild:1000];
+        builder.projection = projection;
+        builder.lazyValues = (run == 2);
+        if (run < 3)
+            XCTAssert([builder parseData:data frontEnd:(run == 0) ? FRONTEND_NSXMLPARSER : FRONTEND_NATIVE error:&error], @"%@", error);
+        else
+            XCTAssert([builder parseData:data splitAt:@"catalog_item" threads:2 error:&error], @"%@", error);
+        
+        // The kept elements, the bare elements they are nested in, and nothing else.
+        ESXPDocument  *doc       = [builder getDOM];
+        id<ESXPNode>  root       = [doc getRootNode];
+        ESXPNameTable *nameTable = [doc getNameTable];
+        XCTAssertEqual([doc getStatistics].elementCount, (uint64_t) 27);
+        XCTAssertEqualObjects([processor queryValues:[processor compileQuery:@"//catalog_item/item_number"] node:root nameTable:nameTable], (@[ @"QWZ5671", @"RRX9856" ]));
+        XCTAssertEqual([[processor queryNodes:[processor compileQuery:@"//color_swatch"] document:doc] count], (NSUInteger) 15);
+        XCTAssertEqual([[processor queryNodes:[processor compileQuery:@"//price"] document:doc] count], (NSUInteger) 0);
+        XCTAssertEqual([[processor queryValues:[processor compileQuery:@"//catalog_item/@gender"] node:root nameTable:nameTable] count], (NSUInteger) 0);
+        XCTAssertEqualObjects([processor queryValue:[processor compileQuery:@"/catalog/product/catalog_item[2]/size[1]/@description"] node:root nameTable:nameTable strict:YES], @"Small");
+    }
+    
+    // Records hold only what is kept in them.
+    NSMutableArray *items  = [NSMutableArray new];
+    ESXPSAX2DOM    *stream = [ESXPSAX2DOM newBuild:1000 recordName:@"catalog_item" recordHandler:^(ESXPDocument *record, BOOL *stop) {
+        [items addObject:[processor queryValue:[processor compileQuery:@"catalog_item/item_number"] node:[record getRootNode] nameTable:[record getNameTable] strict:YES]];
+        XCTAssertEqual([record getStatistics].elementCount, (uint64_t) 2);
+    }];
+    stream.projection = [ESXPProjection newBuild:@[ @"item_number" ]];
+    XCTAssert([stream parseData:data frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssertEqualObjects(items, (@[ @"QWZ5671", @"RRX9856" ]));
+    
+    ESXPSAX2DOM *none = [ESXPSAX2DOM newBuild:1000];
+    none.projection = [ESXPProjection newBuild:@[ @"/product" ]];
+    XCTAssert([none parseData:data frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    XCTAssertEqual([[none getDOM] getStatistics].elementCount, (uint64_t) 0);
+    XCTAssertThrowsSpecificNamed([ESXPProjection newBuild:@[ @"catalog//size" ]], NSException, @"InvalidPathException");
+}
+
+- (void)testCompressedFiles
+{
+    NSString *xmlFile   = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    NSString *gzipFile  = [NSTemporaryDirectory() stringByAppendingPathComponent:@"test_complex.xml.gz"];
+    NSString *bzip2File = [NSTemporaryDirectory() stringByAppendingPathComponent:@"test_complex.xml.bz2"];
+    NSString *cutFile   = [NSTemporaryDirectory() stringByAppendingPathComponent:@"test_cut.xml.gz"];
+    NSData   *data      = [NSData dataWithContentsOfFile:xmlFile];
+    NSError  *error     = nil;
+    
+    // Two gzip members, cut in the middle of the document.
+    NSUInteger half = [data length] / 2;
+    gzFile     member = gzopen([gzipFile fileSystemRepresentation], "wb");
+    gzwrite(member, [data bytes], (unsigned int) half);
+    gzclose(member);
+    member = gzopen([gzipFile fileSystemRepresentation], "ab");
+    gzwrite(member, (const char *) [data bytes] + half, (unsigned int) ([data length] - half));
+    gzclose(member);
+    
+    unsigned int  length     = (unsigned int) [data length] * 2 + 600;
+    NSMutableData *bzip2Data = [NSMutableData dataWithLength:length];
+    XCTAssertEqual(BZ2_bzBuffToBuffCompress([bzip2Data mutableBytes], &length, (char *) [data bytes], (unsigned int) [data length], 9, 0, 0), BZ_OK);
+    [bzip2Data setLength:length];
+    [bzip2Data writeToFile:bzip2File atomically:YES];
+    
+    NSArray *files        = @[ gzipFile, bzip2File, xmlFile ];
+    NSArray *compressions = @[ @(COMPRESSION_GZIP), @(COMPRESSION_BZIP2), @(COMPRESSION_NONE) ];
+    for (NSUInteger i = 0; i < [files count]; i++) {
+        ESXPCompressedReader *reader = [ESXPCompressedReader newBuild:[files objectAtIndex:i] chunkSize:4096 chunkCount:2];
+        NSMutableData        *read   = [NSMutableData new];
+        NSData               *chunk  = nil;
+        XCTAssert([reader open:&error], @"%@", error);
+        while ((chunk = [reader nextChunk:&error]) != nil)
+            [read appendData:chunk];
+        XCTAssertEqual([reader getCompression], [[compressions objectAtIndex:i] intValue]);
+        XCTAssertEqualObjects(read, data);
+        
+        NSMutableArray *items     = [NSMutableArray new];
+        ESXPProcessor  *processor = [ESXPProcessor newBuild:1000];
+        ESXPSAX2DOM    *builder   = [ESXPSAX2DOM newBuild:1000 recordName:@"catalog_item" recordHandler:^(ESXPDocument *record, BOOL *stop) {
+            [items addObject:[processor queryValue:[processor compileQuery:@"catalog_item/item_number"] node:[record getRootNode] nameTable:[record getNameTable] strict:YES]];
+        }];
+        XCTAssert([builder parseCompressedFile:[files objectAtIndex:i] error:&error], @"%@", error);
+        XCTAssertEqualObjects(items, (@[ @"QWZ5671", @"RRX9856" ]));
+    }
+    
+    [[[NSData dataWithContentsOfFile:gzipFile] subdataWithRange:NSMakeRange(0, 200)] writeToFile:cutFile atomically:YES];
+    XCTAssertFalse([[ESXPSAX2DOM newBuild:1000] parseCompressedFile:cutFile error:&error]);
+    XCTAssertEqual([error code], DECOMPRESSION_ERROR);
+}
+
+- (void)testCompactText
+{
+    NSString      *xmlFile   = [[NSBundle bundleForClass:[self class]] pathForResource:@"test_complex" ofType:@"xml"];
+    NSData        *data      = [NSData dataWithContentsOfFile:xmlFile];
+    NSError       *error     = nil;
+    ESXPProcessor *processor = [ESXPProcessor newBuild:1000];
+    
+    for (NSUInteger run = 0; run < 3; run++) {
+        ESXPSAX2DOM *builder = [ESXPSAX2DOM newBuild:1000];
+        builder.compactText = YES;
+        if (run < 2) {
+            XCTAssert([builder parseData:data frontEnd:(run == 0) ? FRONTEND_NSXMLPARSER : FRONTEND_NATIVE error:&error], @"%@", error);
+        }
+        else {
+            for (NSUInteger pushed = 0; pushed < [data length]; pushed += 7) {
+                NSData *chunk = [data subdataWithRange:NSMakeRange(pushed, MIN((NSUInteger) 7, [data length] - pushed))];
+                XCTAssert([builder pushData:chunk final:NO error:&error], @"%@", error);
+            }
+            XCTAssert([builder pushData:nil final:YES error:&error], @"%@", error);
+        }
+        
+        ESXPDocument *dom  = [builder getDOM];
+        id<ESXPNode> item  = [[dom getElementsByTagName:@"item_number"] firstObject];
+        ESXPText     *text = (ESXPText *) [item getFirstChild];
+        ESXPRange    bytes;
+        XCTAssertEqualObjects([processor queryValue:[processor compileQuery:@"catalog//item_number"] node:[dom getRootNode] nameTable:[dom getNameTable] strict:YES], @"QWZ5671");
+        XCTAssert([text getValueBytes:&bytes]);
+        XCTAssertEqualObjects([text getValueData], [[text getNodeValue] dataUsingEncoding:NSUTF8StringEncoding]);
+        XCTAssertGreaterThan([[dom getTextBuffer] getByteCount], (uint64_t) 0);
+    }
+    
+    // Text split around a comment is merged as bytes, and written from them.
+    NSData      *xml     = [@"<a>x &amp; y<!--c-->z</a>" dataUsingEncoding:NSUTF8StringEncoding];
+    ESXPSAX2DOM *builder = [ESXPSAX2DOM newBuild:100];
+    ESXPRange   bytes;
+    builder.compactText = YES;
+    XCTAssert([builder parseData:xml frontEnd:FRONTEND_NATIVE error:&error], @"%@", error);
+    id<ESXPNode> a = [[[builder getDOM] getRootNode] getFirstChild];
+    [a normalize];
+    XCTAssertEqualObjects([[a getFirstChild] getNodeValue], @"x & yz");
+    XCTAssert([(ESXPText *) [a getFirstChild] getValueBytes:&bytes]);
+    
+    NSMutableData  *output     = [NSMutableData new];
+    ESXPSerializer *serializer = [ESXPSerializer newBuildToData:output];
+    XCTAssert([serializer writeNode:a error:&error], @"%@", error);
+    XCTAssert([serializer flush:&error], @"%@", error);
+    XCTAssertEqualObjects([[NSString alloc] initWithData:output encoding:NSUTF8StringEncoding], @"<a>x &amp; yz<!--c--></a>");
+}
+
+- (void)testBoundPages
+{
+    NSArray *bound = [self.processor getBoundPages];
+    NSArray *pages = [self.processor getPages];
+    XCTAssertGreaterThan([pages count], 0);
+    XCTAssertEqualObjects([bound valueForKey:@"_title"], [pages valueForKey:@"_title"]);
+    XCTAssertEqualObjects([bound valueForKey:@"_id"], [pages valueForKey:@"_id"]);
+    XCTAssertEqualObjects([bound valueForKey:@"_revId"], [pages valueForKey:@"_revId"]);
+}
+
 - (void)testPerformanceExample
 {
     [self measureBlock:^{